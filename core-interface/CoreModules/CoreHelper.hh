@@ -24,7 +24,8 @@ struct CoreHelper {
 	}
 
 	constexpr static ElementCount::Indices index(Elem el) {
-		return indices[element_index(el)];
+		auto idx = element_index(el);
+		return (size_t)idx < indices.size() ? indices[idx] : ElementCount::NoElementIndices;
 	}
 
 	template<Elem EL>
@@ -84,6 +85,37 @@ struct CoreHelper {
 	}
 };
 
+// The ids of an element's jacks, params and lights, checked against the
+// sizes of the value arrays at compile time. The SmartCoreProcessor classes
+// index their arrays with these directly, so they don't need any run-time checks.
+template<typename INFO, typename INFO::Elem EL>
+constexpr size_t output_id_of() {
+	constexpr size_t id = CoreHelper<INFO>::index(EL).output_idx;
+	static_assert(id < CoreHelper<INFO>::count().num_outputs, "Output id out of range");
+	return id;
+}
+
+template<typename INFO, typename INFO::Elem EL>
+constexpr size_t input_id_of() {
+	constexpr size_t id = CoreHelper<INFO>::index(EL).input_idx;
+	static_assert(id < CoreHelper<INFO>::count().num_inputs, "Input id out of range");
+	return id;
+}
+
+template<typename INFO, typename INFO::Elem EL, size_t NumParams>
+constexpr size_t param_id_of() {
+	constexpr size_t id = CoreHelper<INFO>::index(EL).param_idx;
+	static_assert(id + NumParams <= CoreHelper<INFO>::count().num_params, "Param id out of range");
+	return id;
+}
+
+template<typename INFO, typename INFO::Elem EL, size_t NumLights>
+constexpr size_t light_id_of() {
+	constexpr size_t id = CoreHelper<INFO>::index(EL).light_idx;
+	static_assert(id + NumLights <= CoreHelper<INFO>::count().num_lights, "Light id out of range");
+	return id;
+}
+
 // Safely copy `message` to `dst`, without exceeding the bounds of `dst`
 static constexpr size_t copy_text(std::string_view message, std::span<char> dst) {
 	size_t chars_to_copy = std::min(dst.size(), message.size());
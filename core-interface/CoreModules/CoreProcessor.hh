@@ -4,6 +4,14 @@
 #include <string>
 #include <string_view>
 
+// Max number of channels in a poly jack. Firmware v2.x uses 4, so that is the default.
+// Build with -DMETAMODULE_POLY_CHANNELS=8 or 16 to try out larger values, which are
+// planned for v3.x: this changes the layout of rack::engine::Port, so such plugins
+// will not run on v2.x firmware.
+#ifndef METAMODULE_POLY_CHANNELS
+#define METAMODULE_POLY_CHANNELS 4
+#endif
+
 typedef struct _lv_obj_t lv_obj_t;
 
 class CoreProcessor {
@@ -92,11 +100,24 @@ public:
 	}
 
 	// Poly:
+	// `voltages` has room for MaxPolyChannels values, and is aligned to PolyAlign
+	// bytes, so it can be loaded 4 channels at a time.
 	struct PolyPortBuffer {
 		float *voltages = nullptr;
 		uint8_t *channels = nullptr;
 	};
-	static constexpr unsigned MaxPolyChannels = 4;
+	static constexpr unsigned MaxPolyChannels = METAMODULE_POLY_CHANNELS;
+	static constexpr unsigned PolyAlign = 16;
+	static_assert(MaxPolyChannels == 4 || MaxPolyChannels == 8 || MaxPolyChannels == 16,
+				  "METAMODULE_POLY_CHANNELS must be 4, 8, or 16");
+
+	// A param change, to be applied frame_offset frames into the next block
+	// (see CoreProcessorBlock::set_param_events())
+	struct ParamEvent {
+		uint16_t param_id;
+		uint16_t frame_offset;
+		float value;
+	};
 
 	// common default values, OK to override or ignore
 	static constexpr float CvRangeVolts = 5.0f;
@@ -114,8 +135,45 @@ struct CoreProcessorPoly : public CoreProcessor {
 	}
 };
 
+struct CoreProcessorBlock : public CoreProcessor {
+
+	// Param changes for the next call to process_block(), sorted by frame_offset.
+	// The span is only valid until process_block() returns.
+	//
+	// The default implementation calls set_param() for each event straight away,
+	// so all changes happen at the start of the block. Override this (and apply
+	// the events in process_block()) to change params at the exact frame.
+	virtual void set_param_events(std::span<const ParamEvent> events) {
+		for (auto event : events)
+			set_param(event.param_id, event.value);
+	}
+
+	// Process a block of audio frames in one call.
+	// ins[n] points to `frames` samples for input jack n, or is nullptr if the jack is unpatched.
+	// outs[n] points to `frames` samples to be filled for output jack n, or is nullptr if
+	// the jack is unpatched.
+	//
+	// The default implementation calls update() once per frame, passing values through
+	// set_input() and get_output(). Override this to process the whole block at once.
+	virtual void process_block(std::span<const float *> ins, std::span<float *> outs, unsigned frames) {
+		for (unsigned frame = 0; frame < frames; frame++) {
+			for (unsigned i = 0; i < ins.size(); i++) {
+				if (ins[i])
+					set_input(i, ins[i][frame]);
+			}
+
+			update();
+
+			for (unsigned i = 0; i < outs.size(); i++) {
+				if (outs[i])
+					outs[i][frame] = get_output(i);
+			}
+		}
+	}
+};
+
 // TODO for v3.0:
-// move get_poly_*_buffer() to CoreProcessor
+// move get_poly_*_buffer() and process_block() to CoreProcessor
 // [[deprecated="Use CoreProcessor instead of CoreProcessorPoly"]] using CoreProcessorPoly = CoreProcessor;
 // Create GraphicDisplay virtual base class and move *_graphic_display() virtual funcs into it.
 // Create free function "ModuleFactory::register_graphic_display(std::string_view slug, int display_id, std::function<std::unique_ptr<GraphicDisplay>(void)>);
@@ -3,7 +3,10 @@
 #include "CoreModules/CoreProcessor.hh"
 #include "CoreModules/elements/element_counter.hh"
 #include "CoreModules/elements/element_state_conversion.hh"
+#include "CoreModules/param_change_handlers.hh"
+#include "CoreModules/param_smoothing.hh"
 #include <array>
+#include <bitset>
 #include <optional>
 
 namespace MetaModule
@@ -21,6 +24,8 @@ class SmartCoreProcessor : public CoreProcessor, public CoreHelper<INFO> {
 		return ElementCount::count(INFO::Elements[element_num(el)]);
 	}
 
+	using CoreHelper<INFO>::index;
+
 protected:
 	//
 	// Module Interface:
@@ -31,26 +36,19 @@ protected:
 	template<Elem EL>
 	void setOutput(float val) requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL);
-		if (idx.output_idx < outputValues.size())
-			outputValues[idx.output_idx] = val;
+		outputValues[output_id_of<INFO, EL>()] = val;
 	}
 
 	template<Elem EL>
 	float getOutput() requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL);
-		return idx.output_idx < outputValues.size() ? outputValues[idx.output_idx] : 0.f;
+		return outputValues[output_id_of<INFO, EL>()];
 	}
 
 	template<Elem EL>
 	bool isPatched() requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL);
-		if (idx.output_idx < outputPatched.size())
-			return outputPatched[idx.output_idx];
-		else
-			return false;
+		return outputPatched[output_id_of<INFO, EL>()];
 	}
 
 	// Inputs
@@ -58,20 +56,16 @@ protected:
 	template<Elem EL>
 	bool isPatched() requires(count(EL).num_inputs == 1)
 	{
-		auto idx = index(EL);
-		if (idx.input_idx < inputValues.size())
-			return inputValues[idx.input_idx].has_value();
-		else
-			return false;
+		return inputPatched[input_id_of<INFO, EL>()];
 	}
 
 	template<Elem EL>
 	std::optional<float> getInput() requires(count(EL).num_inputs == 1)
 	{
-		auto idx = index(EL);
-		if (idx.input_idx < inputValues.size()) {
-			return inputValues[idx.input_idx];
-		} else
+		constexpr auto idx = input_id_of<INFO, EL>();
+		if (inputPatched[idx])
+			return inputValues[idx];
+		else
 			return std::nullopt;
 	}
 
@@ -87,34 +81,58 @@ protected:
 
 	template<Elem EL>
 	auto getState() requires(count(EL).num_params > 0)
-
 	{
-		// get back the typed element from the list of elements
-		constexpr auto &elementRef = INFO::Elements[element_num(EL)];
+		return readState<EL, true>();
+	}
 
-		// reconstruct the element with its original type
-		constexpr auto variantIndex = elementRef.index();
-		constexpr auto specializedElement = std::get<variantIndex>(elementRef);
+	// Returns true if the element's params have changed since the last call
+	// (or if this is the first call). Smoothed params are changed while they
+	// are moving towards a new value. Use this to skip recalculating things
+	// which only depend on params.
+	template<Elem EL>
+	bool paramChanged() requires(count(EL).num_params > 0)
+	{
+		constexpr auto num = count(EL).num_params;
+		return paramSmoothing.take_changed(param_id_of<INFO, EL, num>(), num);
+	}
 
-		// read raw value
-		std::array<float, specializedElement.NumParams> rawValues;
-		for (std::size_t i = 0; i < rawValues.size(); i++) {
-			rawValues[i] = getParamRaw(EL, i);
+	// Advances the smoothed params (see ModuleInfoBase::smoothed_params) by
+	// `frames` samples. Call this at the start of update(), or once every
+	// `frames` calls to update() to save CPU.
+	// SmartCoreProcessor can't call this for you. Until it is first called,
+	// getState() returns smoothed params unsmoothed.
+	void smoothParams(unsigned frames = 1) {
+		if (!smoothingStarted) {
+			// Smoothing starts from the values getState() has been returning
+			paramSmoothing.jump_to_targets();
+			smoothingStarted = true;
 		}
+		paramSmoothing.process(frames);
+	}
 
-		// call conversion function for that type of element
-		// use shortcut for special but common case of single parameter elements
-		// in order to keep the conversion functions simple
-		if constexpr (rawValues.size() == 1) {
-			return MetaModule::StateConversion::convertState(specializedElement, rawValues[0]);
-		} else {
-			return MetaModule::StateConversion::convertState(specializedElement, rawValues);
+	// Calls `handler` with the new state of the element (the same type that
+	// getState<EL>() returns, but not smoothed) each time one of its params is
+	// set to a different value. Use this instead of checking for changes in
+	// update().
+	// Register handlers in the constructor: this allocates memory.
+	template<Elem EL, typename F>
+	void onParamChange(F handler) requires(count(EL).num_params > 0)
+	{
+		constexpr auto num = count(EL).num_params;
+		for (auto i = 0u; i < num; i++) {
+			paramHandlers.add(param_id_of<INFO, EL, num>() + i, [this, handler] { handler(readState<EL, false>()); });
 		}
 	}
 
+	// Call this from set_samplerate() if there are any smoothed params.
+	// The default is 48kHz.
+	void setSmoothingSampleRate(float sample_rate) {
+		paramSmoothing.set_sample_rate(sample_rate);
+	}
+
 	// LEDs
 	// TODO: make overloads for setLED, matching on various types of LEDs or requiring NumLight values
-	// Each overload converts the values and directly writes setLEDRaw (or ledValues[])
+	// Each overload converts the values and directly writes ledValues[]
 	// Then we don't need convertLED
 	template<Elem EL, typename VAL>
 	void setLED(const VAL &value) requires(count(EL).num_lights > 0)
@@ -129,8 +147,9 @@ protected:
 		// call conversion function for that type of element
 		auto rawValues = StateConversion::convertLED(specializedElement, value);
 
+		constexpr auto first_light = light_id_of<INFO, EL, std::tuple_size_v<decltype(rawValues)>>();
 		for (std::size_t i = 0; i < rawValues.size(); i++) {
-			setLEDRaw(EL, rawValues[i], i);
+			ledValues[first_light + i] = rawValues[i];
 		}
 	}
 
@@ -142,7 +161,7 @@ protected:
 
 		for (auto route : INFO::bypass_routes) {
 			if (route.output < outputValues.size() && route.input < inputValues.size()) {
-				outputValues[route.output] = inputValues[route.input].value_or(0);
+				outputValues[route.output] = inputPatched[route.input] ? inputValues[route.input] : 0.f;
 			}
 		}
 	}
@@ -152,25 +171,38 @@ private:
 	// Private Helpers:
 	//
 
-	float getParamRaw(Elem el, size_t local_index = 0) {
-		auto idx = index(el);
-		size_t param_id = idx.param_idx + local_index;
-		return (param_id < paramValues.size()) ? paramValues[param_id] : 0.f;
-	}
+	constexpr static auto counts = ElementCount::count<INFO>();
 
-	void setLEDRaw(Elem el, float val, size_t color_idx = 0) {
-		auto idx = index(el);
-		size_t led_idx = idx.light_idx + color_idx;
-		if (led_idx < ledValues.size())
-			ledValues[led_idx] = val;
-	}
+	// The element state converted from its raw param values, or from the
+	// smoothed values if the element is in INFO::smoothed_params
+	template<Elem EL, bool Smoothed>
+	auto readState() {
+		// get back the typed element from the list of elements
+		constexpr auto &elementRef = INFO::Elements[element_num(EL)];
 
-	constexpr static auto counts = ElementCount::count<INFO>();
-	constexpr static auto indices = ElementCount::get_indices<INFO>();
+		// reconstruct the element with its original type
+		constexpr auto variantIndex = elementRef.index();
+		constexpr auto specializedElement = std::get<variantIndex>(elementRef);
 
-	constexpr static auto index(Elem el) {
-		auto el_num = element_num(el);
-		return (size_t)el_num < indices.size() ? indices[el_num] : ElementCount::NoElementIndices;
+		// read raw values
+		constexpr auto first_param = param_id_of<INFO, EL, specializedElement.NumParams>();
+		constexpr auto smoother_id = ParamSmoothing<INFO>::smoother_id(first_param);
+		std::array<float, specializedElement.NumParams> rawValues;
+		for (std::size_t i = 0; i < rawValues.size(); i++) {
+			if constexpr (Smoothed && smoother_id >= 0)
+				rawValues[i] = smoothingStarted ? paramSmoothing.smoothed_value(smoother_id + i) : paramValues[first_param + i];
+			else
+				rawValues[i] = paramValues[first_param + i];
+		}
+
+		// call conversion function for that type of element
+		// use shortcut for special but common case of single parameter elements
+		// in order to keep the conversion functions simple
+		if constexpr (rawValues.size() == 1) {
+			return MetaModule::StateConversion::convertState(specializedElement, rawValues[0]);
+		} else {
+			return MetaModule::StateConversion::convertState(specializedElement, rawValues);
+		}
 	}
 
 public:
@@ -186,13 +218,20 @@ public:
 	}
 
 	void set_input(int input_id, float val) override {
-		if ((size_t)input_id < inputValues.size())
+		// Setting a voltage on a jack also marks it patched
+		if ((size_t)input_id < inputValues.size()) {
 			inputValues[input_id] = val;
+			inputPatched[input_id] = true;
+		}
 	}
 
 	void set_param(int param_id, float val) override {
 		if ((size_t)param_id < paramValues.size()) {
+			auto old_val = paramValues[param_id];
+			paramSmoothing.set_param(param_id, old_val, val);
 			paramValues[param_id] = val;
+			if (val != old_val)
+				paramHandlers.call(param_id);
 		}
 	}
 
@@ -212,24 +251,25 @@ public:
 	}
 
 	void mark_all_inputs_unpatched() override {
-		std::fill(inputValues.begin(), inputValues.end(), std::nullopt);
+		inputPatched.reset();
 	}
 
 	void mark_input_unpatched(const int input_id) override {
 		if ((size_t)input_id < inputValues.size())
-			inputValues[input_id].reset();
+			inputPatched[input_id] = false;
 	}
 
 	void mark_input_patched(const int input_id) override {
 		if ((size_t)input_id < inputValues.size()) {
 			// Marking an input patched, but not setting a voltage on the jack: assume 0V
-			if (!inputValues[input_id].has_value())
+			if (!inputPatched[input_id])
 				inputValues[input_id] = 0.f;
+			inputPatched[input_id] = true;
 		}
 	}
 
 	void mark_all_outputs_unpatched() override {
-		std::fill(outputPatched.begin(), outputPatched.end(), false);
+		outputPatched.reset();
 	}
 
 	void mark_output_unpatched(int output_id) override {
@@ -244,10 +284,21 @@ public:
 
 private:
 	std::array<float, counts.num_params> paramValues{};
-	std::array<std::optional<float>, counts.num_inputs> inputValues{};
+
+	// Jack values are in contiguous arrays, and whether each jack is
+	// patched is kept separately, one bit per jack
+	std::array<float, counts.num_inputs> inputValues{};
 	std::array<float, counts.num_outputs> outputValues{};
 	std::array<float, counts.num_lights> ledValues{};
-	std::array<bool, counts.num_outputs> outputPatched{};
+	std::bitset<counts.num_inputs> inputPatched{};
+	std::bitset<counts.num_outputs> outputPatched{};
+
+	ParamSmoothing<INFO> paramSmoothing;
+	ParamChangeHandlers paramHandlers;
+
+	// Set by smoothParams(). If a module never calls it, smoothed params would
+	// stay at their first value, so they are read unsmoothed instead.
+	bool smoothingStarted = false;
 };
 
 } // namespace MetaModule
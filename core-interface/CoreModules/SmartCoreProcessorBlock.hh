@@ -0,0 +1,375 @@
+#pragma once
+#include "CoreModules/CoreHelper.hh"
+#include "CoreModules/CoreProcessor.hh"
+#include "CoreModules/elements/element_counter.hh"
+#include "CoreModules/elements/element_state_conversion.hh"
+#include "CoreModules/param_change_handlers.hh"
+#include "CoreModules/param_smoothing.hh"
+#include <algorithm>
+#include <array>
+#include <span>
+#include <utility>
+
+namespace MetaModule
+{
+
+// Like SmartCoreProcessor, but jacks are processed a block of frames at a time.
+//
+// Implement update_block(frames) instead of update(). Inside it, getInput<EL>() returns
+// a span of `frames` input samples (empty if the jack is unpatched), and getOutput<EL>()
+// returns a span of `frames` output samples to fill in. Unpatched outputs are backed by
+// their own scratch buffer, so they can be written and read back like patched ones.
+// The block size is normally Audio::get_block_size(), but if the engine calls update()
+// then update_block() is called with frames = 1.
+//
+// Params and LEDs work the same as SmartCoreProcessor: they are updated once per block.
+// Param changes delivered with set_param_events() split the block at the frame of each
+// change, so update_block() may be called with smaller blocks.
+// Smoothed params (see ModuleInfoBase::smoothed_params) are advanced by one block
+// before each call to update_block().
+template<typename INFO>
+class SmartCoreProcessorBlock : public CoreProcessorBlock, public CoreHelper<INFO> {
+	using Elem = typename INFO::Elem;
+
+	constexpr static auto element_num(Elem el) {
+		return static_cast<std::underlying_type_t<Elem>>(el);
+	}
+
+	constexpr static auto count(Elem el) {
+		return ElementCount::count(INFO::Elements[element_num(el)]);
+	}
+
+	using CoreHelper<INFO>::index;
+
+public:
+	// Largest block processed in one call to update_block().
+	// Larger blocks passed to process_block() are split.
+	static constexpr unsigned MaxBlockSize = 512;
+
+protected:
+	//
+	// Module Interface:
+	//
+
+	virtual void update_block(unsigned frames) = 0;
+
+	// Number of frames in the block currently being processed
+	unsigned blockSize() const {
+		return frames;
+	}
+
+	// Outputs
+
+	template<Elem EL>
+	std::span<float> getOutput() requires(count(EL).num_outputs == 1)
+	{
+		return {outputBlocks[output_id_of<INFO, EL>()], frames};
+	}
+
+	template<Elem EL>
+	void setOutput(std::span<const float> vals) requires(count(EL).num_outputs == 1)
+	{
+		auto out = getOutput<EL>();
+		std::copy_n(vals.begin(), std::min(vals.size(), out.size()), out.begin());
+	}
+
+	template<Elem EL>
+	void setOutput(float val) requires(count(EL).num_outputs == 1)
+	{
+		auto out = getOutput<EL>();
+		std::fill(out.begin(), out.end(), val);
+	}
+
+	template<Elem EL>
+	bool isPatched() requires(count(EL).num_outputs == 1)
+	{
+		return outputPatched[output_id_of<INFO, EL>()];
+	}
+
+	// Inputs
+
+	template<Elem EL>
+	bool isPatched() requires(count(EL).num_inputs == 1)
+	{
+		return inputPatched[input_id_of<INFO, EL>()];
+	}
+
+	template<Elem EL>
+	std::span<const float> getInput() requires(count(EL).num_inputs == 1)
+	{
+		constexpr auto idx = input_id_of<INFO, EL>();
+		if (inputBlocks[idx])
+			return {inputBlocks[idx], frames};
+		else
+			return {};
+	}
+
+	// Params
+
+	template<Elem EL>
+	auto getState() requires(count(EL).num_params > 0)
+	{
+		return readState<EL, true>();
+	}
+
+	// Returns true if the element's params have changed since the last call
+	// (or if this is the first call). Smoothed params are changed while they
+	// are moving towards a new value.
+	template<Elem EL>
+	bool paramChanged() requires(count(EL).num_params > 0)
+	{
+		constexpr auto num = count(EL).num_params;
+		return paramSmoothing.take_changed(param_id_of<INFO, EL, num>(), num);
+	}
+
+	// Calls `handler` with the new state of the element (the same type that
+	// getState<EL>() returns, but not smoothed) each time one of its params is
+	// set to a different value. Use this instead of checking for changes in
+	// update().
+	// Changes delivered with set_param_events() are applied at their frame:
+	// the block is split there, and the handler is called between the two
+	// calls to update_block().
+	// Register handlers in the constructor: this allocates memory.
+	template<Elem EL, typename F>
+	void onParamChange(F handler) requires(count(EL).num_params > 0)
+	{
+		constexpr auto num = count(EL).num_params;
+		for (auto i = 0u; i < num; i++) {
+			paramHandlers.add(param_id_of<INFO, EL, num>() + i, [this, handler] { handler(readState<EL, false>()); });
+		}
+	}
+
+	// Call this from set_samplerate() if there are any smoothed params.
+	// The default is 48kHz.
+	void setSmoothingSampleRate(float sample_rate) {
+		paramSmoothing.set_sample_rate(sample_rate);
+	}
+
+	// LEDs
+	template<Elem EL, typename VAL>
+	void setLED(const VAL &value) requires(count(EL).num_lights > 0)
+	{
+		// get back the typed element from the list of elements
+		constexpr auto &elementRef = INFO::Elements[element_num(EL)];
+
+		// reconstruct the element with its original type
+		constexpr auto variantIndex = elementRef.index();
+		constexpr auto specializedElement = std::get<variantIndex>(elementRef);
+
+		// call conversion function for that type of element
+		auto rawValues = StateConversion::convertLED(specializedElement, value);
+
+		constexpr auto first_light = light_id_of<INFO, EL, std::tuple_size_v<decltype(rawValues)>>();
+		for (std::size_t i = 0; i < rawValues.size(); i++) {
+			ledValues[first_light + i] = rawValues[i];
+		}
+	}
+
+	// Bypass
+
+	void handle_bypass() {
+		for (auto out : outputBlocks)
+			std::fill_n(out, frames, 0.f);
+
+		for (auto route : INFO::bypass_routes) {
+			if (route.output < outputBlocks.size() && route.input < inputBlocks.size()) {
+				if (inputBlocks[route.input])
+					std::copy_n(inputBlocks[route.input], frames, outputBlocks[route.output]);
+			}
+		}
+	}
+
+private:
+	//
+	// Private Helpers:
+	//
+
+	constexpr static auto counts = ElementCount::count<INFO>();
+
+	// The element state converted from its raw param values, or from the
+	// smoothed values if the element is in INFO::smoothed_params
+	template<Elem EL, bool Smoothed>
+	auto readState() {
+		// get back the typed element from the list of elements
+		constexpr auto &elementRef = INFO::Elements[element_num(EL)];
+
+		// reconstruct the element with its original type
+		constexpr auto variantIndex = elementRef.index();
+		constexpr auto specializedElement = std::get<variantIndex>(elementRef);
+
+		// read raw values
+		constexpr auto first_param = param_id_of<INFO, EL, specializedElement.NumParams>();
+		constexpr auto smoother_id = ParamSmoothing<INFO>::smoother_id(first_param);
+		std::array<float, specializedElement.NumParams> rawValues;
+		for (std::size_t i = 0; i < rawValues.size(); i++) {
+			if constexpr (Smoothed && smoother_id >= 0)
+				rawValues[i] = paramSmoothing.smoothed_value(smoother_id + i);
+			else
+				rawValues[i] = paramValues[first_param + i];
+		}
+
+		// call conversion function for that type of element
+		// use shortcut for special but common case of single parameter elements
+		// in order to keep the conversion functions simple
+		if constexpr (rawValues.size() == 1) {
+			return MetaModule::StateConversion::convertState(specializedElement, rawValues[0]);
+		} else {
+			return MetaModule::StateConversion::convertState(specializedElement, rawValues);
+		}
+	}
+
+public:
+	//
+	// CoreProcessor interface:
+	//
+
+	void update() final {
+		// Single-frame processing: the jack values live in the scalar arrays
+		for (auto i = 0u; i < inputBlocks.size(); i++)
+			inputBlocks[i] = inputPatched[i] ? &inputScalars[i] : nullptr;
+
+		for (auto i = 0u; i < outputBlocks.size(); i++)
+			outputBlocks[i] = &outputScalars[i];
+
+		frames = 1;
+		paramSmoothing.process(1);
+		update_block(1);
+	}
+
+	void set_param_events(std::span<const ParamEvent> events) final {
+		paramEvents = events;
+	}
+
+	void process_block(std::span<const float *> ins, std::span<float *> outs, unsigned num_frames) final {
+		auto events = std::exchange(paramEvents, {});
+
+		for (unsigned start = 0; start < num_frames; start += frames) {
+			// Apply the param changes due at this frame, and end the block at the next one
+			while (!events.empty() && events.front().frame_offset <= start) {
+				set_param(events.front().param_id, events.front().value);
+				events = events.subspan(1);
+			}
+
+			unsigned end = std::min(num_frames, start + MaxBlockSize);
+			if (!events.empty())
+				end = std::min<unsigned>(end, events.front().frame_offset);
+			frames = end - start;
+
+			for (auto i = 0u; i < inputBlocks.size(); i++) {
+				bool has_data = i < ins.size() && ins[i];
+				inputBlocks[i] = has_data ? ins[i] + start : nullptr;
+			}
+
+			// Unpatched outputs are written to their own scratch buffer, so the
+			// module can always write `frames` samples to every output, and read
+			// them back
+			for (auto i = 0u; i < outputBlocks.size(); i++) {
+				bool has_data = i < outs.size() && outs[i];
+				outputBlocks[i] = has_data ? outs[i] + start : &scratch[i * MaxBlockSize];
+			}
+
+			paramSmoothing.process(frames);
+			update_block(frames);
+		}
+
+		// Events after the end of the block (or with no frames to process)
+		for (auto event : events)
+			set_param(event.param_id, event.value);
+
+		// Keep get_output() valid: it returns the last frame of the block
+		if (num_frames > 0) {
+			for (auto i = 0u; i < outputBlocks.size(); i++)
+				outputScalars[i] = outputBlocks[i][frames - 1];
+		}
+	}
+
+	float get_output(int output_id) const override {
+		if ((size_t)output_id < outputScalars.size())
+			return outputScalars[output_id];
+		else
+			return 0.f;
+	}
+
+	void set_input(int input_id, float val) override {
+		if ((size_t)input_id < inputScalars.size())
+			inputScalars[input_id] = val;
+	}
+
+	void set_param(int param_id, float val) override {
+		if ((size_t)param_id < paramValues.size()) {
+			auto old_val = paramValues[param_id];
+			paramSmoothing.set_param(param_id, old_val, val);
+			paramValues[param_id] = val;
+			if (val != old_val)
+				paramHandlers.call(param_id);
+		}
+	}
+
+	float get_param(int param_id) const override {
+		if (size_t(param_id) < paramValues.size())
+			return paramValues[param_id];
+		else
+			return 0.f;
+	}
+
+	float get_led_brightness(int led_id) const override {
+		if ((size_t)led_id < ledValues.size()) {
+			return ledValues[led_id];
+		} else {
+			return 0.0f;
+		}
+	}
+
+	void mark_all_inputs_unpatched() override {
+		std::fill(inputPatched.begin(), inputPatched.end(), false);
+		std::fill(inputScalars.begin(), inputScalars.end(), 0.f);
+	}
+
+	void mark_input_unpatched(int input_id) override {
+		if ((size_t)input_id < inputPatched.size()) {
+			inputPatched[input_id] = false;
+			inputScalars[input_id] = 0.f;
+		}
+	}
+
+	void mark_input_patched(int input_id) override {
+		if ((size_t)input_id < inputPatched.size())
+			inputPatched[input_id] = true;
+	}
+
+	void mark_all_outputs_unpatched() override {
+		std::fill(outputPatched.begin(), outputPatched.end(), false);
+	}
+
+	void mark_output_unpatched(int output_id) override {
+		if (size_t(output_id) < outputPatched.size())
+			outputPatched[output_id] = false;
+	}
+
+	void mark_output_patched(int output_id) override {
+		if (size_t(output_id) < outputPatched.size())
+			outputPatched[output_id] = true;
+	}
+
+private:
+	std::array<float, counts.num_params> paramValues{};
+
+	std::array<const float *, counts.num_inputs> inputBlocks{};
+	std::array<float, counts.num_inputs> inputScalars{};
+	std::array<bool, counts.num_inputs> inputPatched{};
+
+	std::array<float *, counts.num_outputs> outputBlocks{};
+	std::array<float, counts.num_outputs> outputScalars{};
+	std::array<bool, counts.num_outputs> outputPatched{};
+
+	std::array<float, counts.num_lights> ledValues{};
+
+	ParamSmoothing<INFO> paramSmoothing;
+	ParamChangeHandlers paramHandlers;
+	std::span<const ParamEvent> paramEvents{};
+
+	std::array<float, MaxBlockSize * counts.num_outputs> scratch{};
+	unsigned frames = 1;
+};
+
+} // namespace MetaModule
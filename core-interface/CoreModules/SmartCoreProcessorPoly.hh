@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <array>
 #include <optional>
+#include <span>
 
 namespace MetaModule
 {
@@ -21,6 +22,10 @@ namespace MetaModule
 // output carries, and setOutput<EL>(val, chan) to write each channel. An unpatched
 // output has 0 channels; setChannels() keeps it that way (only mark_output_patched/
 // unpatched change the count to/from 0).
+//
+// The voltages of each jack are aligned to PolyAlign bytes, so getInputs<EL>() and
+// getOutputs<EL>() can be loaded and stored 4 channels at a time. Every jack has
+// room for MaxPolyChannels channels, as CoreProcessor::PolyPortBuffer promises.
 template<typename INFO>
 class SmartCoreProcessorPoly : public CoreProcessorPoly, public CoreHelper<INFO> {
 	using Elem = typename INFO::Elem;
@@ -33,6 +38,8 @@ class SmartCoreProcessorPoly : public CoreProcessorPoly, public CoreHelper<INFO>
 		return ElementCount::count(INFO::Elements[element_num(el)]);
 	}
 
+	using CoreHelper<INFO>::index;
+
 protected:
 	//
 	// Module Interface:
@@ -43,60 +50,53 @@ protected:
 	template<Elem EL>
 	void setOutput(float val, unsigned chan = 0) requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL).output_idx;
-		if (idx < outputValues.size()) {
-			if (chan < outputValues[idx].size()) {
-				outputValues[idx][chan] = val;
-			}
-		}
+		constexpr auto idx = output_id_of<INFO, EL>();
+		if (chan < MaxPolyChannels)
+			outputVoltages(idx)[chan] = val;
 	}
 
 	template<Elem EL>
 	float getOutput(unsigned chan = 0) requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL).output_idx;
-		if (idx < outputValues.size() && chan < outputValues[idx].size())
-			return outputValues[idx][chan];
-		return 0.f;
+		constexpr auto idx = output_id_of<INFO, EL>();
+		return chan < MaxPolyChannels ? outputVoltages(idx)[chan] : 0.f;
+	}
+
+	// All the channels that can be written to the output (not just numChannels<EL>())
+	template<Elem EL>
+	std::span<float> getOutputs() requires(count(EL).num_outputs == 1)
+	{
+		constexpr auto idx = output_id_of<INFO, EL>();
+		return {outputVoltages(idx), MaxPolyChannels};
 	}
 
 	template<Elem EL>
 	unsigned numChannels() requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL).output_idx;
-		if (idx < outputChannels.size())
-			return outputChannels[idx];
-		else
-			return 0;
+		return outputChannels[output_id_of<INFO, EL>()];
 	}
 
 	template<Elem EL>
 	void setChannels(unsigned num_chans) requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL).output_idx;
-		if (idx < outputChannels.size()) {
+		constexpr auto idx = output_id_of<INFO, EL>();
 
-			// Only mark_*_patched() can change channels from 0
-			if (outputChannels[idx] == 0)
-				return;
+		// Only mark_*_patched() can change channels from 0
+		if (outputChannels[idx] == 0)
+			return;
 
-			// If reducing # of channels, zero out the old ones
-			for (auto i = num_chans; i < outputChannels[idx]; i++)
-				outputValues[idx][i] = 0.f;
+		// If reducing # of channels, zero out the old ones
+		for (auto i = num_chans; i < outputChannels[idx]; i++)
+			outputVoltages(idx)[i] = 0.f;
 
-			// Only mark_*_unpatched() can change channel to 0
-			outputChannels[idx] = std::clamp(num_chans, 1u, MaxPolyChannels);
-		}
+		// Only mark_*_unpatched() can change channel to 0
+		outputChannels[idx] = std::clamp<unsigned>(num_chans, 1, MaxPolyChannels);
 	}
 
 	template<Elem EL>
 	bool isPatched() requires(count(EL).num_outputs == 1)
 	{
-		auto idx = index(EL).output_idx;
-		if (idx < outputChannels.size())
-			return outputChannels[idx];
-		else
-			return false;
+		return outputChannels[output_id_of<INFO, EL>()];
 	}
 
 	// Inputs
@@ -104,21 +104,25 @@ protected:
 	template<Elem EL>
 	std::optional<float> getInput(unsigned chan = 0) requires(count(EL).num_inputs == 1)
 	{
-		auto idx = index(EL).input_idx;
-		if (idx < inputValues.size() && chan < inputChannels[idx])
-			return inputValues[idx][chan];
+		constexpr auto idx = input_id_of<INFO, EL>();
+		if (chan < inputChannels[idx])
+			return inputVoltages(idx)[chan];
 		else
 			return std::nullopt;
 	}
 
+	// The voltages of the input's channels (empty if unpatched)
+	template<Elem EL>
+	std::span<const float> getInputs() requires(count(EL).num_inputs == 1)
+	{
+		constexpr auto idx = input_id_of<INFO, EL>();
+		return {inputVoltages(idx), inputChannels[idx]};
+	}
+
 	template<Elem EL>
 	unsigned numChannels() requires(count(EL).num_inputs == 1)
 	{
-		auto idx = index(EL).input_idx;
-		if (idx < inputChannels.size())
-			return inputChannels[idx];
-		else
-			return 0;
+		return inputChannels[input_id_of<INFO, EL>()];
 	}
 
 	template<Elem EL>
@@ -141,9 +145,10 @@ protected:
 		constexpr auto specializedElement = std::get<variantIndex>(elementRef);
 
 		// read raw value
+		constexpr auto first_param = param_id_of<INFO, EL, specializedElement.NumParams>();
 		std::array<float, specializedElement.NumParams> rawValues;
 		for (std::size_t i = 0; i < rawValues.size(); i++) {
-			rawValues[i] = getParamRaw(EL, i);
+			rawValues[i] = paramValues[first_param + i];
 		}
 
 		// call conversion function for that type of element
@@ -170,23 +175,20 @@ protected:
 		// call conversion function for that type of element
 		auto rawValues = StateConversion::convertLED(specializedElement, value);
 
+		constexpr auto first_light = light_id_of<INFO, EL, std::tuple_size_v<decltype(rawValues)>>();
 		for (std::size_t i = 0; i < rawValues.size(); i++) {
-			auto idx = index(EL);
-			size_t led_idx = idx.light_idx + i;
-			if (led_idx < ledValues.size())
-				ledValues[led_idx] = rawValues[i];
+			ledValues[first_light + i] = rawValues[i];
 		}
 	}
 
 	// Bypass
 
 	void handle_bypass() {
-		for (auto &out : outputValues)
-			out = {};
+		outputPool.fill(0.f);
 
 		for (auto route : INFO::bypass_routes) {
-			if (route.output < outputValues.size() && route.input < inputValues.size()) {
-				outputValues[route.output] = inputValues[route.input];
+			if (route.output < outputChannels.size() && route.input < inputChannels.size()) {
+				std::copy_n(inputVoltages(route.input), MaxPolyChannels, outputVoltages(route.output));
 				if (outputChannels[route.output] > 0)
 					outputChannels[route.output] = std::clamp<unsigned>(inputChannels[route.input], 1, MaxPolyChannels);
 			}
@@ -198,18 +200,14 @@ private:
 	// Private Helpers:
 	//
 
-	float getParamRaw(Elem el, size_t local_index = 0) {
-		auto idx = index(el);
-		size_t param_id = idx.param_idx + local_index;
-		return (param_id < paramValues.size()) ? paramValues[param_id] : 0.f;
-	}
-
 	constexpr static auto counts = ElementCount::count<INFO>();
-	constexpr static auto indices = ElementCount::get_indices<INFO>();
 
-	constexpr static auto index(Elem el) {
-		auto el_num = element_num(el);
-		return (size_t)el_num < indices.size() ? indices[el_num] : ElementCount::NoElementIndices;
+	float *inputVoltages(size_t input_id) {
+		return &inputPool[input_id * MaxPolyChannels];
+	}
+
+	float *outputVoltages(size_t output_id) {
+		return &outputPool[output_id * MaxPolyChannels];
 	}
 
 public:
@@ -218,16 +216,16 @@ public:
 	//
 
 	float get_output(int output_id) const override {
-		if ((size_t)output_id < outputValues.size())
-			return outputValues[output_id][0];
+		if ((size_t)output_id < outputChannels.size())
+			return outputPool[output_id * MaxPolyChannels];
 		else
 			return 0.f;
 	}
 
 	void set_input(int input_id, float val) override {
 		// Mono sources write channel 0; poly sources write the buffers directly
-		if ((size_t)input_id < inputValues.size())
-			inputValues[input_id][0] = val;
+		if ((size_t)input_id < inputChannels.size())
+			inputVoltages(input_id)[0] = val;
 	}
 
 	void set_param(int param_id, float val) override {
@@ -253,24 +251,23 @@ public:
 
 	void mark_all_inputs_unpatched() override {
 		std::fill(inputChannels.begin(), inputChannels.end(), 0);
-		for (auto &in : inputValues)
-			in = {};
+		inputPool.fill(0.f);
 	}
 
 	void mark_input_unpatched(int input_id) override {
-		if ((size_t)input_id < inputValues.size()) {
+		if ((size_t)input_id < inputChannels.size()) {
 			inputChannels[input_id] = 0;
-			inputValues[input_id] = {};
+			std::fill_n(inputVoltages(input_id), MaxPolyChannels, 0.f);
 		}
 	}
 
 	void mark_input_patched(int input_id) override {
-		if ((size_t)input_id < inputValues.size()) {
+		if ((size_t)input_id < inputChannels.size()) {
 			// 0  -> 1 and init the voltages to zero
 			// 1+ -> no change
 			if (inputChannels[input_id] == 0) {
 				inputChannels[input_id] = 1;
-				inputValues[input_id] = {};
+				std::fill_n(inputVoltages(input_id), MaxPolyChannels, 0.f);
 			}
 		}
 	}
@@ -294,26 +291,27 @@ public:
 	}
 
 	CoreProcessor::PolyPortBuffer get_poly_input_buffer(int input_id) override {
-		if ((size_t)input_id >= inputValues.size())
+		if ((size_t)input_id >= inputChannels.size())
 			return {};
 
-		return {inputValues[input_id].data(), &inputChannels[input_id]};
+		return {inputVoltages(input_id), &inputChannels[input_id]};
 	}
 
 	CoreProcessor::PolyPortBuffer get_poly_output_buffer(int output_id) override {
-		if ((size_t)output_id >= outputValues.size())
+		if ((size_t)output_id >= outputChannels.size())
 			return {};
 
-		return {outputValues[output_id].data(), &outputChannels[output_id]};
+		return {outputVoltages(output_id), &outputChannels[output_id]};
 	}
 
 private:
 	std::array<float, counts.num_params> paramValues{};
 
-	std::array<std::array<float, MaxPolyChannels>, counts.num_inputs> inputValues{};
+	// The voltages of all the jacks, MaxPolyChannels per jack
+	alignas(PolyAlign) std::array<float, MaxPolyChannels * counts.num_inputs> inputPool{};
 	std::array<uint8_t, counts.num_inputs> inputChannels{};
 
-	std::array<std::array<float, MaxPolyChannels>, counts.num_outputs> outputValues{};
+	alignas(PolyAlign) std::array<float, MaxPolyChannels * counts.num_outputs> outputPool{};
 	std::array<uint8_t, counts.num_outputs> outputChannels{};
 
 	std::array<float, counts.num_lights> ledValues{};
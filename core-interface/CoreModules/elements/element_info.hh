@@ -21,6 +21,18 @@ struct ModuleInfoBase {
 		uint16_t output;
 	};
 	static constexpr std::array<BypassRoute, 0> bypass_routes{};
+
+	// Params to be smoothed by SmartCoreProcessor, for example:
+	//   static constexpr std::array smoothed_params{SmoothedParam{Elem::LevelKnob, 20.f}};
+	// `ms` is the time to move 63% of the way to a new value.
+	// NOTE: SmartCoreProcessorBlock smooths them automatically, but a
+	// SmartCoreProcessor module must call smoothParams() in update(). If it
+	// doesn't, getState() returns these params unsmoothed.
+	template<typename Elem>
+	struct SmoothedParam {
+		Elem element;
+		float ms;
+	};
 };
 
 } // namespace MetaModule
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace MetaModule
+{
+
+// Functions to call when a param changes, for SmartCoreProcessor::onParamChange().
+// Only modules which register handlers use any memory for them.
+class ParamChangeHandlers {
+public:
+	// Not real-time safe: call this from the module's constructor
+	void add(uint16_t param_id, std::function<void()> &&handler) {
+		handlers.push_back({param_id, std::move(handler)});
+	}
+
+	void call(uint16_t param_id) const {
+		for (auto const &[id, handler] : handlers) {
+			if (id == param_id)
+				handler();
+		}
+	}
+
+private:
+	std::vector<std::pair<uint16_t, std::function<void()>>> handlers;
+};
+
+} // namespace MetaModule
@@ -0,0 +1,63 @@
+#pragma once
+#include "CoreModules/CoreProcessor.hh"
+#include "threads/spsc_ring_buffer.hh"
+#include <algorithm>
+#include <span>
+
+namespace MetaModule
+{
+
+// Lock-free queue of param changes for one module, from the thread that
+// reads knobs (or the GUI) to the audio thread.
+//
+// Usage:
+//     ParamEventQueue<> queue;
+//
+//     // Control thread:
+//     queue.push({.param_id = 2, .frame_offset = 16, .value = 0.5f});
+//
+//     // Audio thread, at the start of each block:
+//     std::array<CoreProcessor::ParamEvent, 64> events;
+//     module->set_param_events(queue.pop_block(events, frames));
+//     module->process_block(ins, outs, frames);
+//
+template<size_t Size = 64>
+class ParamEventQueue {
+public:
+	using ParamEvent = CoreProcessor::ParamEvent;
+
+	// Producer side. Returns false if the queue is full.
+	bool push(ParamEvent event) {
+		return events.push(event);
+	}
+
+	// Consumer side. Removes up to out.size() events into `out`, sorted by frame.
+	// Events past the end of a block of `frames` frames are moved to its last frame.
+	std::span<const ParamEvent> pop_block(std::span<ParamEvent> out, unsigned frames) {
+		auto block = out.first(events.read(out));
+
+		const unsigned last_frame = frames > 0 ? frames - 1 : 0;
+		for (auto &event : block)
+			event.frame_offset = std::min<unsigned>(event.frame_offset, last_frame);
+
+		// Insertion sort: it keeps the order of events at the same frame, so the
+		// last one wins, and unlike std::stable_sort it never allocates
+		for (size_t i = 1; i < block.size(); i++) {
+			const auto event = block[i];
+			auto j = i;
+			for (; j > 0 && block[j - 1].frame_offset > event.frame_offset; j--)
+				block[j] = block[j - 1];
+			block[j] = event;
+		}
+		return block;
+	}
+
+	bool empty() const {
+		return events.empty();
+	}
+
+private:
+	SpscRingBuffer<ParamEvent, Size> events;
+};
+
+} // namespace MetaModule
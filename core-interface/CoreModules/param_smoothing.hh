@@ -0,0 +1,209 @@
+#pragma once
+#include "CoreModules/elements/element_counter.hh"
+#include "CoreModules/elements/element_info.hh"
+#include "dsp/float4.hh"
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+
+namespace MetaModule
+{
+
+// One-pole smoothing of N values towards their targets.
+// All the values are advanced together, a block of samples at a time, 4 values at a time.
+template<size_t N>
+class ParamSmoother {
+public:
+	// Sets the time for value i to move 63% of the way to a new target.
+	// 0 ms means no smoothing.
+	void set_time(size_t i, float ms, float sample_rate) {
+		retain[i] = (ms > 0 && sample_rate > 0) ? std::exp(-1000.f / (ms * sample_rate)) : 0.f;
+		block_frames = 0;
+	}
+
+	// The first target jumps straight there, later targets are smoothed
+	void set_target(size_t i, float val) {
+		target[i] = val;
+		if (!started[i]) {
+			value[i] = val;
+			started[i] = true;
+		} else if (value[i] != val)
+			moving[i] = true;
+	}
+
+	float get(size_t i) const {
+		return value[i];
+	}
+
+	// Moves all the values straight to their targets
+	void jump_to_targets() {
+		value = target;
+		moving.reset();
+	}
+
+	// Advances all the values by `frames` samples.
+	// Returns which values moved.
+	std::bitset<N> process(unsigned frames) {
+		if (moving.none() || frames == 0)
+			return {};
+
+		auto moved = moving;
+
+		// The step for a block is only recalculated when the block size changes
+		if (frames != block_frames) {
+			for (size_t i = 0; i < N; i++)
+				step[i] = 1.f - std::pow(retain[i], float(frames));
+			block_frames = frames;
+		}
+
+		// Values which are not moving are at their targets, so they don't change
+		for (size_t i = 0; i < Lanes; i += 4) {
+			auto v = Float4::load(&value[i]);
+			auto diff = Float4::load(&target[i]) - v;
+			(v + diff * Float4::load(&step[i])).store(&value[i]);
+		}
+
+		for (size_t i = 0; i < N; i++) {
+			if (moving[i] && std::abs(target[i] - value[i]) < SettledError) {
+				value[i] = target[i];
+				moving[i] = false;
+			}
+		}
+
+		return moved;
+	}
+
+private:
+	static constexpr size_t Lanes = (N + 3) / 4 * 4;
+	static constexpr float SettledError = 1e-5f;
+
+	alignas(16) std::array<float, Lanes> value{};
+	alignas(16) std::array<float, Lanes> target{};
+	alignas(16) std::array<float, Lanes> step{};
+	std::array<float, N> retain{};
+	std::bitset<N> moving{};
+	std::bitset<N> started{};
+	unsigned block_frames = 0;
+};
+
+// Smoothing of the params of the elements listed in INFO::smoothed_params,
+// and tracking which params have changed.
+// Used by SmartCoreProcessor and SmartCoreProcessorBlock.
+template<typename INFO>
+class ParamSmoothing {
+	using Elem = typename INFO::Elem;
+
+	static constexpr auto smoothed_elements() {
+		if constexpr (requires { INFO::smoothed_params; })
+			return INFO::smoothed_params;
+		else
+			return std::array<ModuleInfoBase::SmoothedParam<Elem>, 0>{};
+	}
+
+	static constexpr auto elements = smoothed_elements();
+	static constexpr auto indices = ElementCount::get_indices<INFO>();
+	static constexpr size_t NumParams = ElementCount::count<INFO>().num_params;
+
+	static constexpr size_t num_params_of(Elem el) {
+		return ElementCount::count(INFO::Elements[static_cast<size_t>(el)]).num_params;
+	}
+
+	static constexpr size_t NumSmoothed = [] {
+		size_t num = 0;
+		for (auto p : elements)
+			num += num_params_of(p.element);
+		return num;
+	}();
+
+	struct Smoothed {
+		uint16_t param_id;
+		float ms;
+	};
+
+	// The params of each element get consecutive smoothers
+	static constexpr auto smoothed = [] {
+		std::array<Smoothed, NumSmoothed> s{};
+		size_t num = 0;
+		for (auto p : elements) {
+			auto first = indices[static_cast<size_t>(p.element)].param_idx;
+			for (size_t i = 0; i < num_params_of(p.element); i++)
+				s[num++] = {uint16_t(first + i), p.ms};
+		}
+		return s;
+	}();
+
+	// The smoother for each param id, or -1 if the param is not smoothed
+	static constexpr auto smoother_ids = [] {
+		std::array<int16_t, NumParams> ids{};
+		ids.fill(-1);
+		for (size_t i = 0; i < NumSmoothed; i++)
+			ids[smoothed[i].param_id] = i;
+		return ids;
+	}();
+
+public:
+	ParamSmoothing() {
+		set_sample_rate(48000.f);
+	}
+
+	static constexpr int smoother_id(size_t param_id) {
+		return param_id < NumParams ? smoother_ids[param_id] : -1;
+	}
+
+	void set_sample_rate(float sample_rate) {
+		for (size_t i = 0; i < NumSmoothed; i++)
+			smoother.set_time(i, smoothed[i].ms, sample_rate);
+	}
+
+	// Call this when a param is set
+	void set_param(size_t param_id, float old_val, float val) {
+		if (val != old_val)
+			unchanged[param_id] = false;
+
+		if constexpr (NumSmoothed > 0) {
+			if (auto id = smoother_ids[param_id]; id >= 0)
+				smoother.set_target(id, val);
+		}
+	}
+
+	void process(unsigned frames) {
+		if constexpr (NumSmoothed > 0) {
+			auto moved = smoother.process(frames);
+			if (moved.none())
+				return;
+
+			for (size_t i = 0; i < NumSmoothed; i++) {
+				if (moved[i])
+					unchanged[smoothed[i].param_id] = false;
+			}
+		}
+	}
+
+	// Moves the smoothed values straight to the current param values
+	void jump_to_targets() {
+		if constexpr (NumSmoothed > 0)
+			smoother.jump_to_targets();
+	}
+
+	float smoothed_value(size_t smoother_id) const {
+		return smoother.get(smoother_id);
+	}
+
+	// Whether any of the params changed since the last time this was called for them.
+	// All params start as changed.
+	bool take_changed(size_t first_param_id, size_t num_params) {
+		bool changed = false;
+		for (size_t i = first_param_id; i < first_param_id + num_params; i++) {
+			changed = changed || !unchanged[i];
+			unchanged[i] = true;
+		}
+		return changed;
+	}
+
+private:
+	ParamSmoother<NumSmoothed> smoother;
+	std::bitset<NumParams> unchanged{};
+};
+
+} // namespace MetaModule
@@ -1,4 +1,5 @@
 #pragma once
+#include "dsp/float4.hh"
 #include "util/fixed_vector.hh"
 #include <array>
 #include <cstdint>
@@ -13,6 +14,12 @@ public:
 	~BlockResampler();
 
 	size_t process(uint32_t channel_index, std::span<const float> in, std::span<float> out);
+
+	// Resamples all channels of an interleaved block in one pass.
+	// `in` and `out` hold num_channels interleaved channels (strides are ignored).
+	// Returns the number of samples written to `out` (a multiple of num_channels).
+	size_t process_interleaved(std::span<const float> in, std::span<float> out);
+
 	void set_samplerate_in_out(uint32_t input_rate, uint32_t output_rate);
 	void set_input_stride(uint32_t stride);
 	void set_output_stride(uint32_t stride);
@@ -39,6 +46,114 @@ private:
 	size_t num_chans = 0;
 };
 
+// The interleaved kernel is inline, so it runs 4 channels per NEON operation
+// no matter which firmware version the plugin is loaded by.
+// The channel history is loaded into vectors once per block, and stored back
+// when done, so process() and process_interleaved() can be mixed.
+inline size_t BlockResampler::process_interleaved(std::span<const float> in, std::span<float> out) {
+	constexpr size_t MaxGroups = MAX_RESAMPLER_CHANNELS / 4;
+	const size_t num_groups = (num_chans + 3) / 4;
+	const size_t padded_chans = num_groups * 4;
+
+	// All channels are flushed together (flush(), ratio change). process() only
+	// clears its own channel's flag, so check them all.
+	bool should_flush = false;
+	for (auto &chan : chans)
+		should_flush |= chan.flush;
+
+	if (should_flush) {
+		for (auto &chan : chans)
+			chan = {.frac_pos = 1.f, .flush = false};
+	}
+
+	alignas(16) float hist[4][MaxGroups * 4]{};
+	for (size_t i = 0; i < num_chans; i++) {
+		hist[0][i] = chans[i].xm1;
+		hist[1][i] = chans[i].x0;
+		hist[2][i] = chans[i].x1;
+		hist[3][i] = chans[i].x2;
+	}
+
+	Float4 xm1[MaxGroups], x0[MaxGroups], x1[MaxGroups], x2[MaxGroups];
+	for (size_t g = 0; g < num_groups; g++) {
+		xm1[g] = Float4::load(&hist[0][g * 4]);
+		x0[g] = Float4::load(&hist[1][g * 4]);
+		x1[g] = Float4::load(&hist[2][g * 4]);
+		x2[g] = Float4::load(&hist[3][g * 4]);
+	}
+
+	const size_t in_frames = in.size() / num_chans;
+	const size_t out_frames = out.size() / num_chans;
+	const bool full_groups = padded_chans == num_chans;
+	const Float4 half = Float4::splat(0.5f);
+
+	alignas(16) float frame[MaxGroups * 4]{};
+	float frac_pos = chans[0].frac_pos;
+	size_t in_frame = 0;
+	size_t out_frame = 0;
+
+	while (out_frame < out_frames) {
+		while (frac_pos >= 1.f) {
+			if (in_frame >= in_frames)
+				goto done;
+
+			frac_pos -= 1.f;
+
+			const float *src = &in[in_frame * num_chans];
+			if (!full_groups) {
+				for (size_t i = 0; i < num_chans; i++)
+					frame[i] = src[i];
+				src = frame;
+			}
+
+			for (size_t g = 0; g < num_groups; g++) {
+				xm1[g] = x0[g];
+				x0[g] = x1[g];
+				x1[g] = x2[g];
+				x2[g] = Float4::load(src + g * 4);
+			}
+			in_frame++;
+		}
+
+		// 4-point, 3rd-order Hermite interpolation (x-form)
+		const Float4 t = Float4::splat(frac_pos);
+		float *dst = full_groups ? &out[out_frame * num_chans] : frame;
+		for (size_t g = 0; g < num_groups; g++) {
+			const Float4 c = (x1[g] - xm1[g]) * half;
+			const Float4 v = x0[g] - x1[g];
+			const Float4 w = c + v;
+			const Float4 a = w + v + (x2[g] - x0[g]) * half;
+			const Float4 b_neg = w + a;
+			const Float4 y = (((a * t) - b_neg) * t + c) * t + x0[g];
+			y.store(dst + g * 4);
+		}
+		if (!full_groups) {
+			for (size_t i = 0; i < num_chans; i++)
+				out[out_frame * num_chans + i] = frame[i];
+		}
+
+		out_frame++;
+		frac_pos += _ratio;
+	}
+
+done:
+	for (size_t g = 0; g < num_groups; g++) {
+		xm1[g].store(&hist[0][g * 4]);
+		x0[g].store(&hist[1][g * 4]);
+		x1[g].store(&hist[2][g * 4]);
+		x2[g].store(&hist[3][g * 4]);
+	}
+	for (size_t i = 0; i < num_chans; i++) {
+		chans[i].frac_pos = frac_pos;
+		chans[i].xm1 = hist[0][i];
+		chans[i].x0 = hist[1][i];
+		chans[i].x1 = hist[2][i];
+		chans[i].x2 = hist[3][i];
+	}
+
+	return out_frame * num_chans;
+}
+
 ////////////////////////////////////////////////
 // ResamplingInterleavedBuffer
 //
@@ -62,20 +177,11 @@ private:
 template<size_t MaxChans, size_t MaxBlockSize, size_t MaxResampleRatio>
 class ResamplingInterleavedBuffer {
 public:
-	ResamplingInterleavedBuffer() {
-		core.set_input_stride(MaxChans);
-		core.set_output_stride(MaxChans);
-	}
+	ResamplingInterleavedBuffer() = default;
 
 	std::span<float> process_block(std::span<const float> input) {
-
 		auto output = std::span<float>{out_buff};
-		auto output_size = 0u;
-
-		for (auto chan = 0u; chan < MaxChans; chan++) {
-			output_size = core.process(chan, input, output);
-		}
-
+		auto output_size = core.process_interleaved(input, output);
 		return output.subspan(0, output_size);
 	}
 
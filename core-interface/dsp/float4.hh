@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace MetaModule
+{
+
+// Minimal 4-lane float vector for DSP kernels in the SDK.
+// On MetaModule this uses NEON intrinsics. GCC only emits NEON for generic
+// vector types when unsafe math optimizations are enabled, so the intrinsics
+// are used explicitly. Other platforms use the compiler's vector extensions.
+struct Float4 {
+#if defined(__ARM_NEON)
+	float32x4_t v;
+
+	static Float4 load(const float *p) {
+		return {vld1q_f32(p)};
+	}
+
+	static Float4 splat(float x) {
+		return {vdupq_n_f32(x)};
+	}
+
+	// Converts 4 integers to floats
+	static Float4 convert(const int32_t *p) {
+		return {vcvtq_f32_s32(vld1q_s32(p))};
+	}
+
+	static Float4 convert(const int16_t *p) {
+		return {vcvtq_f32_s32(vmovl_s16(vld1_s16(p)))};
+	}
+
+	void store(float *p) const {
+		vst1q_f32(p, v);
+	}
+
+	friend Float4 operator+(Float4 a, Float4 b) {
+		return {vaddq_f32(a.v, b.v)};
+	}
+
+	friend Float4 operator-(Float4 a, Float4 b) {
+		return {vsubq_f32(a.v, b.v)};
+	}
+
+	friend Float4 operator*(Float4 a, Float4 b) {
+		return {vmulq_f32(a.v, b.v)};
+	}
+
+#else
+	typedef float v4sf __attribute__((vector_size(16)));
+	v4sf v;
+
+	static Float4 load(const float *p) {
+		v4sf x;
+		__builtin_memcpy(&x, p, sizeof(x));
+		return {x};
+	}
+
+	static Float4 splat(float x) {
+		return {v4sf{x, x, x, x}};
+	}
+
+	// Converts 4 integers to floats
+	static Float4 convert(const int32_t *p) {
+		typedef int32_t v4si __attribute__((vector_size(16)));
+		v4si x;
+		__builtin_memcpy(&x, p, sizeof(x));
+		return {__builtin_convertvector(x, v4sf)};
+	}
+
+	static Float4 convert(const int16_t *p) {
+		typedef int16_t v4hi __attribute__((vector_size(8)));
+		v4hi x;
+		__builtin_memcpy(&x, p, sizeof(x));
+		return {__builtin_convertvector(x, v4sf)};
+	}
+
+	void store(float *p) const {
+		__builtin_memcpy(p, &v, sizeof(v));
+	}
+
+	friend Float4 operator+(Float4 a, Float4 b) {
+		return {a.v + b.v};
+	}
+
+	friend Float4 operator-(Float4 a, Float4 b) {
+		return {a.v - b.v};
+	}
+
+	friend Float4 operator*(Float4 a, Float4 b) {
+		return {a.v * b.v};
+	}
+#endif
+};
+
+} // namespace MetaModule
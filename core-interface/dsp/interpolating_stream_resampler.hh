@@ -0,0 +1,137 @@
+#pragma once
+#include "dsp/interpolation.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace MetaModule
+{
+
+// StreamResampler with a compile-time selectable interpolation kernel.
+// See dsp/interpolation.hh for the kernels:
+//
+//     InterpolatingStreamResampler<Interpolation::Linear>   // cheapest
+//     InterpolatingStreamResampler<Interpolation::Hermite>  // same as StreamResampler
+//     InterpolatingStreamResampler<Interpolation::Sinc6>
+//     InterpolatingStreamResampler<Interpolation::Sinc8>    // best quality
+//
+// The interface is the same as StreamResampler (see dsp/stream_resampler.hh).
+// This class is header-only, so it does not depend on the firmware version.
+template<typename Interp = Interpolation::Hermite, size_t MaxChannels = 8>
+class InterpolatingStreamResampler {
+public:
+	static constexpr unsigned Points = Interp::Points;
+
+	InterpolatingStreamResampler(uint32_t num_channels = 2) {
+		set_num_channels(num_channels);
+	}
+
+	// Calls get_input() the minimum number of times needed to produce one
+	// frame of audio, and writes the frame to output.
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	void process(F &&get_input, std::span<float> output) {
+		if (should_flush) {
+			for (auto &chan : chans)
+				chan = {};
+			frac_pos = 1.f;
+			should_flush = false;
+		}
+
+		while (frac_pos >= 1.f) {
+			frac_pos -= 1.f;
+			for (auto i = 0u; i < num_chans; i++)
+				chans[i].push(get_input());
+		}
+
+		auto n = std::min<size_t>(output.size(), num_chans);
+		for (size_t i = 0; i < n; i++)
+			output[i] = interp.interpolate(chans[i].history(), frac_pos);
+
+		frac_pos += ratio;
+	}
+
+	// Reads input samples from a buffer, using 0 if the buffer runs out.
+	// Returns the number of samples read from `input`.
+	size_t process(std::span<const float> input, std::span<float> output) {
+		size_t pos = 0;
+		process([&] { return pos < input.size() ? input[pos++] : 0.f; }, output);
+		return pos;
+	}
+
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	std::pair<float, float> process_stereo(F &&get_input) {
+		float out[2]{};
+		process(get_input, out);
+		return num_chans == 1 ? std::pair{out[0], out[0]} : std::pair{out[0], out[1]};
+	}
+
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	float process_mono(F &&get_input) {
+		if (num_chans != 1)
+			return 0;
+
+		float out[1]{};
+		process(get_input, out);
+		return out[0];
+	}
+
+	void set_num_channels(unsigned num_channels) {
+		num_chans = std::clamp<unsigned>(num_channels, 1, MaxChannels);
+	}
+
+	void set_sample_rate_in_out(uint32_t input_rate, uint32_t output_rate) {
+		if (input_rate == 0 || output_rate == 0)
+			return;
+
+		auto new_ratio = float(input_rate) / float(output_rate);
+		if (new_ratio != ratio) {
+			ratio = new_ratio;
+			if constexpr (requires { interp.set_ratio(ratio); })
+				interp.set_ratio(ratio);
+			should_flush = true;
+		}
+	}
+
+	float resample_ratio() const {
+		return ratio;
+	}
+
+	void flush() {
+		should_flush = true;
+	}
+
+private:
+	Interp interp{};
+	float ratio = 1;
+	bool should_flush{true};
+	float frac_pos{};
+
+	// Each sample is written twice, so the last Points samples are always
+	// contiguous in memory without shifting the history.
+	struct Channel {
+		std::array<float, Points * 2> buf{};
+		unsigned pos = 0;
+
+		void push(float x) {
+			buf[pos] = x;
+			buf[pos + Points] = x;
+			if (++pos == Points)
+				pos = 0;
+		}
+
+		const float *history() const {
+			return &buf[pos];
+		}
+	};
+
+	std::array<Channel, MaxChannels> chans{};
+	unsigned num_chans = 0;
+};
+
+} // namespace MetaModule
@@ -0,0 +1,203 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace MetaModule::Interpolation
+{
+
+// Interpolation kernels for InterpolatingStreamResampler.
+//
+// Each kernel reads `Points` consecutive samples, oldest first, and returns
+// the value at fraction `t` (0 <= t < 1) of the way between
+// x[Points / 2 - 1] and x[Points / 2].
+// Kernels which filter differently depending on the resample ratio also have
+// set_ratio(), which the resampler calls whenever the ratio changes.
+
+// 2-point linear interpolation. Cheapest, but has the most aliasing.
+struct Linear {
+	static constexpr unsigned Points = 2;
+
+	static float interpolate(const float *x, float t) {
+		return x[0] + (x[1] - x[0]) * t;
+	}
+};
+
+// 4-point, 3rd-order Hermite interpolation (x-form).
+// This is the same kernel used by StreamResampler and BlockResampler.
+struct Hermite {
+	static constexpr unsigned Points = 4;
+
+	static float interpolate(const float *x, float t) {
+		const float c = (x[2] - x[0]) * 0.5f;
+		const float v = x[1] - x[2];
+		const float w = c + v;
+		const float a = w + v + (x[3] - x[1]) * 0.5f;
+		const float b_neg = w + a;
+		return (((a * t) - b_neg) * t + c) * t + x[1];
+	}
+};
+
+namespace Detail
+{
+constexpr double Pi = 3.14159265358979323846;
+
+// constexpr sin(), since std::sin is not constexpr in C++20
+constexpr double sin(double x) {
+	// Reduce to [-pi, pi]
+	const auto turns = static_cast<long long>(x / (2 * Pi));
+	x -= double(turns) * 2 * Pi;
+	if (x > Pi)
+		x -= 2 * Pi;
+	else if (x < -Pi)
+		x += 2 * Pi;
+
+	double term = x;
+	double sum = x;
+	for (int n = 1; n < 16; n++) {
+		term *= -x * x / double((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double cos(double x) {
+	return sin(x + Pi / 2);
+}
+} // namespace Detail
+
+// Windowed-sinc (Blackman window) interpolation with precomputed polyphase
+// tables. The output is interpolated linearly between the two nearest phases.
+//
+// Cutoff is the lowpass cutoff as a fraction of the input Nyquist frequency.
+// A cutoff a little below 1 leaves room for the transition band of the short
+// kernel, which suppresses the interpolation images.
+//
+// When pitching up (input rate > output rate), the cutoff must also be below
+// the output Nyquist frequency, or source material above it will alias. So
+// there is a band for each ratio in BandRatios, with the cutoff divided by
+// that ratio and the kernel stretched to NumPoints * ratio taps. set_ratio()
+// picks the first band at or above the resample ratio, so the cost per input
+// sample stays about the same. Ratios above the last band alias a little.
+//
+// Points is the number of taps in the widest band, so the resampler's latency
+// is Points / 2 input samples at any ratio. The stretched kernels are
+// smoother and need fewer phases, so each band's table is about
+// (Phases + 1) * NumPoints floats: about 60kB in total for Sinc8.
+template<unsigned NumPoints, unsigned Phases = 256, unsigned CutoffPercent = 90>
+struct WindowedSinc {
+	static_assert(NumPoints % 2 == 0 && NumPoints >= 4, "WindowedSinc must have an even number of points, at least 4");
+	// Power of 2, so t * phases is exact and never reaches phases
+	static_assert(Phases > 0 && (Phases & (Phases - 1)) == 0, "WindowedSinc Phases must be a power of 2");
+
+	static constexpr std::array<float, 6> BandRatios = {1.f, 1.25f, 1.5f, 2.f, 3.f, 4.f};
+
+	struct Band {
+		unsigned taps;
+		unsigned phases;
+		unsigned offset; // Index of the band's first coefficient in coefs
+	};
+
+	static constexpr std::array<Band, BandRatios.size()> make_bands() {
+		std::array<Band, BandRatios.size()> bands{};
+		unsigned offset = 0;
+		for (unsigned i = 0; i < bands.size(); i++) {
+			const double ratio = BandRatios[i];
+
+			// Round up to an even number of taps
+			auto taps = unsigned(NumPoints * ratio);
+			if (taps < NumPoints * ratio)
+				taps++;
+			taps += taps % 2;
+
+			unsigned phases = Phases;
+			while (phases > 1 && phases / 2 >= Phases / ratio)
+				phases /= 2;
+
+			bands[i] = {taps, phases, offset};
+			offset += (phases + 1) * taps;
+		}
+		return bands;
+	}
+
+	static constexpr std::array<Band, BandRatios.size()> bands = make_bands();
+
+	static constexpr unsigned Points = bands.back().taps;
+	static constexpr unsigned NumCoefs = bands.back().offset + (bands.back().phases + 1) * Points;
+
+	static constexpr std::array<float, NumCoefs> make_coefs() {
+		std::array<float, NumCoefs> coefs{};
+		for (unsigned i = 0; i < bands.size(); i++) {
+			const auto &band = bands[i];
+			const double cutoff = CutoffPercent / 100. / BandRatios[i];
+			const double half_width = NumPoints / 2 * double(BandRatios[i]);
+
+			for (unsigned phase = 0; phase <= band.phases; phase++) {
+				const double t = double(phase) / band.phases;
+				float *row = &coefs[band.offset + phase * band.taps];
+
+				double sum = 0;
+				std::array<double, Points> row_coefs{};
+				for (unsigned k = 0; k < band.taps; k++) {
+					// Distance from tap k to the interpolation point
+					const double d = double(k) - double(band.taps / 2 - 1) - t;
+
+					const double x = Detail::Pi * cutoff * d;
+					const double sinc = (d == 0) ? 1 : Detail::sin(x) / x;
+
+					const double r = d / half_width;
+					const double window =
+						(r <= -1 || r >= 1) ?
+							0 :
+							0.42 + 0.5 * Detail::cos(Detail::Pi * r) + 0.08 * Detail::cos(2 * Detail::Pi * r);
+
+					row_coefs[k] = sinc * window;
+					sum += row_coefs[k];
+				}
+
+				// Normalize each phase for unity gain at DC
+				for (unsigned k = 0; k < band.taps; k++)
+					row[k] = float(row_coefs[k] / sum);
+			}
+		}
+		return coefs;
+	}
+
+	static constexpr std::array<float, NumCoefs> coefs = make_coefs();
+
+	// ratio is the input rate / output rate
+	void set_ratio(float ratio) {
+		unsigned i = 0;
+		while (i < BandRatios.size() - 1 && BandRatios[i] < ratio)
+			i++;
+		band = &bands[i];
+	}
+
+	float interpolate(const float *x, float t) const {
+		const float pos = t * band->phases;
+		const auto phase = static_cast<unsigned>(pos);
+		const float phase_frac = pos - float(phase);
+
+		const unsigned taps = band->taps;
+		const float *c0 = &coefs[band->offset + phase * taps];
+		const float *c1 = c0 + taps;
+
+		// Narrower bands use the taps in the middle of the history
+		x += Points / 2 - taps / 2;
+
+		float y0 = 0;
+		float y1 = 0;
+		for (unsigned k = 0; k < taps; k++) {
+			y0 += x[k] * c0[k];
+			y1 += x[k] * c1[k];
+		}
+		return y0 + (y1 - y0) * phase_frac;
+	}
+
+private:
+	const Band *band = &bands[0];
+};
+
+using Sinc6 = WindowedSinc<6>;
+using Sinc8 = WindowedSinc<8>;
+
+} // namespace MetaModule::Interpolation
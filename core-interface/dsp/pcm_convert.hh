@@ -0,0 +1,56 @@
+#pragma once
+#include "dsp/float4.hh"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace MetaModule
+{
+
+// Integer PCM to float conversion, 4 samples at a time.
+// The output is bit-identical to dr_wav's drwav_s16_to_f32() and
+// drwav_s24_to_f32(): the integers are exactly representable as floats, and
+// the scaling is by a power of 2, so there is no rounding.
+
+// Signed 16-bit samples to floats in the range -1 to +1
+inline void convert_s16_to_f32(std::span<const int16_t> in, std::span<float> out) {
+	constexpr float Scale = 1.f / 32768.f;
+	const auto n = std::min(in.size(), out.size());
+	const auto scale = Float4::splat(Scale);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+		(Float4::convert(&in[i]) * scale).store(&out[i]);
+
+	for (; i < n; i++)
+		out[i] = float(in[i]) * Scale;
+}
+
+// Unpacks one little-endian, packed signed 24-bit sample
+inline int32_t unpack_s24(const uint8_t *p) {
+	return int32_t(uint32_t(p[0]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 24) >> 8;
+}
+
+// Packed little-endian signed 24-bit samples (3 bytes each) to floats in the range -1 to +1.
+// `in` is the number of bytes, so out.size() should be in.size() / 3
+inline void convert_s24_to_f32(std::span<const uint8_t> in, std::span<float> out) {
+	constexpr float Scale = 1.f / 8388608.f;
+	const auto n = std::min(in.size() / 3, out.size());
+	const auto scale = Float4::splat(Scale);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const int32_t x[4] = {
+			unpack_s24(&in[i * 3]),
+			unpack_s24(&in[i * 3 + 3]),
+			unpack_s24(&in[i * 3 + 6]),
+			unpack_s24(&in[i * 3 + 9]),
+		};
+		(Float4::convert(x) * scale).store(&out[i]);
+	}
+
+	for (; i < n; i++)
+		out[i] = float(unpack_s24(&in[i * 3])) * Scale;
+}
+
+} // namespace MetaModule
@@ -1,7 +1,11 @@
 #pragma once
 #include "util/callable.hh"
 #include "util/fixed_vector.hh"
+#include <algorithm>
 #include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
 
 namespace MetaModule
 {
@@ -39,6 +43,21 @@ public:
 
 	void process(Function<float(void)> &&get_input, std::span<float> output);
 
+	// Same as above, but get_input is called directly rather than through a
+	// Function, so it can be inlined. This is chosen automatically when you
+	// pass a lambda.
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	void process(F &&get_input, std::span<float> output);
+
+	// Same as above, but reads the input samples from a buffer.
+	// If `input` runs out of samples then 0 is used for the missing samples.
+	// Returns the number of samples that were read from `input`.
+	//  Usage:
+	//     auto num_read = process(input, output);
+	//     input = input.subspan(num_read);
+	size_t process(std::span<const float> input, std::span<float> output);
+
 	// process_stereo():
 	//  A helper shortcut for calling process() when you have a mono or stereo
 	//  input and you need a stereo output.
@@ -50,6 +69,10 @@ public:
 	//
 	std::pair<float, float> process_stereo(Function<float(void)> &&get_input);
 
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	std::pair<float, float> process_stereo(F &&get_input);
+
 	// process_mono():
 	//   A helper shortcut for calling process() when you have a mono stream.
 	//   Returns a float. If the stream is not mono, this will always return 0.
@@ -57,6 +80,10 @@ public:
 	//       float out = process_mono([this] { return stream.pop_sample(); });
 	float process_mono(Function<float()> &&get_input);
 
+	template<typename F>
+		requires std::is_invocable_r_v<float, F &>
+	float process_mono(F &&get_input);
+
 	// set_num_channels():
 	//   Sets the number of active channels. E.g. 1 = mono, 2 = stereo, etc.
 	//   Value will be clamped to 1, MAX_CHANNELS (which is 8)
@@ -97,6 +124,70 @@ private:
 	FixedVector<Channel, MAX_CHANNELS> chans;
 
 	size_t num_chans = 0;
+
+	// 4-point, 3rd-order Hermite interpolation (x-form)
+	static float hermite(float xm1, float x0, float x1, float x2, float t) {
+		const float c = (x1 - xm1) * 0.5f;
+		const float v = x0 - x1;
+		const float w = c + v;
+		const float a = w + v + (x2 - x0) * 0.5f;
+		const float b_neg = w + a;
+		return (((a * t) - b_neg) * t + c) * t + x0;
+	}
 };
 
+template<typename F>
+	requires std::is_invocable_r_v<float, F &>
+inline void StreamResampler::process(F &&get_input, std::span<float> output) {
+	if (should_flush) {
+		for (auto &chan : chans)
+			chan = {};
+		frac_pos = 1.f;
+		should_flush = false;
+	}
+
+	while (frac_pos >= 1.f) {
+		frac_pos -= 1.f;
+		for (auto &chan : chans) {
+			chan.xm1 = chan.x0;
+			chan.x0 = chan.x1;
+			chan.x1 = chan.x2;
+			chan.x2 = get_input();
+		}
+	}
+
+	auto n = std::min<size_t>(output.size(), num_chans);
+	for (size_t i = 0; i < n; i++) {
+		auto &chan = chans[i];
+		output[i] = hermite(chan.xm1, chan.x0, chan.x1, chan.x2, frac_pos);
+	}
+
+	frac_pos += ratio;
+}
+
+inline size_t StreamResampler::process(std::span<const float> input, std::span<float> output) {
+	size_t pos = 0;
+	process([&] { return pos < input.size() ? input[pos++] : 0.f; }, output);
+	return pos;
+}
+
+template<typename F>
+	requires std::is_invocable_r_v<float, F &>
+inline std::pair<float, float> StreamResampler::process_stereo(F &&get_input) {
+	float out[2]{};
+	process(get_input, out);
+	return num_chans == 1 ? std::pair{out[0], out[0]} : std::pair{out[0], out[1]};
+}
+
+template<typename F>
+	requires std::is_invocable_r_v<float, F &>
+inline float StreamResampler::process_mono(F &&get_input) {
+	if (num_chans != 1)
+		return 0;
+
+	float out[1]{};
+	process(get_input, out);
+	return out[0];
+}
+
 } // namespace MetaModule
@@ -0,0 +1,149 @@
+#pragma once
+#include "filesystem/file_seek.hh"
+#include "threads/async_task.hh"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace MetaModule
+{
+
+// AsyncFile reads and writes files in chunks from an AsyncTask.
+// read() and write() do one chunk of disk access each time the task is
+// stepped, so a large file is loaded over many runs of the AsyncThread
+// instead of blocking it (and the GUI, or other modules' AsyncThreads) for
+// the whole time.
+//
+// Usage (inside a coroutine that returns an AsyncTask):
+//     AsyncFile file;
+//     if (file.open("sdc:/wavetable.raw")) {
+//         std::vector<float> table(file.size() / sizeof(float));
+//         auto num_read = co_await file.read(std::span{table});
+//     }
+//
+// open(), seek() and close() are done immediately.
+// See threads/async_task.hh for how to run the task.
+class AsyncFile {
+public:
+	static constexpr size_t DefaultChunkSize = 16 * 1024;
+
+	AsyncFile(size_t chunk_size = DefaultChunkSize)
+		: chunk_size{std::max<size_t>(chunk_size, 1)} {
+	}
+
+	~AsyncFile() {
+		close();
+	}
+
+	AsyncFile(AsyncFile const &) = delete;
+	AsyncFile &operator=(AsyncFile const &) = delete;
+
+	// mode is the same as fopen(): "rb", "wb", etc.
+	bool open(std::string_view path, const char *mode = "rb") {
+		close();
+		fp = std::fopen(std::string{path}.c_str(), mode);
+		return fp != nullptr;
+	}
+
+	void close() {
+		if (fp) {
+			std::fclose(fp);
+			fp = nullptr;
+		}
+	}
+
+	bool is_open() const {
+		return fp != nullptr;
+	}
+
+	// Size of the file in bytes
+	size_t size() {
+		if (!fp)
+			return 0;
+		auto pos = std::ftell(fp);
+		std::fseek(fp, 0, SEEK_END);
+		auto end = std::ftell(fp);
+		std::fseek(fp, pos, SEEK_SET);
+		return end < 0 ? 0 : size_t(end);
+	}
+
+	// Returns false if the offset is past what fseek() can reach (2GB on MetaModule)
+	bool seek(uint64_t offset) {
+		return Filesystem::seek_to(fp, offset);
+	}
+
+	size_t tell() const {
+		if (!fp)
+			return 0;
+		auto pos = std::ftell(fp);
+		return pos < 0 ? 0 : size_t(pos);
+	}
+
+	// Reads into `dst`, yielding after each chunk.
+	// Returns the number of whole elements read, which is less than dst.size()
+	// if the end of the file was reached or there was an error.
+	template<typename T, size_t Extent>
+		requires std::is_trivially_copyable_v<T>
+	AsyncTask<size_t> read(std::span<T, Extent> dst) {
+		auto bytes = std::as_writable_bytes(dst);
+		size_t total = 0;
+
+		while (fp && total < bytes.size()) {
+			auto len = std::min(chunk_size, bytes.size() - total);
+			auto num_read = std::fread(bytes.data() + total, 1, len, fp);
+			total += num_read;
+			if (num_read < len)
+				break;
+			if (total < bytes.size())
+				co_await async_yield();
+		}
+
+		co_return total / sizeof(T);
+	}
+
+	// Writes `src`, yielding after each chunk.
+	// Returns the number of whole elements written.
+	template<typename T, size_t Extent>
+		requires std::is_trivially_copyable_v<T>
+	AsyncTask<size_t> write(std::span<const T, Extent> src) {
+		auto bytes = std::as_bytes(src);
+		size_t total = 0;
+
+		while (fp && total < bytes.size()) {
+			auto len = std::min(chunk_size, bytes.size() - total);
+			auto num_written = std::fwrite(bytes.data() + total, 1, len, fp);
+			total += num_written;
+			if (num_written < len)
+				break;
+			if (total < bytes.size())
+				co_await async_yield();
+		}
+
+		co_return total / sizeof(T);
+	}
+
+	template<typename T, size_t Extent>
+		requires std::is_trivially_copyable_v<T> && (!std::is_const_v<T>)
+	AsyncTask<size_t> write(std::span<T, Extent> src) {
+		return write(std::span<const T, Extent>{src});
+	}
+
+	size_t chunk_bytes() const {
+		return chunk_size;
+	}
+
+	void set_chunk_bytes(size_t bytes) {
+		chunk_size = std::max<size_t>(bytes, 1);
+	}
+
+private:
+	std::FILE *fp = nullptr;
+	size_t chunk_size;
+};
+
+} // namespace MetaModule
@@ -0,0 +1,212 @@
+#pragma once
+#include "filesystem/file_seek.hh"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <type_traits>
+#include <vector>
+
+namespace MetaModule
+{
+
+namespace Filesystem
+{
+
+// Most SD cards are formatted (FAT32 or exFAT) with 32kB clusters
+constexpr size_t DefaultClusterSize = 32 * 1024;
+
+// Returns the size of a cluster (allocation unit) on the volume with the file,
+// as reported by stat(). If the size is not reported, returns the default.
+inline size_t cluster_size(std::string_view path, size_t default_size = DefaultClusterSize) {
+	struct stat st {};
+	if (::stat(std::string{path}.c_str(), &st) != 0)
+		return default_size;
+
+	size_t size = st.st_blksize;
+	bool is_pow2 = size && (size & (size - 1)) == 0;
+	return (is_pow2 && size >= 512) ? size : default_size;
+}
+
+} // namespace Filesystem
+
+// BufferedFileReader reads a file from disk only in whole clusters, starting
+// on a cluster boundary, several clusters at a time. Reads of any size and
+// alignment are then copied from its buffer.
+//
+// On a FAT volume, each read from the disk that's not aligned to a cluster,
+// or is smaller than a cluster, costs nearly as much as reading the whole
+// cluster. So reading (for example) 1000 bytes at a time from a wav file
+// is much slower than reading 128kB at a time and copying from RAM.
+//
+// Usage (from an AsyncThread):
+//     BufferedFileReader reader;
+//     reader.open("sdc:/samples/long.wav");
+//     reader.seek(data_start);
+//     auto num = reader.read(std::span{samples});
+//
+// The buffer is allocated by open(), so don't call it from the audio thread.
+class BufferedFileReader {
+public:
+	// The buffer holds this many clusters
+	BufferedFileReader(unsigned clusters_per_read = 4)
+		: clusters_per_read{std::max(clusters_per_read, 1u)} {
+	}
+
+	~BufferedFileReader() {
+		close();
+	}
+
+	BufferedFileReader(BufferedFileReader const &) = delete;
+	BufferedFileReader &operator=(BufferedFileReader const &) = delete;
+
+	// cluster_bytes: 0 means use the volume's cluster size
+	bool open(std::string_view path, size_t cluster_bytes = 0) {
+		close();
+
+		fp = std::fopen(std::string{path}.c_str(), "rb");
+		if (!fp)
+			return false;
+
+		// This does its own buffering, so turn off the buffering in stdio
+		std::setvbuf(fp, nullptr, _IONBF, 0);
+
+		cluster = cluster_bytes ? cluster_bytes : Filesystem::cluster_size(path);
+		buffer.resize(cluster * clusters_per_read);
+
+		std::fseek(fp, 0, SEEK_END);
+		auto end = std::ftell(fp);
+		file_size = end < 0 ? 0 : uint64_t(end);
+		std::fseek(fp, 0, SEEK_SET);
+
+		file_pos = 0;
+		pos = 0;
+		buf_start = 0;
+		buf_len = 0;
+		num_disk_reads = 0;
+		return true;
+	}
+
+	void close() {
+		if (fp) {
+			std::fclose(fp);
+			fp = nullptr;
+		}
+	}
+
+	bool is_open() const {
+		return fp != nullptr;
+	}
+
+	// Reads the next dst.size() bytes (or less, at the end of the file).
+	// Returns the number of bytes read.
+	size_t read(std::span<std::byte> dst) {
+		size_t total = 0;
+
+		while (fp && total < dst.size() && pos < file_size) {
+			// Copy what's in the buffer
+			if (pos >= buf_start && pos < buf_start + buf_len) {
+				auto offset = pos - buf_start;
+				auto len = std::min<size_t>(buf_len - offset, dst.size() - total);
+				std::memcpy(dst.data() + total, buffer.data() + offset, len);
+				total += len;
+				pos += len;
+				continue;
+			}
+
+			auto remaining = dst.size() - total;
+
+			// Large aligned reads go straight to the destination, in whole clusters
+			if (pos % cluster == 0 && remaining >= buffer.size()) {
+				auto len = remaining - remaining % cluster;
+				auto num = disk_read(pos, dst.data() + total, len);
+				total += num;
+				pos += num;
+				if (num < len)
+					break;
+				continue;
+			}
+
+			// Fill the buffer, starting at the cluster with the read position
+			buf_start = pos - pos % cluster;
+			buf_len = disk_read(buf_start, buffer.data(), buffer.size());
+			if (pos >= buf_start + buf_len)
+				break;
+		}
+
+		return total;
+	}
+
+	// Reads whole elements into `dst`. Returns the number of elements read.
+	template<typename T, size_t Extent>
+		requires std::is_trivially_copyable_v<T> && (!std::is_same_v<T, std::byte> || Extent != std::dynamic_extent)
+	size_t read(std::span<T, Extent> dst) {
+		return read(std::span<std::byte>{std::as_writable_bytes(dst)}) / sizeof(T);
+	}
+
+	// Moves the read position. Data is not read until the next call to read().
+	bool seek(uint64_t offset) {
+		if (!fp || offset > file_size)
+			return false;
+		pos = offset;
+		return true;
+	}
+
+	uint64_t tell() const {
+		return pos;
+	}
+
+	uint64_t size() const {
+		return file_size;
+	}
+
+	bool is_eof() const {
+		return pos >= file_size;
+	}
+
+	size_t cluster_bytes() const {
+		return cluster;
+	}
+
+	size_t buffer_bytes() const {
+		return buffer.size();
+	}
+
+	// Number of reads from the disk since the file was opened
+	unsigned disk_read_count() const {
+		return num_disk_reads;
+	}
+
+private:
+	std::FILE *fp = nullptr;
+	unsigned clusters_per_read;
+	size_t cluster = Filesystem::DefaultClusterSize;
+	std::vector<std::byte> buffer;
+
+	uint64_t file_size = 0;
+	uint64_t file_pos = 0; // position of the FILE
+	uint64_t pos = 0;	   // position of the next read()
+	uint64_t buf_start = 0;
+	size_t buf_len = 0;
+	unsigned num_disk_reads = 0;
+
+	size_t disk_read(uint64_t offset, std::byte *dst, size_t len) {
+		if (offset != file_pos) {
+			if (!Filesystem::seek_to(fp, offset))
+				return 0;
+			file_pos = offset;
+		}
+
+		auto num = std::fread(dst, 1, len, fp);
+		file_pos += num;
+		num_disk_reads++;
+		return num;
+	}
+};
+
+} // namespace MetaModule
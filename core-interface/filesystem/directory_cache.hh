@@ -0,0 +1,295 @@
+#pragma once
+#include "threads/spin_lock.hh"
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <vector>
+
+#if defined(METAMODULE) && !defined(METAMODULE_HOST)
+#include "filesystem/dirent.h"
+#else
+#include <dirent.h>
+#endif
+
+namespace MetaModule
+{
+
+struct DirEntry {
+	std::string name;
+	bool is_dir = false;
+};
+
+// DirectoryCache keeps the listings of directories in RAM, so that a module
+// which shows the files in a directory (for example a sample library with
+// thousands of files) doesn't have to read the directory from disk each time.
+//
+// Reading a large directory can take seconds, so it's done incrementally:
+// each call to scan() reads a limited number of entries and returns.
+// Call it from an AsyncThread until it returns true:
+//
+//     AsyncThread lister{this, [this] {
+//         auto &dirs = DirectoryCache::shared();
+//         if (dirs.scan("usb:/samples")) {
+//             if (auto entries = dirs.list("usb:/samples", "wav, WAV")) {
+//                 files = std::move(*entries);
+//                 lister.stop();
+//             }
+//         }
+//     }};
+//
+// A listing is read again if the directory's modification time changes, or
+// after invalidate() is called with a prefix of its path (for example,
+// invalidate("usb:") when a USB drive is removed). FAT filesystems don't
+// always update a directory's modification time when a file is added, so
+// call invalidate() with the directory after writing a file to it.
+//
+// The cache is shared between threads with a SpinLock, which gives up if it's
+// held for too long. When that happens, the functions return "busy" results
+// (false, std::nullopt or State::Busy), and should be called again later.
+//
+// The cache is header-only, so there is one cache per plugin, shared by all
+// the modules in the plugin.
+class DirectoryCache {
+public:
+	// The cache instance that's shared between all modules in the plugin
+	static DirectoryCache &shared() {
+		static DirectoryCache cache;
+		return cache;
+	}
+
+	// Reads up to max_entries more entries of the directory.
+	// Returns true when the listing is complete (either now, or because it
+	// was already cached and the directory hasn't changed).
+	// Returns false if there's more to read, if another thread is reading it,
+	// or if the directory doesn't exist.
+	// This reads from disk: do not call it from the audio thread.
+	bool scan(std::string_view path, unsigned max_entries = 64) {
+		auto dir_path = normalize(path);
+
+		struct stat st {};
+		bool exists = ::stat(dir_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+
+		// Declared before the guard, so removed listings are destroyed
+		// (which may close the directory) after the lock is released
+		std::vector<std::shared_ptr<Listing>> removed;
+		std::shared_ptr<Listing> listing;
+
+		if (auto guard = SpinLockGuard{lock}) {
+			listing = find(dir_path);
+
+			if (listing && (!exists || listing->mtime != st.st_mtime)) {
+				take_if([&dir_path](Listing const &l) { return l.path == dir_path; }, removed);
+				listing = nullptr;
+			}
+
+			if (!exists)
+				return false;
+
+			if (!listing) {
+				listing = std::make_shared<Listing>();
+				listing->path = dir_path;
+				listing->mtime = st.st_mtime;
+				listings.push_back(listing);
+			}
+		} else
+			return false;
+
+		if (listing->complete.load(std::memory_order_acquire))
+			return true;
+
+		// Only one thread reads a directory at a time.
+		// Until the listing is complete, only that thread accesses the entries.
+		bool already_scanning = false;
+		if (!listing->scanning.compare_exchange_strong(already_scanning, true))
+			return false;
+
+		bool finished = read_entries(*listing, max_entries);
+		if (finished) {
+			std::ranges::sort(listing->entries, {}, &DirEntry::name);
+			listing->complete.store(true, std::memory_order_release);
+		}
+
+		listing->scanning.store(false, std::memory_order_release);
+		return finished;
+	}
+
+	enum class State { NotCached, Cached, Busy };
+
+	// Whether the directory has been completely read into the cache.
+	// Busy means the cache couldn't be checked right now: try again later.
+	State state(std::string_view path) {
+		auto [listing, busy] = find_listing(path);
+		if (busy)
+			return State::Busy;
+		return listing && listing->complete.load(std::memory_order_acquire) ? State::Cached : State::NotCached;
+	}
+
+	// Returns the cached entries of a directory that match the filter, sorted by name.
+	// Returns std::nullopt if the directory is not cached yet (call scan()), or
+	// if the cache is busy (try again later).
+	//
+	// The filter has the same format as async_open_file()'s filter_extension_list:
+	// a comma-separated list of extensions ("wav, WAV, raw"). An empty filter
+	// or one containing "*.*" matches all files, and "*/" matches only directories.
+	// Directories are always included unless the filter is "*/".
+	std::optional<std::vector<DirEntry>> list(std::string_view path, std::string_view filter = "") {
+		// A complete listing is never modified, so it's read without the lock
+		auto listing = find_listing(path).listing;
+		if (!listing || !listing->complete.load(std::memory_order_acquire))
+			return std::nullopt;
+
+		std::vector<DirEntry> result;
+		for (auto const &entry : listing->entries) {
+			if (matches(entry, filter))
+				result.push_back(entry);
+		}
+
+		return result;
+	}
+
+	// Removes all cached listings with paths that start with `prefix`
+	// (for example a volume name like "usb:", when the drive is removed).
+	// Returns false if the cache is busy: try again later.
+	bool invalidate(std::string_view prefix = "") {
+		std::vector<std::shared_ptr<Listing>> removed;
+
+		if (auto guard = SpinLockGuard{lock}) {
+			take_if([prefix](Listing const &l) { return std::string_view{l.path}.starts_with(prefix); }, removed);
+			return true;
+		}
+		return false;
+	}
+
+	// Returns true if the entry's name ends in one of the extensions in the filter
+	static bool matches(DirEntry const &entry, std::string_view filter) {
+		if (filter == "*/")
+			return entry.is_dir;
+
+		if (entry.is_dir || filter.empty() || filter.find("*.*") != std::string_view::npos)
+			return true;
+
+		auto dot = entry.name.find_last_of('.');
+		if (dot == std::string::npos)
+			return false;
+		auto ext = std::string_view{entry.name}.substr(dot + 1);
+
+		while (!filter.empty()) {
+			auto comma = filter.find(',');
+			auto item = trim(filter.substr(0, comma));
+			if (item.starts_with("*"))
+				item.remove_prefix(1);
+			if (item.starts_with("."))
+				item.remove_prefix(1);
+			if (item == ext)
+				return true;
+			if (comma == std::string_view::npos)
+				break;
+			filter.remove_prefix(comma + 1);
+		}
+		return false;
+	}
+
+private:
+	struct Listing {
+		std::string path;
+		time_t mtime{};
+		std::vector<DirEntry> entries;
+		DIR *dir = nullptr;
+		std::atomic<bool> complete = false;
+		std::atomic<bool> scanning = false;
+
+		~Listing() {
+			if (dir)
+				closedir(dir);
+		}
+	};
+
+	std::vector<std::shared_ptr<Listing>> listings;
+
+protected:
+	SpinLock lock;
+
+private:
+
+	// `busy` is set if the lock couldn't be taken, so the cache wasn't searched
+	struct FindResult {
+		std::shared_ptr<Listing> listing;
+		bool busy;
+	};
+
+	FindResult find_listing(std::string_view path) {
+		auto dir_path = normalize(path);
+		if (auto guard = SpinLockGuard{lock})
+			return {find(dir_path), false};
+		return {nullptr, true};
+	}
+
+	std::shared_ptr<Listing> find(std::string const &path) {
+		for (auto &listing : listings) {
+			if (listing->path == path)
+				return listing;
+		}
+		return nullptr;
+	}
+
+	// Moves the listings that match `pred` out of the cache and into `removed`.
+	// Call with the lock held, and destroy `removed` after releasing it.
+	template<typename Pred>
+	void take_if(Pred pred, std::vector<std::shared_ptr<Listing>> &removed) {
+		for (auto &listing : listings) {
+			if (pred(*listing))
+				removed.push_back(std::move(listing));
+		}
+		std::erase(listings, nullptr);
+	}
+
+	// Returns true when the end of the directory is reached (or there's an error)
+	static bool read_entries(Listing &listing, unsigned max_entries) {
+		if (!listing.dir) {
+			listing.dir = opendir(listing.path.c_str());
+			if (!listing.dir)
+				return true;
+		}
+
+		for (unsigned i = 0; i < max_entries; i++) {
+			auto *ent = readdir(listing.dir);
+			if (!ent) {
+				closedir(listing.dir);
+				listing.dir = nullptr;
+				return true;
+			}
+
+			std::string_view name{ent->d_name};
+			if (name == "." || name == "..")
+				continue;
+
+			struct stat st {};
+			auto full_path = listing.path + (listing.path.ends_with('/') ? "" : "/") + ent->d_name;
+			bool is_dir = ::stat(full_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+			listing.entries.push_back({std::string{name}, is_dir});
+		}
+
+		return false;
+	}
+
+	static std::string normalize(std::string_view path) {
+		while (path.size() > 1 && path.ends_with('/') && !path.ends_with(":/"))
+			path.remove_suffix(1);
+		return std::string{path};
+	}
+
+	static std::string_view trim(std::string_view s) {
+		while (!s.empty() && s.front() == ' ')
+			s.remove_prefix(1);
+		while (!s.empty() && s.back() == ' ')
+			s.remove_suffix(1);
+		return s;
+	}
+};
+
+} // namespace MetaModule
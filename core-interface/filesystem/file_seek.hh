@@ -0,0 +1,19 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+
+namespace MetaModule::Filesystem
+{
+
+// Moves a FILE to an absolute position.
+// fseek() takes a long, which is 32 bits on MetaModule, so positions past
+// LONG_MAX (2GB) can't be reached with it. Returns false for those instead of
+// seeking to a truncated position.
+inline bool seek_to(std::FILE *fp, uint64_t offset) {
+	if (!fp || offset > uint64_t(LONG_MAX))
+		return false;
+	return std::fseek(fp, long(offset), SEEK_SET) == 0;
+}
+
+} // namespace MetaModule::Filesystem
@@ -0,0 +1,152 @@
+#include "filesystem/async_file.hh"
+#include "doctest.h"
+#include <array>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+AsyncTask<int> count_to(int n, int &progress) {
+	for (int i = 0; i < n; i++) {
+		progress = i;
+		co_await async_yield();
+	}
+	co_return n;
+}
+
+AsyncTask<int> sum_of_counts(int &progress) {
+	auto a = co_await count_to(2, progress);
+	auto b = co_await count_to(3, progress);
+	co_return a + b;
+}
+
+template<typename T>
+unsigned run_to_completion(AsyncTask<T> &task) {
+	unsigned steps = 1;
+	while (!task.step())
+		steps++;
+	return steps;
+}
+
+} // namespace
+
+TEST_CASE("AsyncTask runs one step at a time") {
+	int progress = -1;
+	auto task = count_to(3, progress);
+
+	// Does not start until stepped
+	CHECK(progress == -1);
+	CHECK_FALSE(task.is_done());
+
+	CHECK_FALSE(task.step());
+	CHECK(progress == 0);
+	CHECK_FALSE(task.step());
+	CHECK(progress == 1);
+	CHECK_FALSE(task.step());
+	CHECK(progress == 2);
+	CHECK(task.step());
+	CHECK(task.result() == 3);
+
+	// Stepping a finished task does nothing
+	CHECK(task.step());
+}
+
+TEST_CASE("AsyncTask can await other tasks") {
+	int progress = -1;
+	auto task = sum_of_counts(progress);
+
+	// 2 yields, then 3 yields, then one more step to finish
+	CHECK(run_to_completion(task) == 6);
+	CHECK(task.result() == 5);
+	CHECK(progress == 2);
+}
+
+TEST_CASE("AsyncTask can be destroyed before it finishes") {
+	int progress = -1;
+	{
+		auto task = sum_of_counts(progress);
+		task.step();
+		task.step();
+		task.step();
+		CHECK(progress == 0);
+	}
+	CHECK(progress == 0);
+}
+
+TEST_CASE("AsyncFile reads and writes in chunks") {
+	auto path = (std::filesystem::temp_directory_path() / "async_file_test.raw").string();
+
+	std::vector<float> data(10'000);
+	std::iota(data.begin(), data.end(), 0.f);
+	const size_t chunk = 4096;
+	const unsigned num_chunks = (data.size() * sizeof(float) + chunk - 1) / chunk;
+
+	auto write_file = [&]() -> AsyncTask<size_t> {
+		AsyncFile file{chunk};
+		if (!file.open(path, "wb"))
+			co_return 0;
+		co_return co_await file.write(std::span{data});
+	};
+
+	auto writer = write_file();
+	CHECK(run_to_completion(writer) == num_chunks);
+	CHECK(writer.result() == data.size());
+
+	std::vector<float> readback(data.size() + 100);
+
+	auto read_file = [&]() -> AsyncTask<size_t> {
+		AsyncFile file{chunk};
+		if (!file.open(path))
+			co_return 0;
+		CHECK(file.size() == data.size() * sizeof(float));
+		co_return co_await file.read(std::span{readback});
+	};
+
+	auto reader = read_file();
+	CHECK(run_to_completion(reader) == num_chunks);
+	CHECK(reader.result() == data.size());
+	readback.resize(reader.result());
+	CHECK(readback == data);
+
+	SUBCASE("Fixed-size spans") {
+		std::array<float, 4> first;
+		AsyncFile file;
+		REQUIRE(file.open(path));
+		auto task = file.read(std::span{first});
+		CHECK(task.step());
+		CHECK(task.result() == 4);
+		CHECK(first[3] == 3.f);
+	}
+
+	SUBCASE("Seeking") {
+		AsyncFile file;
+		REQUIRE(file.open(path));
+		CHECK(file.seek(8));
+		CHECK(file.tell() == 8);
+
+		// Past what fseek() can reach: the position is not changed
+		CHECK_FALSE(file.seek(uint64_t(LONG_MAX) + 1));
+		CHECK(file.tell() == 8);
+
+		std::array<float, 1> val;
+		auto task = file.read(std::span{val});
+		CHECK(task.step());
+		CHECK(val[0] == 2.f);
+	}
+
+	SUBCASE("Missing file") {
+		AsyncFile file;
+		CHECK_FALSE(file.open("does_not_exist.raw"));
+		auto task = file.read(std::span{readback});
+		CHECK(task.step());
+		CHECK(task.result() == 0);
+	}
+
+	std::remove(path.c_str());
+}
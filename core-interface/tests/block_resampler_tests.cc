@@ -0,0 +1,136 @@
+#include "dsp/block_resampler.hh"
+#include "doctest.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+// A different sine on each channel
+std::vector<float> test_block(unsigned chans, unsigned frames, unsigned first_frame) {
+	std::vector<float> block(chans * frames);
+	for (unsigned f = 0; f < frames; f++) {
+		for (unsigned c = 0; c < chans; c++)
+			block[f * chans + c] = std::sin(float(first_frame + f) * (0.05f + 0.03f * c) + float(c));
+	}
+	return block;
+}
+
+// Resamples a block with process() for each channel.
+// Returns the number of frames written (which must be the same for each channel).
+size_t process_each_channel(BlockResampler &res, unsigned chans, std::span<const float> in, std::span<float> out) {
+	size_t frames = 0;
+	for (unsigned c = 0; c < chans; c++) {
+		auto chan_frames = (res.process(c, in, out) - c) / chans;
+		if (c == 0)
+			frames = chan_frames;
+		CHECK(chan_frames == frames);
+	}
+	return frames;
+}
+
+} // namespace
+
+TEST_CASE("BlockResampler::process_interleaved() matches process() for each channel") {
+	struct Rates {
+		uint32_t in;
+		uint32_t out;
+	};
+
+	for (unsigned chans : {1u, 3u, 4u, 5u, 8u, 16u}) {
+		CAPTURE(chans);
+
+		for (auto rates : {Rates{24000, 48000}, Rates{44100, 48000}, Rates{48000, 44100}, Rates{96000, 48000}}) {
+			CAPTURE(rates.in);
+			CAPTURE(rates.out);
+
+			// Always process() for each channel
+			BlockResampler expected{chans};
+			// Always process_interleaved()
+			BlockResampler interleaved{chans};
+			// Both, alternating each block
+			BlockResampler mixed{chans};
+
+			auto set_rates = [&](Rates r) {
+				for (auto *res : {&expected, &interleaved, &mixed})
+					res->set_samplerate_in_out(r.in, r.out);
+			};
+			set_rates(rates);
+
+			unsigned first_frame = 0;
+			for (unsigned block = 0; block < 12; block++) {
+				CAPTURE(block);
+
+				if (block == 4) {
+					for (auto *res : {&expected, &interleaved, &mixed})
+						res->flush();
+				}
+				if (block == 8)
+					set_rates({rates.out, rates.in});
+
+				const unsigned in_frames = 13 + block * 7;
+				auto in = test_block(chans, in_frames, first_frame);
+				first_frame += in_frames;
+
+				// Enough room for all the input at the lowest ratio, 0.5
+				const size_t out_size = (in_frames * 2 + 4) * chans;
+				const float unwritten = std::numeric_limits<float>::quiet_NaN();
+				std::vector<float> expected_out(out_size, unwritten);
+				std::vector<float> interleaved_out(out_size, unwritten);
+				std::vector<float> mixed_out(out_size, unwritten);
+
+				auto frames = process_each_channel(expected, chans, in, expected_out);
+				CHECK(interleaved.process_interleaved(in, interleaved_out) == frames * chans);
+
+				if (block % 2 == 0)
+					CHECK(mixed.process_interleaved(in, mixed_out) == frames * chans);
+				else
+					CHECK(process_each_channel(mixed, chans, in, mixed_out) == frames);
+
+				unsigned mismatches = 0;
+				for (size_t i = 0; i < frames * chans; i++) {
+					if (interleaved_out[i] != doctest::Approx(expected_out[i]))
+						mismatches++;
+					if (mixed_out[i] != doctest::Approx(expected_out[i]))
+						mismatches++;
+				}
+				CHECK(mismatches == 0);
+
+				// Nothing is written past the last frame
+				CHECK(std::isnan(interleaved_out[frames * chans]));
+			}
+		}
+	}
+}
+
+TEST_CASE("BlockResampler::process_interleaved() flushes after process() has started a flush") {
+	const unsigned chans = 4;
+	BlockResampler expected{chans};
+	BlockResampler res{chans};
+	res.set_samplerate_in_out(44100, 48000);
+	expected.set_samplerate_in_out(44100, 48000);
+
+	std::vector<float> out(256 * chans);
+	std::vector<float> expected_out(256 * chans);
+
+	auto in = test_block(chans, 64, 0);
+	res.process_interleaved(in, out);
+	expected.process_interleaved(in, expected_out);
+
+	// After a flush, process() for channel 0 alone clears channel 0's flag.
+	// The next process_interleaved() must still flush all the channels.
+	res.flush();
+	expected.flush();
+	auto next = test_block(chans, 64, 64);
+	res.process(0, next, out);
+
+	auto frames = res.process_interleaved(next, out) / chans;
+	REQUIRE(expected.process_interleaved(next, expected_out) / chans == frames);
+	for (size_t i = 0; i < frames * chans; i++) {
+		CAPTURE(i);
+		CHECK(out[i] == doctest::Approx(expected_out[i]));
+	}
+}
@@ -0,0 +1,120 @@
+#include "filesystem/buffered_file_reader.hh"
+#include "doctest.h"
+#include <array>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+std::string write_test_file(size_t num_bytes) {
+	auto path = (std::filesystem::temp_directory_path() / "buffered_file_reader_test.bin").string();
+
+	std::vector<uint8_t> data(num_bytes);
+	for (size_t i = 0; i < num_bytes; i++)
+		data[i] = uint8_t(i * 13 + (i >> 8));
+
+	if (auto fp = std::fopen(path.c_str(), "wb")) {
+		std::fwrite(data.data(), 1, data.size(), fp);
+		std::fclose(fp);
+	}
+	return path;
+}
+
+uint8_t expected_byte(size_t i) {
+	return uint8_t(i * 13 + (i >> 8));
+}
+
+} // namespace
+
+TEST_CASE("BufferedFileReader reads in whole clusters") {
+	constexpr size_t Cluster = 4096;
+	constexpr size_t FileBytes = Cluster * 10 + 123;
+	auto path = write_test_file(FileBytes);
+
+	BufferedFileReader reader{2};
+	REQUIRE(reader.open(path, Cluster));
+	CHECK(reader.size() == FileBytes);
+	CHECK(reader.buffer_bytes() == Cluster * 2);
+
+	SUBCASE("Small sequential reads") {
+		std::vector<uint8_t> all;
+		std::array<uint8_t, 1000> chunk;
+		while (auto num = reader.read(std::span{chunk}))
+			all.insert(all.end(), chunk.begin(), chunk.begin() + num);
+
+		REQUIRE(all.size() == FileBytes);
+		unsigned mismatches = 0;
+		for (size_t i = 0; i < all.size(); i++)
+			mismatches += all[i] != expected_byte(i) ? 1 : 0;
+		CHECK(mismatches == 0);
+
+		// One disk read per buffer (the last one is short)
+		CHECK(reader.disk_read_count() == 6);
+		CHECK(reader.is_eof());
+	}
+
+	SUBCASE("Seeking to an unaligned position reads from the start of the cluster") {
+		CHECK(reader.seek(Cluster * 3 + 100));
+		std::array<uint8_t, 10> bytes;
+		CHECK(reader.read(std::span{bytes}) == 10);
+		CHECK(bytes[0] == expected_byte(Cluster * 3 + 100));
+		CHECK(reader.disk_read_count() == 1);
+
+		// Going backwards within the buffer does not read from disk
+		reader.seek(Cluster * 3);
+		CHECK(reader.read(std::span{bytes}) == 10);
+		CHECK(bytes[0] == expected_byte(Cluster * 3));
+		CHECK(reader.disk_read_count() == 1);
+	}
+
+	SUBCASE("Large reads go straight to the destination") {
+		std::vector<uint8_t> big(Cluster * 5 + 10);
+		CHECK(reader.read(std::span{big}) == big.size());
+		CHECK(big[Cluster * 5 + 9] == expected_byte(Cluster * 5 + 9));
+
+		// 5 clusters direct, then the buffer for the last 10 bytes
+		CHECK(reader.disk_read_count() == 2);
+	}
+
+	SUBCASE("Reading whole elements") {
+		std::array<uint16_t, 3> words;
+		reader.seek(FileBytes - 5);
+		CHECK(reader.read(std::span{words}) == 2);
+		CHECK(reader.is_eof());
+	}
+
+	reader.close();
+	std::remove(path.c_str());
+}
+
+TEST_CASE("Filesystem::cluster_size() returns a power of 2") {
+	auto size = Filesystem::cluster_size(std::filesystem::temp_directory_path().string());
+	CHECK(size >= 512);
+	CHECK((size & (size - 1)) == 0);
+
+	CHECK(Filesystem::cluster_size("does/not/exist", 1234) == 1234);
+}
+
+TEST_CASE("Filesystem::seek_to() rejects positions that don't fit in a long") {
+	auto path = write_test_file(1000);
+	auto fp = std::fopen(path.c_str(), "rb");
+	REQUIRE(fp);
+
+	CHECK(Filesystem::seek_to(fp, 500));
+	CHECK(std::ftell(fp) == 500);
+
+	// Would be truncated by fseek(), so the position is not changed
+	CHECK_FALSE(Filesystem::seek_to(fp, uint64_t(LONG_MAX) + 1));
+	CHECK_FALSE(Filesystem::seek_to(fp, uint64_t(LONG_MAX) + 501));
+	CHECK(std::ftell(fp) == 500);
+
+	CHECK_FALSE(Filesystem::seek_to(nullptr, 0));
+
+	std::fclose(fp);
+	std::remove(path.c_str());
+}
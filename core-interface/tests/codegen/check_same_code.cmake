@@ -0,0 +1,32 @@
+# Checks that two functions in an assembly file have the same number of
+# instructions.
+# Usage: cmake -DASM=file.s -DFUNC=name -DEXPECTED=name -DSTAMP=file -P check_same_code.cmake
+
+function(count_instructions lines func result)
+	set(count 0)
+	set(in_func FALSE)
+	foreach(line IN LISTS lines)
+		if(line MATCHES "^_?${func}:")
+			set(in_func TRUE)
+		elseif(in_func AND line MATCHES "^[ \t]*\\.(cfi_endproc|size)")
+			break()
+		elseif(in_func AND line MATCHES "^[ \t]+[a-z]")
+			# Instructions are indented, directives start with . and labels aren't indented
+			math(EXPR count "${count} + 1")
+		endif()
+	endforeach()
+	if(NOT in_func)
+		message(FATAL_ERROR "${func} not found in ${ASM}")
+	endif()
+	set(${result} ${count} PARENT_SCOPE)
+endfunction()
+
+file(STRINGS ${ASM} lines)
+count_instructions("${lines}" ${FUNC} func_count)
+count_instructions("${lines}" ${EXPECTED} expected_count)
+
+if(NOT func_count EQUAL expected_count)
+	message(FATAL_ERROR "${FUNC} has ${func_count} instructions, but ${EXPECTED} has ${expected_count} (see ${ASM})")
+endif()
+
+file(TOUCH ${STAMP})
@@ -0,0 +1,51 @@
+// Compiled with -O2 -S by the tests' CMakeLists.txt, to check that
+// setOutput<EL>() compiles to the same code as a store to a plain array
+#include "CoreModules/SmartCoreProcessor.hh"
+#include "CoreModules/elements/element_info.hh"
+
+using namespace MetaModule;
+
+namespace
+{
+
+struct CodegenInfo : ModuleInfoBase {
+	static constexpr std::string_view slug{"Codegen"};
+
+	using enum Coords;
+
+	static constexpr std::array<Element, 4> Elements{{
+		Knob{{to_mm<72>(20), to_mm<72>(40), Center, "Level", ""}},
+		JackInput{{to_mm<72>(20), to_mm<72>(80), Center, "In", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(120), Center, "Out 1", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(160), Center, "Out 2", ""}},
+	}};
+
+	enum class Elem {
+		LevelKnob,
+		In,
+		Out1,
+		Out2,
+	};
+};
+
+struct CodegenCore : SmartCoreProcessor<CodegenInfo> {
+	void update() override {
+	}
+
+	void set_samplerate(float) override {
+	}
+
+	void set_out2(float val) {
+		setOutput<CodegenInfo::Elem::Out2>(val);
+	}
+};
+
+} // namespace
+
+extern "C" void codegen_set_output(CodegenCore &core, float val) {
+	core.set_out2(val);
+}
+
+extern "C" void codegen_array_store(float *outputs, float val) {
+	outputs[1] = val;
+}
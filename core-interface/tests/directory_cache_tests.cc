@@ -0,0 +1,122 @@
+#include "filesystem/directory_cache.hh"
+#include "doctest.h"
+#include <cstdio>
+#include <filesystem>
+
+using namespace MetaModule;
+
+namespace
+{
+
+void touch(std::filesystem::path const &path) {
+	if (auto fp = std::fopen(path.c_str(), "wb"))
+		std::fclose(fp);
+}
+
+// Lets a test hold the lock, as another thread would
+struct LockableCache : DirectoryCache {
+	using DirectoryCache::lock;
+};
+
+} // namespace
+
+TEST_CASE("DirectoryCache reads a directory incrementally") {
+	auto dir = std::filesystem::temp_directory_path() / "directory_cache_test";
+	std::filesystem::remove_all(dir);
+	std::filesystem::create_directories(dir / "subdir");
+
+	constexpr unsigned NumFiles = 100;
+	for (unsigned i = 0; i < NumFiles; i++)
+		touch(dir / ("sample" + std::to_string(i) + (i % 2 ? ".wav" : ".raw")));
+	touch(dir / "readme");
+
+	LockableCache cache;
+	CHECK(cache.state(dir.string()) == DirectoryCache::State::NotCached);
+	CHECK_FALSE(cache.list(dir.string()));
+
+	unsigned num_scans = 1;
+	while (!cache.scan(dir.string(), 10))
+		num_scans++;
+	CHECK(num_scans == 11); // 102 entries, 10 at a time
+
+	CHECK(cache.state(dir.string()) == DirectoryCache::State::Cached);
+	CHECK(cache.state(dir.string() + "/") == DirectoryCache::State::Cached);
+
+	auto all = cache.list(dir.string()).value();
+	CHECK(all.size() == NumFiles + 2);
+	CHECK(std::ranges::is_sorted(all, {}, &DirEntry::name));
+
+	auto wavs = cache.list(dir.string(), "wav, WAV").value();
+	CHECK(wavs.size() == NumFiles / 2 + 1); // plus subdir
+
+	auto dirs = cache.list(dir.string(), "*/").value();
+	REQUIRE(dirs.size() == 1);
+	CHECK(dirs[0].name == "subdir");
+	CHECK(dirs[0].is_dir);
+
+	CHECK(cache.list(dir.string(), "*.*")->size() == NumFiles + 2);
+	CHECK(cache.list(dir.string(), ".raw")->size() == NumFiles / 2 + 1);
+
+	SUBCASE("Cached listing is returned without reading again") {
+		CHECK(cache.scan(dir.string(), 1));
+	}
+
+	SUBCASE("invalidate() removes listings with the prefix") {
+		CHECK(cache.invalidate(dir.string()));
+		CHECK(cache.state(dir.string()) == DirectoryCache::State::NotCached);
+		CHECK_FALSE(cache.list(dir.string()));
+
+		touch(dir / "new.wav");
+		while (!cache.scan(dir.string()))
+			;
+		CHECK(cache.list(dir.string(), "wav")->size() == NumFiles / 2 + 2);
+	}
+
+	SUBCASE("invalidate() while a directory is part way through being read") {
+		auto sub = (dir / "subdir").string();
+		touch(dir / "subdir" / "a.wav");
+		touch(dir / "subdir" / "b.wav");
+		CHECK_FALSE(cache.scan(sub, 1));
+		CHECK(cache.invalidate(sub));
+		CHECK(cache.state(sub) == DirectoryCache::State::NotCached);
+		while (!cache.scan(sub, 1))
+			;
+		CHECK(cache.list(sub)->size() == 2);
+	}
+
+	SUBCASE("A busy cache is not mistaken for an uncached directory") {
+		SpinLockGuard other_thread{cache.lock};
+		REQUIRE(other_thread);
+		CHECK(cache.state(dir.string()) == DirectoryCache::State::Busy);
+		CHECK_FALSE(cache.list(dir.string()));
+		CHECK_FALSE(cache.scan(dir.string()));
+		CHECK_FALSE(cache.invalidate(dir.string()));
+	}
+
+	SUBCASE("Removed directory is removed from the cache") {
+		std::filesystem::remove_all(dir);
+		CHECK_FALSE(cache.scan(dir.string()));
+		CHECK(cache.state(dir.string()) == DirectoryCache::State::NotCached);
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("DirectoryCache filter matching") {
+	DirEntry wav{"kick.wav", false};
+	DirEntry upper{"KICK.WAV", false};
+	DirEntry noext{"README", false};
+	DirEntry dir{"samples", true};
+
+	CHECK(DirectoryCache::matches(wav, "wav"));
+	CHECK(DirectoryCache::matches(wav, ".raw, .wav"));
+	CHECK(DirectoryCache::matches(wav, "*.wav"));
+	CHECK_FALSE(DirectoryCache::matches(upper, "wav"));
+	CHECK(DirectoryCache::matches(upper, "wav,WAV"));
+	CHECK_FALSE(DirectoryCache::matches(noext, "wav"));
+	CHECK(DirectoryCache::matches(noext, ""));
+	CHECK(DirectoryCache::matches(noext, "wav, *.*"));
+	CHECK(DirectoryCache::matches(dir, "wav"));
+	CHECK(DirectoryCache::matches(dir, "*/"));
+	CHECK_FALSE(DirectoryCache::matches(wav, "*/"));
+}
@@ -0,0 +1,171 @@
+#include "dsp/interpolating_stream_resampler.hh"
+#include "doctest.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+constexpr double TwoPi = 2 * 3.14159265358979323846;
+
+// Resamples a sine wave and returns the signal-to-noise ratio of the output in dB.
+// The output should be a pure sine at the resampled frequency. Anything else
+// (aliases and interpolation images) is counted as noise.
+// The output sine is found with a least-squares fit at the known frequency.
+template<typename Interp>
+double resampled_sine_snr(double freq, uint32_t in_rate, uint32_t out_rate) {
+	InterpolatingStreamResampler<Interp> resampler{1};
+	resampler.set_sample_rate_in_out(in_rate, out_rate);
+
+	size_t in_pos = 0;
+	std::vector<double> out(16384);
+	for (auto &y : out)
+		y = resampler.process_mono([&] { return float(std::sin(TwoPi * freq * double(in_pos++))); });
+
+	const double out_freq = freq * in_rate / out_rate;
+	const size_t skip = 64; // settle after the initial flush
+
+	double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+	for (size_t i = skip; i < out.size(); i++) {
+		auto s = std::sin(TwoPi * out_freq * i);
+		auto c = std::cos(TwoPi * out_freq * i);
+		ss += s * s;
+		cc += c * c;
+		sc += s * c;
+		ys += out[i] * s;
+		yc += out[i] * c;
+	}
+	const double det = ss * cc - sc * sc;
+	const double a = (ys * cc - yc * sc) / det;
+	const double b = (yc * ss - ys * sc) / det;
+
+	double signal = 0, noise = 0;
+	for (size_t i = skip; i < out.size(); i++) {
+		auto fit = a * std::sin(TwoPi * out_freq * i) + b * std::cos(TwoPi * out_freq * i);
+		signal += fit * fit;
+		noise += (out[i] - fit) * (out[i] - fit);
+	}
+	return 10 * std::log10(signal / noise);
+}
+
+// Resamples a full-scale sine and returns the level of the output in dB
+template<typename Interp>
+double resampled_sine_level(double freq, uint32_t in_rate, uint32_t out_rate) {
+	InterpolatingStreamResampler<Interp> resampler{1};
+	resampler.set_sample_rate_in_out(in_rate, out_rate);
+
+	size_t in_pos = 0;
+	std::vector<double> out(16384);
+	for (auto &y : out)
+		y = resampler.process_mono([&] { return float(std::sin(TwoPi * freq * double(in_pos++))); });
+
+	const size_t skip = 64;
+	double power = 0;
+	for (size_t i = skip; i < out.size(); i++)
+		power += out[i] * out[i];
+	return 10 * std::log10(power / double(out.size() - skip) / 0.5);
+}
+
+} // namespace
+
+TEST_CASE("Interpolation kernels pass DC and the samples themselves") {
+	const Interpolation::Sinc6 sinc6;
+	const Interpolation::Sinc8 sinc8;
+	float x[32];
+	std::fill(std::begin(x), std::end(x), 0.5f);
+	for (float t : {0.f, 0.25f, 0.5f, 0.99f}) {
+		CHECK(Interpolation::Linear::interpolate(x, t) == doctest::Approx(0.5f));
+		CHECK(Interpolation::Hermite::interpolate(x, t) == doctest::Approx(0.5f));
+		CHECK(sinc6.interpolate(x, t) == doctest::Approx(0.5f));
+		CHECK(sinc8.interpolate(x, t) == doctest::Approx(0.5f));
+	}
+
+	// At t = 0 the output is the sample at Points / 2 - 1
+	float ramp[32];
+	std::iota(std::begin(ramp), std::end(ramp), 0.f);
+	CHECK(Interpolation::Linear::interpolate(ramp, 0) == doctest::Approx(0));
+	CHECK(Interpolation::Hermite::interpolate(ramp, 0) == doctest::Approx(1));
+	CHECK(sinc6.interpolate(ramp, 0) == doctest::Approx(Interpolation::Sinc6::Points / 2 - 1));
+	CHECK(sinc8.interpolate(ramp, 0) == doctest::Approx(Interpolation::Sinc8::Points / 2 - 1));
+}
+
+TEST_CASE("Aliasing of each interpolation mode") {
+	// 44.1kHz -> 48kHz, and pitching up by 1.5x
+	for (auto [in_rate, out_rate] : {std::pair{44100u, 48000u}, std::pair{48000u, 32000u}}) {
+		CAPTURE(in_rate);
+		CAPTURE(out_rate);
+
+		// Sine at 40% of the input Nyquist frequency
+		const double freq = 0.2;
+
+		auto linear = resampled_sine_snr<Interpolation::Linear>(freq, in_rate, out_rate);
+		auto hermite = resampled_sine_snr<Interpolation::Hermite>(freq, in_rate, out_rate);
+		auto sinc6 = resampled_sine_snr<Interpolation::Sinc6>(freq, in_rate, out_rate);
+		auto sinc8 = resampled_sine_snr<Interpolation::Sinc8>(freq, in_rate, out_rate);
+
+		CHECK(linear > 15);
+		CHECK(hermite > 25);
+		CHECK(sinc6 > 38);
+		CHECK(sinc8 > 60);
+
+		CHECK(hermite > linear);
+		CHECK(sinc6 > hermite);
+		// Both sinc kernels can reach the limit of float precision
+		CHECK(sinc8 > std::min(sinc6, 80.));
+	}
+}
+
+TEST_CASE("Aliasing when pitching up") {
+	for (auto [in_rate, out_rate] : {std::pair{96000u, 48000u}, std::pair{88200u, 32000u}, std::pair{48000u, 12000u}}) {
+		CAPTURE(in_rate);
+		CAPTURE(out_rate);
+		const double out_nyquist = 0.5 * out_rate / in_rate;
+
+		// Sine above the output Nyquist frequency: all of the output is aliasing
+		const double alias_freq = 1.5 * out_nyquist;
+		auto linear = resampled_sine_level<Interpolation::Linear>(alias_freq, in_rate, out_rate);
+		auto hermite = resampled_sine_level<Interpolation::Hermite>(alias_freq, in_rate, out_rate);
+		auto sinc6 = resampled_sine_level<Interpolation::Sinc6>(alias_freq, in_rate, out_rate);
+		auto sinc8 = resampled_sine_level<Interpolation::Sinc8>(alias_freq, in_rate, out_rate);
+
+		// Linear and Hermite don't filter, so they alias at close to full level
+		CHECK(linear > -10);
+		CHECK(hermite > -10);
+		CHECK(sinc6 < -30);
+		CHECK(sinc8 < -50);
+
+		// Sine well below the output Nyquist frequency: passed at close to full level
+		const double pass_freq = 0.3 * out_nyquist;
+		CHECK(resampled_sine_level<Interpolation::Sinc6>(pass_freq, in_rate, out_rate) > -0.5);
+		CHECK(resampled_sine_level<Interpolation::Sinc8>(pass_freq, in_rate, out_rate) > -0.5);
+	}
+}
+
+TEST_CASE("InterpolatingStreamResampler delays the input by a fixed amount at a ratio of 1") {
+	// With a ratio of 1, the output is the input delayed by the kernel's latency
+	InterpolatingStreamResampler<Interpolation::Hermite> resampler{2};
+
+	std::vector<float> in;
+	for (int i = 0; i < 32; i++)
+		in.push_back(float(i));
+
+	std::span<const float> input = in;
+	std::vector<float> out;
+	for (int i = 0; i < 16; i++) {
+		float frame[2];
+		input = input.subspan(resampler.process(input, frame));
+		out.push_back(frame[0]);
+		out.push_back(frame[1]);
+	}
+
+	CHECK(input.empty());
+	// Frame n outputs input frame n-2: both channels are delayed by the same amount
+	for (int frame = 2; frame < 16; frame++) {
+		CHECK(out[frame * 2] == doctest::Approx(in[(frame - 2) * 2]));
+		CHECK(out[frame * 2 + 1] == doctest::Approx(in[(frame - 2) * 2 + 1]));
+	}
+}
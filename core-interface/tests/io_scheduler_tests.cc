@@ -0,0 +1,253 @@
+#include "threads/io_scheduler.hh"
+#include "doctest.h"
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+int file_a, file_b, file_c;
+
+// Fails to compile unless the scheduler can be constant-initialized, which
+// shared() relies on to be safe without thread-safe statics
+constinit IoScheduler<4> constant_initialized_scheduler;
+} // namespace
+
+TEST_CASE("IoScheduler is constant-initialized, with the default policy") {
+	for (auto *sched : {&constant_initialized_scheduler, &IoScheduler<4>::shared()}) {
+		CHECK(sched->num_pending() == 0);
+
+		// Earliest deadline first, and adjacent requests are merged
+		std::vector<IoRequest> reads;
+		auto record = [&reads](IoRequest const &req) {
+			reads.push_back(req);
+		};
+		CHECK(sched->submit({&file_a, 0, 100, 300}, record));
+		CHECK(sched->submit({&file_a, 100, 100, 300}, record));
+		CHECK(sched->submit({&file_b, 0, 100, 100}, record));
+		while (sched->run_next())
+			;
+		REQUIRE(reads.size() == 2);
+		CHECK(reads[0].file == &file_b);
+		CHECK(reads[1].file == &file_a);
+		CHECK(reads[1].size == 200);
+	}
+	CHECK(&IoScheduler<4>::shared() == &IoScheduler<4>::shared());
+}
+
+TEST_CASE("IoScheduler ordering") {
+	IoScheduler<8> sched{IoScheduler<8>::Policy::EarliestDeadline, false};
+
+	std::vector<const void *> order;
+	auto record = [&order](IoRequest const &req) {
+		order.push_back(req.file);
+	};
+
+	CHECK(sched.submit({&file_a, 0, 100, 300}, record));
+	CHECK(sched.submit({&file_b, 0, 100, 100}, record));
+	CHECK(sched.submit({&file_c, 0, 100, 200}, record));
+	CHECK(sched.num_pending() == 3);
+
+	SUBCASE("Earliest deadline first") {
+		while (sched.run_next())
+			;
+		CHECK(order == std::vector<const void *>{&file_b, &file_c, &file_a});
+	}
+
+	SUBCASE("Fifo") {
+		sched.set_policy(IoScheduler<8>::Policy::Fifo);
+		while (sched.run_next())
+			;
+		CHECK(order == std::vector<const void *>{&file_a, &file_b, &file_c});
+	}
+
+	SUBCASE("Deadlines compare correctly when the ticks wrap") {
+		IoScheduler<8> wrap_sched;
+		wrap_sched.submit({&file_a, 0, 100, 10}, record);
+		wrap_sched.submit({&file_b, 0, 100, 0xFFFF'FFF0}, record);
+		while (wrap_sched.run_next())
+			;
+		CHECK(order == std::vector<const void *>{&file_b, &file_a});
+	}
+}
+
+TEST_CASE("IoScheduler coalesces adjacent requests for the same file") {
+	IoScheduler<8> sched;
+
+	std::vector<IoRequest> reads;
+	auto record = [&reads](IoRequest const &req) {
+		reads.push_back(req);
+	};
+
+	sched.submit({&file_a, 1000, 100, 500}, record);
+	sched.submit({&file_a, 1100, 100, 400}, record); // after
+	sched.submit({&file_a, 900, 100, 600}, record);	 // before
+	sched.submit({&file_a, 5000, 100, 700}, record); // not adjacent
+	sched.submit({&file_b, 1200, 100, 800}, record); // other file
+	CHECK(sched.num_pending() == 3);
+	CHECK(sched.merged_count() == 2);
+
+	while (sched.run_next())
+		;
+
+	REQUIRE(reads.size() == 3);
+	CHECK(reads[0].file == &file_a);
+	CHECK(reads[0].offset == 900);
+	CHECK(reads[0].size == 300);
+	CHECK(reads[0].deadline == 400);
+	CHECK(reads[1].offset == 5000);
+	CHECK(reads[2].file == &file_b);
+}
+
+TEST_CASE("IoScheduler does not start two reads of the same file") {
+	IoScheduler<8> sched{IoScheduler<8>::Policy::Fifo, false};
+	auto nop = [](IoRequest const &) {
+	};
+
+	sched.submit({&file_a, 0, 100, 100}, nop);
+	sched.submit({&file_a, 500, 100, 100}, nop);
+	sched.submit({&file_b, 0, 100, 100}, nop);
+
+	auto first = sched.take_next();
+	REQUIRE(first);
+	CHECK(first->request.file == &file_a);
+
+	// The second file_a request must wait until the first one is finished
+	auto second = sched.take_next();
+	REQUIRE(second);
+	CHECK(second->request.file == &file_b);
+	CHECK_FALSE(sched.take_next());
+
+	sched.finish(*first);
+	auto third = sched.take_next();
+	REQUIRE(third);
+	CHECK(third->request.file == &file_a);
+	CHECK(third->request.offset == 500);
+}
+
+TEST_CASE("IoScheduler rejects requests when full") {
+	IoScheduler<2> sched{IoScheduler<2>::Policy::Fifo, false};
+	auto nop = [](IoRequest const &) {
+	};
+
+	CHECK(sched.submit({&file_a, 0, 1, 0}, nop));
+	CHECK(sched.submit({&file_b, 0, 1, 0}, nop));
+	CHECK_FALSE(sched.submit({&file_c, 0, 1, 0}, nop));
+}
+
+////////////////////////////////////////////////////////////////////////
+// Simulation of several sample players streaming from one slow SD card.
+// Time advances in 1ms steps. Each stream plays 48 frames per ms, and asks
+// for another chunk when its buffer has space for it. The card services one
+// request at a time: each read costs a fixed seek time plus the transfer time,
+// and occasionally a read stalls for a long time.
+
+namespace
+{
+
+struct SimResult {
+	unsigned underruns = 0;
+	unsigned reads = 0;
+};
+
+template<size_t MaxRequests>
+SimResult simulate_streams(typename IoScheduler<MaxRequests>::Policy policy, bool coalesce) {
+	constexpr unsigned NumStreams = 8;
+	constexpr unsigned FramesPerMs = 48;
+	constexpr unsigned BufferFrames = 24'000;
+	constexpr unsigned ChunkFrames = 2'048;
+	constexpr unsigned BytesPerFrame = 4;
+	constexpr unsigned SeekMs = 2;
+	constexpr unsigned BytesPerMs = 4'000;
+	constexpr unsigned StallMs = 150;
+	constexpr unsigned SimMs = 30'000;
+
+	struct Stream {
+		unsigned buffered = 0;
+		unsigned requested = 0; // frames submitted but not read yet
+		uint32_t next_offset = 0;
+		uint32_t start_ms = 0;
+		bool in_underrun = false;
+	};
+
+	IoScheduler<MaxRequests> sched{policy, coalesce};
+	std::array<Stream, NumStreams> streams{};
+	for (unsigned i = 0; i < NumStreams; i++)
+		streams[i].start_ms = i * 300;
+
+	SimResult result;
+
+	std::optional<typename IoScheduler<MaxRequests>::Job> current;
+	uint32_t busy_until = 0;
+	uint32_t lcg = 1;
+
+	for (uint32_t now = 0; now < SimMs; now++) {
+		// Card finishes a read
+		if (current && now >= busy_until) {
+			current->read(current->request);
+			sched.finish(*current);
+			current.reset();
+		}
+
+		// Card starts the next read
+		if (!current) {
+			current = sched.take_next();
+			if (current) {
+				result.reads++;
+				lcg = lcg * 1664525u + 1013904223u;
+				auto stall = (lcg >> 24) < 6 ? StallMs : 0; // about 2% of reads
+				busy_until = now + SeekMs + current->request.size * BytesPerFrame / BytesPerMs + stall;
+			}
+		}
+
+		for (auto &s : streams) {
+			if (now < s.start_ms)
+				continue;
+
+			// Playback
+			if (s.buffered >= FramesPerMs) {
+				s.buffered -= FramesPerMs;
+				s.in_underrun = false;
+			} else {
+				s.buffered = 0;
+				if (!s.in_underrun)
+					result.underruns++;
+				s.in_underrun = true;
+			}
+
+			// Request more data when there's room
+			while (s.buffered + s.requested + ChunkFrames <= BufferFrames) {
+				auto deadline = IoRequest::deadline_in(now, s.buffered, FramesPerMs * 1000);
+				auto read = [&s](IoRequest const &req) {
+					s.buffered += req.size;
+					s.requested -= req.size;
+				};
+				if (!sched.submit({&s, s.next_offset, ChunkFrames, deadline}, read))
+					break;
+				s.requested += ChunkFrames;
+				s.next_offset += ChunkFrames;
+			}
+		}
+	}
+
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("IoScheduler simulation: underruns per policy") {
+	using Sched = IoScheduler<64>;
+
+	auto fifo = simulate_streams<64>(Sched::Policy::Fifo, false);
+	auto edf = simulate_streams<64>(Sched::Policy::EarliestDeadline, false);
+	auto edf_coalesce = simulate_streams<64>(Sched::Policy::EarliestDeadline, true);
+
+	MESSAGE("Fifo:                       ", fifo.underruns, " underruns, ", fifo.reads, " reads");
+	MESSAGE("Earliest deadline:          ", edf.underruns, " underruns, ", edf.reads, " reads");
+	MESSAGE("Earliest deadline+coalesce: ", edf_coalesce.underruns, " underruns, ", edf_coalesce.reads, " reads");
+
+	CHECK(fifo.underruns > 0);
+	CHECK(edf.underruns <= fifo.underruns);
+	CHECK(edf_coalesce.underruns <= edf.underruns);
+	CHECK(edf_coalesce.reads < edf.reads);
+}
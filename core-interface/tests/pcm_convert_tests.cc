@@ -0,0 +1,51 @@
+#include "dsp/pcm_convert.hh"
+#include "doctest.h"
+#include "wav/dr_wav.h"
+#include <cstring>
+#include <vector>
+
+using namespace MetaModule;
+
+// The converted samples must be bit-identical to what dr_wav produces when
+// reading a file as floats, since the WavFileStream Native buffer format
+// promises the same output as the Float format.
+
+TEST_CASE("convert_s16_to_f32 is bit-identical to drwav_s16_to_f32") {
+	// Every 16-bit value, plus 3 more so the length is not a multiple of 4
+	std::vector<int16_t> in;
+	for (int32_t x = -32768; x <= 32767; x++)
+		in.push_back(int16_t(x));
+	in.insert(in.end(), {-32768, 1, 32767});
+
+	std::vector<float> expected(in.size());
+	std::vector<float> out(in.size());
+	drwav_s16_to_f32(expected.data(), in.data(), in.size());
+	convert_s16_to_f32(in, out);
+
+	CHECK(std::memcmp(out.data(), expected.data(), out.size() * sizeof(float)) == 0);
+}
+
+TEST_CASE("convert_s24_to_f32 is bit-identical to drwav_s24_to_f32") {
+	// Extremes and a pseudo-random spread of 24-bit values, packed little-endian
+	std::vector<int32_t> values{-8388608, -8388607, -1, 0, 1, 8388606, 8388607};
+	uint32_t lcg = 12345;
+	for (int i = 0; i < 100'000; i++) {
+		lcg = lcg * 1664525u + 1013904223u;
+		values.push_back(int32_t(lcg) >> 8);
+	}
+
+	std::vector<uint8_t> in;
+	for (auto x : values) {
+		in.push_back(uint8_t(x));
+		in.push_back(uint8_t(x >> 8));
+		in.push_back(uint8_t(x >> 16));
+	}
+
+	std::vector<float> expected(values.size());
+	std::vector<float> out(values.size());
+	drwav_s24_to_f32(expected.data(), in.data(), values.size());
+	convert_s24_to_f32(in, out);
+
+	CHECK(std::memcmp(out.data(), expected.data(), out.size() * sizeof(float)) == 0);
+	CHECK(out[0] == -1.f);
+}
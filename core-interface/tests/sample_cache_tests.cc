@@ -0,0 +1,147 @@
+#define DR_WAV_IMPLEMENTATION
+#include "wav/sample_cache.hh"
+#include "doctest.h"
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+using namespace MetaModule;
+
+// Firmware function used by SampleCache
+uint32_t MetaModule::System::free_memory() {
+	return 64 * 1024 * 1024;
+}
+
+namespace
+{
+
+// Writes a 16-bit wav file where every sample has the value `val`
+std::string write_test_wav(std::string const &name, unsigned channels, unsigned frames, int16_t val) {
+	auto path = (std::filesystem::temp_directory_path() / name).string();
+
+	drwav_data_format format{};
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_PCM;
+	format.channels = channels;
+	format.sampleRate = 48000;
+	format.bitsPerSample = 16;
+
+	drwav wav;
+	if (drwav_init_file_write(&wav, path.c_str(), &format, nullptr)) {
+		std::vector<int16_t> data(frames * channels, val);
+		drwav_write_pcm_frames(&wav, frames, data.data());
+		drwav_uninit(&wav);
+	}
+	return path;
+}
+
+} // namespace
+
+TEST_CASE("SampleCache shares one copy of each file") {
+	SampleCache cache;
+	auto path = write_test_wav("sample_cache_test_a.wav", 2, 1000, 16384);
+
+	auto a = cache.load(path);
+	REQUIRE(a);
+	CHECK(a->channels == 2);
+	CHECK(a->sample_rate == 48000);
+	CHECK(a->num_frames() == 1000);
+	CHECK(a->frame(999)[1] == doctest::Approx(0.5f));
+	CHECK(cache.cached_bytes() == 1000 * 2 * sizeof(float));
+
+	auto b = cache.load(path);
+	CHECK(b == a);
+	CHECK(cache.cached_bytes() == 1000 * 2 * sizeof(float));
+
+	CHECK(cache.load("does_not_exist.wav") == nullptr);
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("SampleCache evicts the least recently used files which are not in use") {
+	SampleCache cache;
+	constexpr size_t FileBytes = 1000 * sizeof(float);
+	cache.set_max_bytes(FileBytes * 2);
+
+	auto path1 = write_test_wav("sample_cache_test_1.wav", 1, 1000, 100);
+	auto path2 = write_test_wav("sample_cache_test_2.wav", 1, 1000, 200);
+	auto path3 = write_test_wav("sample_cache_test_3.wav", 1, 1000, 300);
+
+	auto s1 = cache.load(path1);
+	auto s2 = cache.load(path2);
+	CHECK(cache.cached_bytes() == FileBytes * 2);
+
+	SUBCASE("Files in use are not evicted, even when over budget") {
+		auto s3 = cache.load(path3);
+		CHECK(cache.cached_bytes() == FileBytes * 3);
+		CHECK(cache.load(path1) == s1);
+	}
+
+	SUBCASE("Least recently used file is evicted first") {
+		auto s1_ptr = s1.get();
+		std::weak_ptr<const CachedSample> s2_weak = s2;
+		s1.reset();
+		s2.reset();
+
+		// Use file 1, so that file 2 is the least recently used
+		s1 = cache.load(path1);
+		CHECK(s1.get() == s1_ptr);
+		s1.reset();
+
+		CHECK_FALSE(s2_weak.expired());
+		auto s3 = cache.load(path3);
+		CHECK(cache.cached_bytes() == FileBytes * 2);
+		CHECK(s2_weak.expired());
+
+		// File 1 is still cached, file 2 was evicted and is loaded again
+		CHECK(cache.load(path1).get() == s1_ptr);
+		CHECK(cache.cached_bytes() == FileBytes * 2);
+		s2 = cache.load(path2);
+		CHECK(s2);
+		CHECK(s2->samples[0] == doctest::Approx(200 / 32768.f));
+	}
+
+	SUBCASE("evict_unused() removes everything not in use") {
+		s2.reset();
+		cache.evict_unused();
+		CHECK(cache.cached_bytes() == FileBytes);
+	}
+
+	std::remove(path1.c_str());
+	std::remove(path2.c_str());
+	std::remove(path3.c_str());
+}
+
+TEST_CASE("SampleCache rejects files larger than the memory budget before decoding") {
+	SampleCache cache;
+	auto path = write_test_wav("sample_cache_test_big.wav", 2, 1000, 100);
+
+	cache.set_max_bytes(1000 * 2 * sizeof(float) - 1);
+	CHECK(cache.load(path) == nullptr);
+	CHECK(cache.cached_bytes() == 0);
+
+	cache.set_max_bytes(1000 * 2 * sizeof(float));
+	CHECK(cache.load(path) != nullptr);
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("SampleCache loads compressed files") {
+	SampleCache cache;
+	auto path = (std::filesystem::temp_directory_path() / "sample_cache_test.qoa").string();
+
+	std::vector<int16_t> data(3000, 0);
+	auto file = Qoa::encode(data, 1, 32000);
+	if (auto fp = std::fopen(path.c_str(), "wb")) {
+		std::fwrite(file.data(), 1, file.size(), fp);
+		std::fclose(fp);
+	}
+
+	auto sample = cache.load(path);
+	REQUIRE(sample);
+	CHECK(sample->channels == 1);
+	CHECK(sample->sample_rate == 32000);
+	CHECK(sample->num_frames() == 3000);
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,273 @@
+#include "wav/sample_stream.hh"
+#include "doctest.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+// Two channels of sine waves at different frequencies
+std::vector<int16_t> test_signal(unsigned frames) {
+	std::vector<int16_t> data(frames * 2);
+	for (unsigned i = 0; i < frames; i++) {
+		data[i * 2] = int16_t(12000 * std::sin(i * 0.031f));
+		data[i * 2 + 1] = int16_t(8000 * std::sin(i * 0.0071f) + 4000 * std::sin(i * 0.43f));
+	}
+	return data;
+}
+
+std::string write_file(std::string const &name, std::span<const uint8_t> bytes) {
+	auto path = (std::filesystem::temp_directory_path() / name).string();
+	if (auto fp = std::fopen(path.c_str(), "wb")) {
+		std::fwrite(bytes.data(), 1, bytes.size(), fp);
+		std::fclose(fp);
+	}
+	return path;
+}
+
+// Decodes a whole QOA file in memory, frame by frame
+std::vector<int16_t> decode_all(std::span<const uint8_t> file) {
+	Qoa::FileInfo info;
+	if (!Qoa::read_file_info(file, info))
+		return {};
+
+	std::vector<int16_t> out(info.total_frames * info.channels);
+	size_t pos = Qoa::HeaderBytes;
+	for (uint32_t frame = 0; frame < info.total_frames; frame += Qoa::FrameLen) {
+		auto n = Qoa::decode_frame(file.subspan(pos), info.channels, std::span{out}.subspan(frame * info.channels));
+		if (n == 0)
+			return {};
+		pos += Qoa::frame_bytes(info.channels, n);
+	}
+	return out;
+}
+
+} // namespace
+
+TEST_CASE("QOA encodes and decodes") {
+	const unsigned frames = Qoa::FrameLen * 3 + 1234;
+	auto signal = test_signal(frames);
+	auto file = Qoa::encode(signal, 2, 44100);
+
+	// 3.2 bits per sample, plus the frame headers
+	CHECK(file.size() < signal.size() * sizeof(int16_t) / 4);
+
+	Qoa::FileInfo info;
+	REQUIRE(Qoa::read_file_info(file, info));
+	CHECK(info.channels == 2);
+	CHECK(info.sample_rate == 44100);
+	CHECK(info.total_frames == frames);
+
+	auto decoded = decode_all(file);
+	REQUIRE(decoded.size() == signal.size());
+
+	double signal_power = 0;
+	double noise_power = 0;
+	for (unsigned i = 0; i < signal.size(); i++) {
+		signal_power += double(signal[i]) * signal[i];
+		noise_power += double(signal[i] - decoded[i]) * (signal[i] - decoded[i]);
+	}
+	auto snr_db = 10 * std::log10(signal_power / noise_power);
+	CHECK(snr_db > 30);
+
+	SUBCASE("Invalid data") {
+		std::vector<uint8_t> not_qoa(64, 0);
+		CHECK_FALSE(Qoa::read_file_info(not_qoa, info));
+
+		std::vector<int16_t> out(Qoa::FrameLen * 2);
+		auto truncated = std::span{file}.subspan(Qoa::HeaderBytes, 100);
+		CHECK(Qoa::decode_frame(truncated, 2, out) == 0);
+		auto wrong_channels = std::span{file}.subspan(Qoa::HeaderBytes);
+		CHECK(Qoa::decode_frame(wrong_channels, 1, out) == 0);
+	}
+}
+
+TEST_CASE("SampleDecoder reads and seeks in QOA files") {
+	const unsigned frames = Qoa::FrameLen * 2 + 100;
+	auto file = Qoa::encode(test_signal(frames), 2, 48000);
+	auto expected = decode_all(file);
+	auto path = write_file("sample_decoder_test.qoa", file);
+
+	auto decoder = open_sample_decoder(path);
+	REQUIRE(decoder);
+	CHECK(decoder->num_channels() == 2);
+	CHECK(decoder->sample_rate() == 48000);
+	CHECK(decoder->total_frames() == frames);
+
+	// Odd-sized reads, which cross QOA frame boundaries
+	std::vector<float> out(frames * 2);
+	unsigned pos = 0;
+	while (auto n = decoder->read_frames(std::span{out}.subspan(pos * 2, std::min(777u, frames - pos) * 2)))
+		pos += n;
+	CHECK(pos == frames);
+
+	unsigned mismatches = 0;
+	for (unsigned i = 0; i < out.size(); i++) {
+		if (out[i] != expected[i] / 32768.f)
+			mismatches++;
+	}
+	CHECK(mismatches == 0);
+
+	for (uint64_t seek_to : {uint64_t{0}, uint64_t{1}, uint64_t{Qoa::FrameLen}, uint64_t{Qoa::FrameLen * 2 + 99}}) {
+		CAPTURE(seek_to);
+		REQUIRE(decoder->seek_to_frame(seek_to));
+		std::array<float, 2> frame;
+		REQUIRE(decoder->read_frames(frame) == 1);
+		CHECK(frame[0] == expected[seek_to * 2] / 32768.f);
+		CHECK(frame[1] == expected[seek_to * 2 + 1] / 32768.f);
+	}
+	CHECK_FALSE(decoder->seek_to_frame(frames + 1));
+
+	CHECK(open_sample_decoder("does_not_exist.qoa") == nullptr);
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("SampleStream streams a QOA file through the pre-buffer") {
+	const unsigned frames = 20000;
+	auto file = Qoa::encode(test_signal(frames), 2, 48000);
+	auto expected = decode_all(file);
+	auto path = write_file("sample_stream_test.qoa", file);
+
+	SampleStream<4096> stream;
+	REQUIRE(stream.load(path));
+	CHECK(stream.num_channels() == 2);
+	CHECK(stream.total_frames() == frames);
+
+	// Play the whole file, refilling the buffer between blocks of 64 frames
+	std::vector<float> played;
+	std::array<float, 128> block;
+	while (!(stream.is_eof() && stream.frames_available() == 0)) {
+		stream.read_frames_from_file();
+		auto n = stream.pop_frames(block, 64);
+		played.insert(played.end(), block.begin(), block.begin() + n * 2);
+	}
+	REQUIRE(played.size() == expected.size());
+	CHECK(stream.current_playback_frame() == frames);
+
+	unsigned mismatches = 0;
+	for (unsigned i = 0; i < played.size(); i++) {
+		if (played[i] != expected[i] / 32768.f)
+			mismatches++;
+	}
+	CHECK(mismatches == 0);
+
+	SUBCASE("Seek when the buffer is empty") {
+		stream.reset_playback_to_frame(5000);
+		CHECK_FALSE(stream.is_eof());
+		CHECK(stream.frames_available() == 0);
+
+		// The async thread stops, the audio thread empties the buffer, then the async thread seeks
+		CHECK(stream.read_frames_from_file() == 0);
+		CHECK(stream.frames_available() == 0);
+		stream.read_frames_from_file();
+		CHECK(stream.frames_available() == 4096 / 2);
+		CHECK(stream.current_playback_frame() == 5000);
+		CHECK(stream.pop_sample() == expected[10000] / 32768.f);
+		CHECK(stream.pop_sample() == expected[10001] / 32768.f);
+		CHECK(stream.current_playback_frame() == 5001);
+	}
+
+	SUBCASE("Seek while the buffer has frames") {
+		stream.reset_playback_to_frame(0);
+		stream.read_frames_from_file();
+		stream.frames_available();
+		stream.read_frames_from_file();
+		REQUIRE(stream.frames_available() > 0);
+
+		// The async thread can't seek until the audio thread has emptied the buffer
+		stream.reset_playback_to_frame(100);
+		CHECK(stream.read_frames_from_file() == 0);
+		CHECK(stream.frames_available() == 0);
+		CHECK(stream.read_frames_from_file() > 0);
+		CHECK(stream.pop_sample() == expected[200] / 32768.f);
+	}
+
+	SUBCASE("The buffer is only emptied once for each seek") {
+		stream.reset_playback_to_frame(0);
+		stream.read_frames_from_file();
+		stream.frames_available();
+		stream.read_frames_from_file();
+		REQUIRE(stream.frames_available() > 0);
+
+		// The audio thread sees the seek before the async thread has stopped
+		// writing, so it must not empty the buffer yet
+		stream.reset_playback_to_frame(100);
+		CHECK(stream.frames_available() == 0);
+		CHECK(stream.read_frames_from_file() == 0);
+
+		// Now it does, and the async thread seeks
+		CHECK(stream.frames_available() == 0);
+		CHECK(stream.read_frames_from_file() > 0);
+
+		// The audio thread is still waiting to see the seek finished: the new
+		// frames must not be thrown away
+		CHECK(stream.frames_available() > 0);
+		CHECK(stream.pop_sample() == expected[200] / 32768.f);
+		CHECK(stream.current_playback_frame() == 100);
+	}
+
+	SUBCASE("Unsupported file") {
+		stream.unload();
+		CHECK_FALSE(stream.load("does_not_exist.wav"));
+		CHECK_FALSE(stream.is_loaded());
+		CHECK(stream.pop_frames(block, 64) == 0);
+	}
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("SampleStream seeks while the async thread is running") {
+	const unsigned frames = 20000;
+	auto file = Qoa::encode(test_signal(frames), 2, 48000);
+	auto expected = decode_all(file);
+	auto path = write_file("sample_stream_thread_test.qoa", file);
+
+	SampleStream<4096> stream;
+	REQUIRE(stream.load(path));
+
+	std::atomic<bool> done = false;
+	std::thread async_thread{[&] {
+		while (!done.load())
+			stream.read_frames_from_file(256);
+	}};
+
+	// Retrigger at many frames, each time checking that the first frame played
+	// is the frame that was asked for
+	unsigned mismatches = 0;
+	unsigned timeouts = 0;
+	for (unsigned i = 0; i < 200; i++) {
+		const uint32_t frame = (i * 997) % (frames - 1);
+		stream.reset_playback_to_frame(frame);
+
+		std::array<float, 2> first{};
+		unsigned tries = 0;
+		while (stream.pop_frames(first, 1) == 0 && ++tries < 1'000'000)
+			std::this_thread::yield();
+
+		if (tries >= 1'000'000)
+			timeouts++;
+		else if (first[0] != expected[frame * 2] / 32768.f || first[1] != expected[frame * 2 + 1] / 32768.f)
+			mismatches++;
+
+		// Sometimes play a bit before the next seek
+		std::array<float, 128> block;
+		for (unsigned j = 0; j < i % 4; j++)
+			stream.pop_frames(block, 64);
+	}
+
+	done = true;
+	async_thread.join();
+
+	CHECK(timeouts == 0);
+	CHECK(mismatches == 0);
+
+	std::remove(path.c_str());
+}
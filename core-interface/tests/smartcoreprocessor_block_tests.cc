@@ -0,0 +1,327 @@
+#include "CoreModules/SmartCoreProcessorBlock.hh"
+#include "CoreModules/param_event_queue.hh"
+#include "CoreModules/elements/element_info.hh"
+#include "doctest.h"
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+struct BlockTestInfo : ModuleInfoBase {
+	static constexpr std::string_view slug{"BlockTest"};
+
+	using enum Coords;
+
+	static constexpr std::array<Element, 4> Elements{{
+		Knob{{to_mm<72>(20), to_mm<72>(40), Center, "Gain", ""}},
+		JackInput{{to_mm<72>(20), to_mm<72>(80), Center, "In", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(120), Center, "Out", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(160), Center, "Frames", ""}},
+	}};
+
+	enum class Elem {
+		GainKnob,
+		In,
+		Out,
+		FramesOut,
+	};
+};
+
+struct GainBlock : SmartCoreProcessorBlock<BlockTestInfo> {
+	using enum BlockTestInfo::Elem;
+
+	void update_block(unsigned frames) override {
+		auto gain = getState<GainKnob>();
+		auto in = getInput<In>();
+		auto out = getOutput<Out>();
+
+		if (in.empty()) {
+			setOutput<Out>(0.f);
+		} else {
+			for (auto i = 0u; i < frames; i++)
+				out[i] = in[i] * gain;
+		}
+
+		setOutput<FramesOut>(float(blockSize()));
+	}
+
+	void set_samplerate(float) override {
+	}
+};
+
+// Reads one output back to write the other
+struct InvertingBlock : SmartCoreProcessorBlock<BlockTestInfo> {
+	using enum BlockTestInfo::Elem;
+
+	void update_block(unsigned frames) override {
+		setOutput<Out>(getState<GainKnob>());
+		auto out = getOutput<Out>();
+		auto inverted = getOutput<FramesOut>();
+		for (auto i = 0u; i < frames; i++)
+			inverted[i] = -out[i];
+	}
+
+	void set_samplerate(float) override {
+	}
+};
+
+} // namespace
+
+TEST_CASE("SmartCoreProcessorBlock: per-frame update() uses single-frame blocks") {
+	GainBlock core;
+	core.set_param(0, 0.5f);
+	core.mark_input_patched(0);
+	core.set_input(0, 4.f);
+	core.update();
+
+	CHECK(core.get_output(0) == doctest::Approx(2.f));
+	CHECK(core.get_output(1) == 1.f);
+
+	core.mark_input_unpatched(0);
+	core.update();
+	CHECK(core.get_output(0) == 0.f);
+}
+
+TEST_CASE("SmartCoreProcessorBlock: process_block() processes spans") {
+	GainBlock core;
+	core.set_param(0, 0.25f);
+	core.mark_input_patched(0);
+
+	constexpr unsigned Frames = 64;
+	std::vector<float> in(Frames);
+	std::vector<float> out(Frames);
+	for (auto i = 0u; i < Frames; i++)
+		in[i] = float(i);
+
+	std::array<const float *, 1> ins{in.data()};
+	std::array<float *, 2> outs{out.data(), nullptr}; // second output unpatched
+
+	core.process_block(ins, outs, Frames);
+
+	for (auto i = 0u; i < Frames; i++)
+		CHECK(out[i] == doctest::Approx(i * 0.25f));
+
+	// get_output() reports the last frame
+	CHECK(core.get_output(0) == doctest::Approx((Frames - 1) * 0.25f));
+	CHECK(core.get_output(1) == float(Frames));
+}
+
+TEST_CASE("SmartCoreProcessorBlock: unpatched outputs can be read back") {
+	InvertingBlock core;
+	core.set_param(0, 0.5f);
+
+	constexpr unsigned Frames = 32;
+	std::vector<float> out(Frames);
+	std::array<const float *, 1> ins{nullptr};
+
+	SUBCASE("Both outputs unpatched") {
+		std::array<float *, 2> outs{nullptr, nullptr};
+		core.process_block(ins, outs, Frames);
+		CHECK(core.get_output(0) == 0.5f);
+		CHECK(core.get_output(1) == -0.5f);
+	}
+
+	SUBCASE("One output unpatched") {
+		std::array<float *, 2> outs{nullptr, out.data()};
+		core.process_block(ins, outs, Frames);
+		CHECK(out[0] == -0.5f);
+		CHECK(out[Frames - 1] == -0.5f);
+		CHECK(core.get_output(0) == 0.5f);
+	}
+}
+
+TEST_CASE("SmartCoreProcessorBlock: blocks larger than MaxBlockSize are split") {
+	GainBlock core;
+	core.set_param(0, 1.f);
+
+	constexpr unsigned Frames = GainBlock::MaxBlockSize + 16;
+	std::vector<float> out(Frames, 1.f);
+	std::vector<float> frames_out(Frames);
+
+	std::array<const float *, 1> ins{nullptr};
+	std::array<float *, 2> outs{out.data(), frames_out.data()};
+
+	core.process_block(ins, outs, Frames);
+
+	for (auto i = 0u; i < Frames; i++)
+		CHECK(out[i] == 0.f);
+
+	CHECK(frames_out[0] == float(GainBlock::MaxBlockSize));
+	CHECK(frames_out[Frames - 1] == 16.f);
+}
+
+TEST_CASE("CoreProcessorBlock: default process_block() calls update() per frame") {
+	struct Counter : CoreProcessorBlock {
+		float in = 0;
+		float out = 0;
+		unsigned updates = 0;
+		void update() override {
+			out = in + 1.f;
+			updates++;
+		}
+		void set_samplerate(float) override {
+		}
+		void set_param(int, float) override {
+		}
+		void set_input(int, float val) override {
+			in = val;
+		}
+		float get_output(int) const override {
+			return out;
+		}
+	} core;
+
+	std::array<float, 8> in{0, 1, 2, 3, 4, 5, 6, 7};
+	std::array<float, 8> out{};
+	std::array<const float *, 1> ins{in.data()};
+	std::array<float *, 1> outs{out.data()};
+
+	core.process_block(ins, outs, 8);
+
+	CHECK(core.updates == 8);
+	for (auto i = 0u; i < 8; i++)
+		CHECK(out[i] == in[i] + 1.f);
+}
+
+namespace
+{
+struct SmoothBlockInfo : BlockTestInfo {
+	static constexpr std::array smoothed_params{SmoothedParam{Elem::GainKnob, 1.f}};
+};
+} // namespace
+
+TEST_CASE("SmartCoreProcessorBlock: smoothed params are advanced once per block") {
+	struct SmoothBlock : SmartCoreProcessorBlock<SmoothBlockInfo> {
+		using enum BlockTestInfo::Elem;
+		unsigned changes = 0;
+
+		void update_block(unsigned) override {
+			setOutput<Out>(getState<GainKnob>());
+			changes += paramChanged<GainKnob>();
+		}
+
+		void set_samplerate(float sr) override {
+			setSmoothingSampleRate(sr);
+		}
+	} core;
+	core.set_samplerate(48000);
+
+	std::vector<float> out(48);
+	std::array<const float *, 1> ins{nullptr};
+	std::array<float *, 2> outs{out.data(), nullptr};
+
+	core.set_param(0, 0.f);
+	core.process_block(ins, outs, 48);
+	CHECK(out[47] == 0.f);
+	CHECK(core.changes == 1);
+
+	// One block of 1ms moves 63% of the way
+	core.set_param(0, 1.f);
+	core.process_block(ins, outs, 48);
+	CHECK(out[0] == doctest::Approx(0.632f).epsilon(0.01));
+	CHECK(core.changes == 2);
+}
+
+TEST_CASE("SmartCoreProcessorBlock: param events are applied at their frame") {
+	struct EventBlock : GainBlock {
+		std::vector<float> gains;
+
+		EventBlock() {
+			onParamChange<GainKnob>([this](float gain) { gains.push_back(gain); });
+		}
+	} core;
+	core.mark_input_patched(0);
+
+	constexpr unsigned Frames = 64;
+	std::vector<float> in(Frames, 1.f);
+	std::vector<float> out(Frames);
+	std::vector<float> frames_out(Frames);
+	std::array<const float *, 1> ins{in.data()};
+	std::array<float *, 2> outs{out.data(), frames_out.data()};
+
+	ParamEventQueue<> queue;
+	CHECK(queue.push({.param_id = 0, .frame_offset = 40, .value = 0.75f}));
+	CHECK(queue.push({.param_id = 0, .frame_offset = 0, .value = 0.25f}));
+	CHECK(queue.push({.param_id = 0, .frame_offset = 10, .value = 0.5f}));
+	CHECK(queue.push({.param_id = 0, .frame_offset = 10, .value = 0.6f}));
+	CHECK(queue.push({.param_id = 0, .frame_offset = 100, .value = 1.f}));
+
+	std::array<CoreProcessor::ParamEvent, 8> events;
+	auto block_events = queue.pop_block(events, Frames);
+	CHECK(block_events.size() == 5);
+	CHECK(queue.empty());
+
+	core.set_param_events(block_events);
+	core.process_block(ins, outs, Frames);
+
+	// Events at the same frame keep their order, so the last one wins.
+	// The event past the end of the block is moved to the last frame
+	CHECK(out[0] == 0.25f);
+	CHECK(out[9] == 0.25f);
+	CHECK(out[10] == 0.6f);
+	CHECK(out[39] == 0.6f);
+	CHECK(out[40] == 0.75f);
+	CHECK(out[62] == 0.75f);
+	CHECK(out[63] == 1.f);
+
+	CHECK(frames_out[0] == 10.f);
+	CHECK(frames_out[10] == 30.f);
+	CHECK(frames_out[40] == 23.f);
+	CHECK(frames_out[63] == 1.f);
+
+	// The handler sees every change, in order
+	CHECK(core.gains == std::vector<float>{0.25f, 0.5f, 0.6f, 0.75f, 1.f});
+
+	// The events are only used for one block
+	core.process_block(ins, outs, Frames);
+	CHECK(frames_out[0] == float(Frames));
+	CHECK(out[0] == 1.f);
+	CHECK(core.gains.size() == 5);
+
+	// Setting the same value again is not a change
+	core.set_param(0, 1.f);
+	CHECK(core.gains.size() == 5);
+}
+
+TEST_CASE("ParamEventQueue: a full block of events is sorted by frame, in order of arrival") {
+	ParamEventQueue<64> queue;
+	for (unsigned i = 0; i < 64; i++)
+		REQUIRE(queue.push({.param_id = uint16_t(i), .frame_offset = uint16_t((i * 37) % 8), .value = 0}));
+
+	std::array<CoreProcessor::ParamEvent, 64> events;
+	auto block_events = queue.pop_block(events, 64);
+	REQUIRE(block_events.size() == 64);
+
+	for (unsigned i = 1; i < block_events.size(); i++) {
+		CAPTURE(i);
+		auto prev = block_events[i - 1];
+		auto cur = block_events[i];
+		CHECK(prev.frame_offset <= cur.frame_offset);
+		if (prev.frame_offset == cur.frame_offset)
+			CHECK(prev.param_id < cur.param_id);
+	}
+}
+
+TEST_CASE("CoreProcessorBlock: default set_param_events() sets params straight away") {
+	struct Params : CoreProcessorBlock {
+		std::vector<std::pair<int, float>> set;
+		void update() override {
+		}
+		void set_samplerate(float) override {
+		}
+		void set_param(int id, float val) override {
+			set.push_back({id, val});
+		}
+		void set_input(int, float) override {
+		}
+		float get_output(int) const override {
+			return 0;
+		}
+	} core;
+
+	std::array<CoreProcessor::ParamEvent, 2> events{{{1, 0, 0.5f}, {2, 30, 0.25f}}};
+	core.set_param_events(events);
+	CHECK(core.set == std::vector<std::pair<int, float>>{{1, 0.5f}, {2, 0.25f}});
+}
@@ -0,0 +1,135 @@
+#include "CoreModules/SmartCoreProcessorPoly.hh"
+#include "CoreModules/elements/element_info.hh"
+#include "doctest.h"
+#include "dsp/float4.hh"
+#include <cstdint>
+
+using namespace MetaModule;
+
+namespace
+{
+
+struct PolyTestInfo : ModuleInfoBase {
+	static constexpr std::string_view slug{"PolyTest"};
+
+	using enum Coords;
+
+	static constexpr std::array<Element, 4> Elements{{
+		JackInput{{to_mm<72>(20), to_mm<72>(40), Center, "In", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(80), Center, "Out", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(120), Center, "Stereo Out", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(160), Center, "Sum Out", ""}},
+	}};
+
+	enum class Elem {
+		In,
+		Out,
+		StereoOut,
+		SumOut,
+	};
+
+	static constexpr std::array bypass_routes{BypassRoute{0, 0}, BypassRoute{0, 1}};
+};
+
+// Doubles each channel, and sums them
+struct PolyDoubler : SmartCoreProcessorPoly<PolyTestInfo> {
+	using enum PolyTestInfo::Elem;
+
+	void update() override {
+		auto in = getInputs<In>();
+		auto out = getOutputs<Out>();
+		setChannels<Out>(in.size());
+
+		for (auto i = 0u; i < in.size(); i += 4)
+			(Float4::load(&in[i]) * Float4::splat(2.f)).store(&out[i]);
+
+		float sum = 0;
+		for (auto v : in)
+			sum += v;
+		setOutput<SumOut>(sum);
+	}
+
+	void set_samplerate(float) override {
+	}
+
+	using SmartCoreProcessorPoly::handle_bypass;
+};
+
+// Asks for more channels than there is room for
+struct ChannelSetter : SmartCoreProcessorPoly<PolyTestInfo> {
+	using enum PolyTestInfo::Elem;
+
+	void update() override {
+		setChannels<StereoOut>(MaxPolyChannels + 4);
+		setOutput<StereoOut>(1.f, MaxPolyChannels - 1);
+		setOutput<StereoOut>(2.f, MaxPolyChannels);
+	}
+
+	void set_samplerate(float) override {
+	}
+};
+
+constexpr unsigned NumChans = CoreProcessor::MaxPolyChannels;
+
+bool is_aligned(const float *p) {
+	return reinterpret_cast<uintptr_t>(p) % CoreProcessor::PolyAlign == 0;
+}
+
+} // namespace
+
+TEST_CASE("SmartCoreProcessorPoly: all channels of aligned buffers") {
+	PolyDoubler core;
+	core.mark_input_patched(0);
+	for (int i = 0; i < 3; i++)
+		core.mark_output_patched(i);
+
+	auto in = core.get_poly_input_buffer(0);
+	auto out = core.get_poly_output_buffer(0);
+	CHECK(is_aligned(in.voltages));
+	CHECK(is_aligned(out.voltages));
+	CHECK(is_aligned(core.get_poly_output_buffer(1).voltages));
+	CHECK(is_aligned(core.get_poly_output_buffer(2).voltages));
+
+	// The engine writes a cable with all the channels into the input
+	*in.channels = NumChans;
+	for (unsigned i = 0; i < NumChans; i++)
+		in.voltages[i] = float(i);
+
+	core.update();
+	CHECK(*out.channels == NumChans);
+	for (unsigned i = 0; i < NumChans; i++)
+		CHECK(out.voltages[i] == 2.f * i);
+	CHECK(core.get_output(2) == float(NumChans * (NumChans - 1) / 2));
+
+	// Bypass copies all the channels
+	core.handle_bypass();
+	CHECK(*out.channels == NumChans);
+	CHECK(out.voltages[NumChans - 1] == float(NumChans - 1));
+	CHECK(*core.get_poly_output_buffer(1).channels == NumChans);
+	CHECK(core.get_poly_output_buffer(1).voltages[NumChans - 1] == float(NumChans - 1));
+}
+
+TEST_CASE("SmartCoreProcessorPoly: every output has room for MaxPolyChannels") {
+	ChannelSetter core;
+	for (int i = 0; i < 3; i++)
+		core.mark_output_patched(i);
+
+	// The engine may touch all MaxPolyChannels voltages of each output buffer,
+	// without writing into the next output
+	for (int out = 0; out < 3; out++) {
+		auto buf = core.get_poly_output_buffer(out);
+		std::fill_n(buf.voltages, NumChans, float(out + 1));
+	}
+	for (int out = 0; out < 3; out++) {
+		auto buf = core.get_poly_output_buffer(out);
+		CHECK(buf.voltages[0] == float(out + 1));
+		CHECK(buf.voltages[NumChans - 1] == float(out + 1));
+	}
+
+	// Channels are clamped to MaxPolyChannels, and writes beyond are ignored
+	core.update();
+	auto stereo = core.get_poly_output_buffer(1);
+	CHECK(*stereo.channels == NumChans);
+	CHECK(stereo.voltages[NumChans - 1] == 1.f);
+	CHECK(core.get_poly_output_buffer(2).voltages[0] == 3.f);
+}
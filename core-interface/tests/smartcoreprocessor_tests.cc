@@ -53,3 +53,263 @@
 // 		CHECK(c == raw[i++]);
 // 	}
 // }
+
+#include "CoreModules/SmartCoreProcessor.hh"
+#include "CoreModules/elements/element_info.hh"
+#include "doctest.h"
+#include <type_traits>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+struct AccessorTestInfo : ModuleInfoBase {
+	static constexpr std::string_view slug{"AccessorTest"};
+
+	using enum Coords;
+
+	static constexpr std::array<Element, 6> Elements{{
+		Knob{{to_mm<72>(20), to_mm<72>(40), Center, "Level", ""}},
+		JackInput{{to_mm<72>(20), to_mm<72>(80), Center, "In", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(120), Center, "Out 1", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(160), Center, "Out 2", ""}},
+		MonoLight{{to_mm<72>(40), to_mm<72>(40), Center, "Active", ""}},
+		RgbLight{{to_mm<72>(40), to_mm<72>(80), Center, "Color", ""}},
+	}};
+
+	enum class Elem {
+		LevelKnob,
+		In,
+		Out1,
+		Out2,
+		ActiveLight,
+		ColorLight,
+	};
+};
+
+struct AccessorTestCore : SmartCoreProcessor<AccessorTestInfo> {
+	using enum AccessorTestInfo::Elem;
+
+	void update() override {
+		auto level = getState<LevelKnob>();
+		setOutput<Out1>(getInput<In>().value_or(-1.f) * level);
+		setOutput<Out2>(isPatched<In>() ? 1.f : 0.f);
+		setLED<ActiveLight>(isPatched<Out1>());
+		setLED<ColorLight>(std::array<float, 3>{0.25f, 0.5f, 0.75f});
+	}
+
+	void set_samplerate(float) override {
+	}
+};
+
+// The ids are constant expressions, so they can be template arguments
+template<size_t N>
+using Const = std::integral_constant<size_t, N>;
+static_assert(Const<AccessorTestCore::output_idx<AccessorTestInfo::Elem::Out2>>::value == 1);
+static_assert(Const<AccessorTestCore::input_idx<AccessorTestInfo::Elem::In>>::value == 0);
+
+} // namespace
+
+TEST_CASE("SmartCoreProcessor: accessors use the element's ids") {
+	AccessorTestCore core;
+	core.set_param(0, 0.5f);
+
+	core.update();
+	CHECK(core.get_output(0) == -0.5f);
+	CHECK(core.get_output(1) == 0.f);
+	CHECK(core.get_led_brightness(0) == 0.f);
+
+	core.mark_input_patched(0);
+	core.set_input(0, 4.f);
+	core.mark_output_patched(0);
+	core.update();
+	CHECK(core.get_output(0) == 2.f);
+	CHECK(core.get_output(1) == 1.f);
+	CHECK(core.get_led_brightness(0) == 1.f);
+	CHECK(core.get_led_brightness(1) == 0.25f);
+	CHECK(core.get_led_brightness(2) == 0.5f);
+	CHECK(core.get_led_brightness(3) == 0.75f);
+}
+
+TEST_CASE("SmartCoreProcessor: patched inputs and outputs") {
+	AccessorTestCore core;
+	core.set_param(0, 1.f);
+
+	// Marking an input patched without a voltage reads as 0V
+	core.mark_input_patched(0);
+	core.update();
+	CHECK(core.get_output(0) == 0.f);
+	CHECK(core.get_output(1) == 1.f);
+
+	// Unpatched inputs have no value, and read 0V when patched again
+	core.set_input(0, 3.f);
+	core.mark_input_unpatched(0);
+	core.update();
+	CHECK(core.get_output(0) == -1.f);
+	CHECK(core.get_output(1) == 0.f);
+
+	core.mark_input_patched(0);
+	core.update();
+	CHECK(core.get_output(0) == 0.f);
+
+	// Setting a voltage marks the input patched
+	core.mark_all_inputs_unpatched();
+	core.set_input(0, 2.f);
+	core.update();
+	CHECK(core.get_output(0) == 2.f);
+
+	core.mark_output_patched(0);
+	core.update();
+	CHECK(core.get_led_brightness(0) == 1.f);
+	core.mark_all_outputs_unpatched();
+	core.update();
+	CHECK(core.get_led_brightness(0) == 0.f);
+}
+
+namespace
+{
+
+struct SmoothingTestInfo : ModuleInfoBase {
+	static constexpr std::string_view slug{"SmoothingTest"};
+
+	using enum Coords;
+
+	static constexpr std::array<Element, 4> Elements{{
+		Knob{{to_mm<72>(20), to_mm<72>(40), Center, "Smooth", ""}},
+		Knob{{to_mm<72>(20), to_mm<72>(80), Center, "Raw", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(120), Center, "Smooth Out", ""}},
+		JackOutput{{to_mm<72>(20), to_mm<72>(160), Center, "Changes", ""}},
+	}};
+
+	enum class Elem {
+		SmoothKnob,
+		RawKnob,
+		SmoothOut,
+		ChangesOut,
+	};
+
+	static constexpr std::array smoothed_params{SmoothedParam{Elem::SmoothKnob, 1.f}};
+};
+
+struct SmoothingTestCore : SmartCoreProcessor<SmoothingTestInfo> {
+	using enum SmoothingTestInfo::Elem;
+
+	unsigned changes = 0;
+	unsigned raw_changes = 0;
+
+	void update() override {
+		smoothParams();
+		setOutput<SmoothOut>(getState<SmoothKnob>());
+		changes += paramChanged<SmoothKnob>();
+		raw_changes += paramChanged<RawKnob>();
+	}
+
+	void set_samplerate(float sr) override {
+		setSmoothingSampleRate(sr);
+	}
+};
+
+} // namespace
+
+TEST_CASE("SmartCoreProcessor: smoothed params") {
+	SmoothingTestCore core;
+	core.set_samplerate(48000);
+
+	// The first value is used straight away. Everything starts as changed
+	core.set_param(0, 0.5f);
+	core.update();
+	CHECK(core.get_output(0) == 0.5f);
+	CHECK(core.changes == 1);
+	CHECK(core.raw_changes == 1);
+
+	core.update();
+	CHECK(core.changes == 1);
+	CHECK(core.raw_changes == 1);
+
+	// Moves 63% of the way in 1ms (48 samples), and reports changes until it settles
+	core.set_param(0, 1.5f);
+	core.set_param(1, 1.f);
+	for (unsigned i = 0; i < 48; i++)
+		core.update();
+	CHECK(core.get_output(0) == doctest::Approx(0.5f + 0.632f).epsilon(0.01));
+	CHECK(core.changes == 49);
+	CHECK(core.raw_changes == 2);
+
+	for (unsigned i = 0; i < 48 * 20; i++)
+		core.update();
+	CHECK(core.get_output(0) == 1.5f);
+	auto settled_changes = core.changes;
+	core.update();
+	CHECK(core.changes == settled_changes);
+
+	// Setting the same value is not a change
+	core.set_param(1, 1.f);
+	core.update();
+	CHECK(core.raw_changes == 2);
+
+	// The knob position is not smoothed
+	core.set_param(0, 0.f);
+	CHECK(core.get_param(0) == 0.f);
+}
+
+TEST_CASE("SmartCoreProcessor: smoothed params when smoothParams() is never called") {
+	// A common mistake: the params are listed in smoothed_params, but update()
+	// doesn't call smoothParams(). The smoother never moves, so without a
+	// fallback the knob would be stuck at its first value.
+	struct ForgetfulCore : SmoothingTestCore {
+		bool remembers = false;
+
+		void update() override {
+			if (remembers)
+				smoothParams();
+			setOutput<SmoothOut>(getState<SmoothKnob>());
+			changes += paramChanged<SmoothKnob>();
+		}
+	} core;
+
+	core.set_param(0, 0.5f);
+	core.update();
+	CHECK(core.get_output(0) == 0.5f);
+
+	// Not smoothed, but not stuck either
+	core.set_param(0, 1.5f);
+	core.update();
+	CHECK(core.get_output(0) == 1.5f);
+	CHECK(core.changes == 2);
+
+	// Once smoothParams() is called, smoothing starts from the current value
+	// (not the first one), and later changes are smoothed
+	core.remembers = true;
+	core.update();
+	CHECK(core.get_output(0) == 1.5f);
+
+	core.set_param(0, 0.5f);
+	core.update();
+	CHECK(core.get_output(0) > 0.5f);
+	CHECK(core.get_output(0) < 1.5f);
+}
+
+TEST_CASE("SmartCoreProcessor: onParamChange handlers") {
+	struct HandlerCore : SmoothingTestCore {
+		std::vector<float> smooth_changes;
+		std::vector<float> raw_changes;
+
+		HandlerCore() {
+			onParamChange<SmoothKnob>([this](float val) { smooth_changes.push_back(val); });
+			onParamChange<RawKnob>([this](float val) { raw_changes.push_back(val); });
+		}
+	} core;
+
+	core.set_param(0, 0.5f);
+	core.set_param(1, 0.25f);
+	core.set_param(1, 0.25f);
+	core.set_param(1, 0.f);
+
+	// Handlers get the new value, not the smoothed value
+	core.set_param(0, 1.f);
+
+	CHECK(core.smooth_changes == std::vector<float>{0.5f, 1.f});
+	CHECK(core.raw_changes == std::vector<float>{0.25f, 0.f});
+}
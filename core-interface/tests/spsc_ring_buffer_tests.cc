@@ -0,0 +1,104 @@
+#include "threads/spsc_ring_buffer.hh"
+#include "doctest.h"
+#include <thread>
+#include <vector>
+
+using namespace MetaModule;
+
+TEST_CASE("SpscRingBuffer basic usage") {
+	SpscRingBuffer<int, 8> buf;
+
+	CHECK(buf.empty());
+	CHECK(buf.num_free() == 8);
+
+	SUBCASE("Push and pop single elements") {
+		CHECK(buf.push(1));
+		CHECK(buf.push(2));
+		CHECK(buf.num_filled() == 2);
+
+		int x{};
+		CHECK(buf.pop(x));
+		CHECK(x == 1);
+		CHECK(buf.pop(x));
+		CHECK(x == 2);
+		CHECK_FALSE(buf.pop(x));
+	}
+
+	SUBCASE("Writes stop when full") {
+		std::vector<int> data{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+		CHECK(buf.write(data) == 8);
+		CHECK(buf.full());
+		CHECK_FALSE(buf.push(10));
+
+		std::array<int, 10> out{};
+		CHECK(buf.read(out) == 8);
+		for (int i = 0; i < 8; i++)
+			CHECK(out[i] == i);
+		CHECK(buf.empty());
+	}
+
+	SUBCASE("Bulk reads and writes wrap around the end") {
+		std::array<int, 6> out{};
+		for (int pass = 0; pass < 5; pass++) {
+			std::array<int, 6> in{};
+			for (int i = 0; i < 6; i++)
+				in[i] = pass * 6 + i;
+
+			CHECK(buf.write(in) == 6);
+			CHECK(buf.read(out) == 6);
+			CHECK(out == in);
+		}
+	}
+
+	SUBCASE("Peek does not remove, discard does") {
+		std::array<int, 4> in{1, 2, 3, 4};
+		buf.write(in);
+
+		std::array<int, 2> out{};
+		CHECK(buf.peek(out) == 2);
+		CHECK(out[0] == 1);
+		CHECK(out[1] == 2);
+		CHECK(buf.num_filled() == 4);
+
+		CHECK(buf.discard(3) == 3);
+		CHECK(buf.read(out) == 1);
+		CHECK(out[0] == 4);
+		CHECK(buf.discard(3) == 0);
+	}
+
+	SUBCASE("Reset empties the buffer") {
+		buf.push(1);
+		buf.reset();
+		CHECK(buf.empty());
+		CHECK(buf.num_free() == 8);
+	}
+}
+
+TEST_CASE("SpscRingBuffer producer and consumer on separate threads") {
+	SpscRingBuffer<unsigned, 256> buf;
+	constexpr unsigned NumItems = 200'000;
+
+	std::thread producer([&] {
+		std::array<unsigned, 37> chunk{};
+		unsigned next = 0;
+		while (next < NumItems) {
+			auto n = std::min<unsigned>(chunk.size(), NumItems - next);
+			for (unsigned i = 0; i < n; i++)
+				chunk[i] = next + i;
+			next += buf.write({chunk.data(), n});
+		}
+	});
+
+	std::array<unsigned, 23> chunk{};
+	unsigned expected = 0;
+	bool in_order = true;
+	while (expected < NumItems) {
+		auto n = buf.read(chunk);
+		for (unsigned i = 0; i < n; i++)
+			in_order = in_order && chunk[i] == expected++;
+	}
+
+	producer.join();
+	CHECK(in_order);
+	CHECK(buf.empty());
+}
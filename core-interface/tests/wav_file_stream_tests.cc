@@ -0,0 +1,469 @@
+#include "wav/dr_wav.h"
+#include "wav/wav_file_stream.hh"
+#include "doctest.h"
+#include "system/time.hh"
+#include <array>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+// The tests run without firmware: time only moves when a test moves it.
+// Each call to get_ticks() adds tick_step, to make reads from the file look slow.
+uint32_t test_ticks = 0;
+uint32_t tick_step = 0;
+} // namespace
+
+uint32_t MetaModule::System::get_ticks() {
+	return test_ticks += tick_step;
+}
+
+namespace
+{
+
+// Each frame holds its own index: left = frame, right = -frame
+constexpr unsigned TestFrames = 20000;
+
+std::string test_wav_file() {
+	auto path = (std::filesystem::temp_directory_path() / "wav_file_stream_test.wav").string();
+
+	drwav_data_format format{
+		.container = drwav_container_riff,
+		.format = DR_WAVE_FORMAT_PCM,
+		.channels = 2,
+		.sampleRate = 48000,
+		.bitsPerSample = 16,
+	};
+
+	drwav wav;
+	if (!drwav_init_file_write(&wav, path.c_str(), &format, nullptr))
+		return "";
+
+	std::vector<int16_t> data(TestFrames * 2);
+	for (unsigned i = 0; i < TestFrames; i++) {
+		data[i * 2] = int16_t(i);
+		data[i * 2 + 1] = int16_t(-int(i));
+	}
+	drwav_write_pcm_frames(&wav, TestFrames, data.data());
+	drwav_uninit(&wav);
+	return path;
+}
+
+// Plays up to num_frames frames, refilling the buffer between blocks of 64 frames.
+// Returns the index of each frame played, or -1 if the channels don't match.
+std::vector<int> play(WavFileStream &stream, unsigned num_frames) {
+	std::vector<int> played;
+	std::array<float, 128> block;
+
+	while (played.size() < num_frames && !(stream.is_eof() && stream.frames_available() == 0)) {
+		if (stream.needs_refill())
+			stream.read_frames_from_file(stream.suggested_read_frames());
+
+		auto n = stream.pop_frames(block, std::min<unsigned>(64, num_frames - played.size()));
+		for (unsigned i = 0; i < n; i++) {
+			auto left = int(block[i * 2] * 32768.f);
+			auto right = int(block[i * 2 + 1] * 32768.f);
+			played.push_back(left == -right ? left : -1);
+		}
+	}
+	return played;
+}
+
+std::vector<int> count(int from, int to) {
+	std::vector<int> frames;
+	for (int i = from; i != to; i += (to > from ? 1 : -1))
+		frames.push_back(i);
+	return frames;
+}
+
+} // namespace
+
+TEST_CASE("WavFileStream plays in reverse") {
+	auto path = test_wav_file();
+	WavFileStream stream{4096};
+	REQUIRE(stream.load(path));
+
+	SUBCASE("Float buffer") {
+	}
+	SUBCASE("Native buffer") {
+		stream.set_buffer_format(WavFileStream::BufferFormat::Native);
+	}
+
+	stream.set_direction(WavFileStream::Direction::Reverse);
+	CHECK(stream.direction() == WavFileStream::Direction::Reverse);
+
+	stream.reset_playback_to_frame(TestFrames - 1);
+	stream.seek_frame_in_file(TestFrames - 1);
+	CHECK(stream.current_playback_frame() == TestFrames - 1);
+	CHECK_FALSE(stream.is_eof());
+
+	// pop_sample() returns the channels of each frame in the usual order
+	stream.read_frames_from_file();
+	CHECK(stream.pop_sample() == (TestFrames - 1) / 32768.f);
+	CHECK(stream.pop_sample() == -(TestFrames - 1.f) / 32768.f);
+	CHECK(stream.current_playback_frame() == TestFrames - 2);
+
+	auto played = play(stream, TestFrames);
+	CHECK(played == count(TestFrames - 2, -1));
+	CHECK(stream.is_eof());
+	CHECK(stream.current_playback_frame() == 0);
+	CHECK(stream.underrun_count() == 0);
+
+	SUBCASE("Jump to a frame in the buffer, and outside of it") {
+		stream.reset_playback_to_frame(100);
+		stream.seek_frame_in_file(100);
+		CHECK(stream.frames_available() == 101);
+		CHECK(play(stream, 101) == count(100, -1));
+
+		stream.reset_playback_to_frame(15000);
+		stream.seek_frame_in_file(15000);
+		CHECK(stream.frames_available() == 0);
+		CHECK(play(stream, 5000) == count(15000, 10000));
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream changes direction in the middle of the buffer") {
+	auto path = test_wav_file();
+	WavFileStream stream{4096};
+	REQUIRE(stream.load(path));
+	stream.set_history_frames(512);
+
+	// Forwards 0 to 4999, then back from 4999 (the last frame is played again)
+	auto played = play(stream, 5000);
+	CHECK(played == count(0, 5000));
+
+	stream.set_direction(WavFileStream::Direction::Reverse);
+	CHECK(stream.current_playback_frame() == 4999);
+
+	// The history frames can be played before the async thread has read any
+	CHECK(stream.frames_available() >= 512);
+	std::array<float, 1024> block;
+	CHECK(stream.pop_frames(block, 512) == 512);
+	CHECK(block[0] == 4999 / 32768.f);
+	CHECK(block[1022] == 4488 / 32768.f);
+
+	played = play(stream, 3000);
+	CHECK(played == count(4487, 1487));
+
+	// Turn around again, several times in quick succession
+	stream.set_direction(WavFileStream::Direction::Forward);
+	played = play(stream, 100);
+	CHECK(played == count(1488, 1588));
+
+	stream.set_direction(WavFileStream::Direction::Reverse);
+	played = play(stream, 10);
+	CHECK(played == count(1587, 1577));
+
+	stream.set_direction(WavFileStream::Direction::Forward);
+	played = play(stream, 8000);
+	CHECK(played == count(1578, 9578));
+
+	CHECK(stream.underrun_count() == 0);
+	CHECK_FALSE(stream.is_file_error());
+
+	SUBCASE("Part way through a frame") {
+		auto left = stream.pop_sample();
+		stream.set_direction(WavFileStream::Direction::Reverse);
+		CHECK(stream.pop_sample() == left);
+		CHECK(stream.pop_sample() == -left);
+		CHECK(play(stream, 2) == count(9577, 9575));
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream ping-pong playback") {
+	auto path = test_wav_file();
+	WavFileStream stream{4096};
+	REQUIRE(stream.load(path));
+	stream.set_history_frames(1024);
+
+	std::vector<int> played;
+	std::vector<int> expected;
+	for (auto pass = 0; pass < 3; pass++) {
+		auto p = play(stream, TestFrames * 2);
+		played.insert(played.end(), p.begin(), p.end());
+
+		if (stream.direction() == WavFileStream::Direction::Forward) {
+			auto e = count(0, TestFrames);
+			expected.insert(expected.end(), e.begin(), e.end());
+			stream.set_direction(WavFileStream::Direction::Reverse);
+		} else {
+			auto e = count(TestFrames - 1, -1);
+			expected.insert(expected.end(), e.begin(), e.end());
+			stream.set_direction(WavFileStream::Direction::Forward);
+		}
+		// The end frame is played again when turning around
+		CHECK(stream.frames_available() > 0);
+	}
+
+	CHECK(played == expected);
+	CHECK(stream.underrun_count() == 0);
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream pop_frames() and peek_frames()") {
+	auto path = test_wav_file();
+	WavFileStream stream{256};
+	REQUIRE(stream.load(path));
+	REQUIRE(stream.buffer_frames() == 128);
+
+	// The index of each frame in `block`, or -1 if the channels don't match
+	auto frames_in = [](std::span<const float> block, unsigned num_frames) {
+		std::vector<int> frames;
+		for (unsigned i = 0; i < num_frames; i++) {
+			auto left = int(block[i * 2] * 32768.f);
+			auto right = int(block[i * 2 + 1] * 32768.f);
+			frames.push_back(left == -right ? left : -1);
+		}
+		return frames;
+	};
+
+	std::array<float, 512> block;
+	stream.read_frames_from_file(100);
+	REQUIRE(stream.frames_available() == 100);
+
+	SUBCASE("Partial pops") {
+		// Fewer frames available than asked for
+		CHECK(stream.pop_frames(block, 60) == 60);
+		CHECK(stream.pop_frames(block, 60) == 40);
+		CHECK(frames_in(block, 40) == count(60, 100));
+		CHECK(stream.pop_frames(block, 60) == 0);
+
+		// Running short is one underrun, however many pops it lasts
+		CHECK(stream.underrun_count() == 1);
+
+		// Limited by the size of `out`: 5 floats only hold 2 whole frames
+		stream.read_frames_from_file(10);
+		CHECK(stream.pop_frames(std::span{block}.first(5), 10) == 2);
+		CHECK(frames_in(block, 2) == count(100, 102));
+		CHECK(stream.current_playback_frame() == 102);
+		CHECK(stream.frames_available() == 8);
+		CHECK(stream.underrun_count() == 1);
+	}
+
+	SUBCASE("Peeking does not consume frames") {
+		CHECK(stream.peek_frames(block, 10) == 10);
+		CHECK(frames_in(block, 10) == count(0, 10));
+		CHECK(stream.peek_frames(block, 10) == 10);
+		CHECK(frames_in(block, 10) == count(0, 10));
+		CHECK(stream.frames_available() == 100);
+		CHECK(stream.current_playback_frame() == 0);
+
+		CHECK(stream.peek_frames(block, 200) == 100);
+		CHECK(stream.frames_available() == 100);
+
+		CHECK(stream.pop_frames(block, 10) == 10);
+		CHECK(frames_in(block, 10) == count(0, 10));
+		CHECK(stream.peek_frames(block, 1) == 1);
+		CHECK(frames_in(block, 1) == count(10, 11));
+		CHECK(stream.underrun_count() == 0);
+	}
+
+	SUBCASE("Pops across the end of the ring buffer") {
+		// Odd-sized reads and pops, so the wrap falls inside a pop many times
+		std::vector<int> played;
+		std::vector<int> peeked;
+		while (played.size() < 2000) {
+			stream.read_frames_from_file(stream.buffer_frames() - stream.frames_available());
+
+			auto n = stream.peek_frames(block, 37);
+			auto p = frames_in(block, n);
+			peeked.insert(peeked.end(), p.begin(), p.end());
+
+			CHECK(stream.pop_frames(block, 37) == n);
+			p = frames_in(block, n);
+			played.insert(played.end(), p.begin(), p.end());
+		}
+		CHECK(played == count(0, played.size()));
+		CHECK(peeked == played);
+		CHECK(stream.current_playback_frame() == played.size());
+		CHECK(stream.underrun_count() == 0);
+	}
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream counts underruns") {
+	auto path = test_wav_file();
+	WavFileStream stream{4096};
+	REQUIRE(stream.load(path));
+
+	std::array<float, 128> block;
+	CHECK(stream.underrun_count() == 0);
+
+	// Each run of empty pops is one underrun
+	CHECK(stream.pop_frames(block, 64) == 0);
+	CHECK(stream.pop_sample() == 0);
+	CHECK(stream.pop_frames(block, 64) == 0);
+	CHECK(stream.underrun_count() == 1);
+
+	stream.read_frames_from_file(64);
+	CHECK(stream.pop_sample() == 0);
+	CHECK(stream.underrun_count() == 1);
+	CHECK(stream.pop_sample() == 0);
+	CHECK(stream.pop_frames(block, 63) == 63);
+	CHECK(stream.pop_sample() == 0);
+	CHECK(stream.underrun_count() == 2);
+
+	// Running out at the end of the file is not an underrun
+	stream.reset_playback_to_frame(TestFrames - 10);
+	stream.seek_frame_in_file(TestFrames - 10);
+	stream.read_frames_from_file();
+	CHECK(stream.pop_frames(block, 64) == 10);
+	CHECK(stream.pop_frames(block, 64) == 0);
+	CHECK(stream.is_eof());
+	CHECK(stream.underrun_count() == 2);
+
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream adaptive read-ahead") {
+	auto path = test_wav_file();
+	WavFileStream stream{16 * 1024};
+	REQUIRE(stream.load(path));
+	REQUIRE(stream.buffer_frames() == 8192);
+
+	// Until the playback rate is known, keep one default read (16kB: 4096 frames) buffered
+	constexpr unsigned DefaultReadFrames = 4096;
+	CHECK(stream.needs_refill());
+	CHECK(stream.suggested_read_frames() == DefaultReadFrames);
+
+	stream.read_frames_from_file(8192);
+	CHECK(stream.frames_available() == 8192);
+	CHECK_FALSE(stream.needs_refill());
+	CHECK(stream.suggested_read_frames() == 0);
+
+	// Plays 16 frames per ms. Returns true if a refill was needed, and does it
+	// if `refill` is set.
+	std::array<float, 32> block;
+	auto play_ms = [&](unsigned ms, bool refill) {
+		bool needed = false;
+		for (unsigned i = 0; i < ms; i++) {
+			test_ticks++;
+			CHECK(stream.pop_frames(block, 16) == 16);
+			if (stream.needs_refill()) {
+				needed = true;
+				if (refill)
+					stream.read_frames_from_file(stream.suggested_read_frames());
+			}
+		}
+		return needed;
+	};
+
+	// Reads are instant, so refills are only needed at the minimum level
+	play_ms(300, true);
+	stream.read_frames_from_file(8192);
+	CHECK_FALSE(play_ms(100, false));
+	CHECK(stream.frames_available() == 8192 - 1600);
+	CHECK(stream.suggested_read_frames() == 1600);
+
+	SUBCASE("A slow read makes it refill sooner, and read more") {
+		// The top-up read takes 200ms, so it should now refill with
+		// 16 frames/ms * (2 * 200ms + 50ms margin) = 7200 frames left
+		tick_step = 200;
+		stream.read_frames_from_file(1600);
+		tick_step = 0;
+		CHECK(stream.frames_available() == 8192);
+
+		// The playback rate dips after the pause, but soon recovers
+		CHECK(play_ms(100, false));
+		CHECK(stream.frames_available() == 8192 - 1600);
+
+		play_ms(350, false);
+		CHECK(stream.frames_available() == 8192 - 7200);
+		CHECK(stream.suggested_read_frames() > 7000);
+		CHECK(stream.suggested_read_frames() <= 7200);
+	}
+
+	CHECK(stream.underrun_count() == 0);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("WavFileStream cue anchors") {
+	auto path = test_wav_file();
+	WavFileStream stream{4096};
+	REQUIRE(stream.load(path));
+
+	// One anchor is read from the file per call, after the pre-buffer
+	CHECK(stream.add_anchor(5000, 256));
+	CHECK(stream.add_anchor(12000, 256));
+	CHECK(stream.add_anchor(12000, 256)); // already registered
+	CHECK(stream.num_anchors() == 2);
+	CHECK(stream.num_anchors_loaded() == 0);
+	stream.read_frames_from_file();
+	CHECK(stream.num_anchors_loaded() == 1);
+	stream.read_frames_from_file();
+	CHECK(stream.num_anchors_loaded() == 2);
+
+	std::array<float, 20> block;
+
+	SUBCASE("Jumping into an anchor plays it straight away, then continues from the pre-buffer") {
+		stream.reset_playback_to_frame(5100);
+		stream.seek_frame_in_file(5100);
+		CHECK(stream.is_playing_anchor());
+		CHECK(stream.current_playback_frame() == 5100);
+		CHECK(stream.frames_available() >= 156);
+
+		CHECK(play(stream, 1000) == count(5100, 6100));
+		CHECK_FALSE(stream.is_playing_anchor());
+		CHECK(stream.underrun_count() == 0);
+	}
+
+	SUBCASE("An anchor being played is not re-used until it's done") {
+		stream.reset_playback_to_frame(12000);
+		stream.seek_frame_in_file(12000);
+		REQUIRE(stream.is_playing_anchor());
+		CHECK(stream.pop_frames(block, 10) == 10);
+
+		// Evict all the anchors, and register as many new ones as possible
+		stream.clear_anchors();
+		CHECK(stream.num_anchors() == 0);
+		unsigned added = 0;
+		while (added < WavFileStream::MaxAnchors && stream.add_anchor(added * 100, 50))
+			added++;
+		CHECK(added == WavFileStream::MaxAnchors - 1);
+		for (unsigned i = 0; i < added; i++)
+			stream.read_frames_from_file();
+		CHECK(stream.num_anchors_loaded() == added);
+
+		// The rest of the anchor plays unchanged
+		CHECK(stream.is_playing_anchor());
+		CHECK(play(stream, 246) == count(12010, 12256));
+		CHECK_FALSE(stream.is_playing_anchor());
+
+		// Now its slot is free
+		CHECK(stream.add_anchor(19000, 50));
+		CHECK(stream.num_anchors() == WavFileStream::MaxAnchors);
+
+		// A cleared anchor isn't jumped into
+		stream.clear_anchors();
+		stream.reset_playback_to_frame(100);
+		CHECK_FALSE(stream.is_playing_anchor());
+	}
+
+	SUBCASE("Loading or unloading stops playback from an anchor") {
+		stream.reset_playback_to_frame(5000);
+		REQUIRE(stream.is_playing_anchor());
+		CHECK(stream.pop_frames(block, 10) == 10);
+
+		SUBCASE("Load") {
+			REQUIRE(stream.load(path));
+		}
+		SUBCASE("Unload") {
+			stream.unload();
+		}
+
+		CHECK_FALSE(stream.is_playing_anchor());
+		CHECK(stream.pop_frames(block, 10) == 0);
+		CHECK(stream.num_anchors() == 0);
+	}
+
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,205 @@
+#include "wav/wav_file_writer.hh"
+#include "doctest.h"
+#include "wav/dr_wav.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+std::string temp_path(std::string const &name) {
+	return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Value of sample `i`, which is exactly representable in all formats
+float test_sample(uint32_t i, unsigned chan) {
+	return float(int((i * 7 + chan * 1000) % 2000) - 1000) / 1024.f;
+}
+
+} // namespace
+
+TEST_CASE("WavFileWriter writes a file that can be read back") {
+	auto path = temp_path("wav_file_writer_test.wav");
+
+	using Format = WavFileWriter<>::SampleFormat;
+	constexpr unsigned NumFrames = 100'001; // odd, so 16-bit mono needs a pad byte
+
+	for (auto format : {Format::Int16, Format::Int24, Format::Float32})
+	for (unsigned channels : {1u, 2u}) {
+		CAPTURE(int(format));
+		CAPTURE(channels);
+
+		WavFileWriter<> writer;
+		REQUIRE(writer.open(path, channels, 44100, format));
+		CHECK(writer.is_recording());
+
+		std::vector<float> frame(channels);
+		unsigned num_pushed = 0;
+		for (uint32_t i = 0; i < NumFrames; i++) {
+			for (unsigned c = 0; c < channels; c++)
+				frame[c] = test_sample(i, c);
+			num_pushed += writer.push_frames(frame);
+
+			// Async thread runs every 64 frames
+			if (i % 64 == 0)
+				writer.flush();
+		}
+		writer.close();
+		CHECK(num_pushed == NumFrames);
+		CHECK_FALSE(writer.is_recording());
+		CHECK(writer.frames_written() == NumFrames);
+		CHECK(writer.dropped_frames() == 0);
+		CHECK_FALSE(writer.is_write_error());
+
+		drwav wav;
+		REQUIRE(drwav_init_file(&wav, path.c_str(), nullptr));
+		CHECK(wav.channels == channels);
+		CHECK(wav.sampleRate == 44100);
+		CHECK(wav.totalPCMFrameCount == NumFrames);
+		CHECK(wav.dataChunkDataPos == WavFileWriter<>::HeaderBytes());
+
+		std::vector<float> readback(NumFrames * channels);
+		CHECK(drwav_read_pcm_frames_f32(&wav, NumFrames, readback.data()) == NumFrames);
+		drwav_uninit(&wav);
+
+		unsigned num_mismatches = 0;
+		for (uint32_t i = 0; i < NumFrames; i++) {
+			for (unsigned c = 0; c < channels; c++)
+				num_mismatches += readback[i * channels + c] != test_sample(i, c) ? 1 : 0;
+		}
+		CHECK(num_mismatches == 0);
+
+		auto file_size = std::filesystem::file_size(path);
+		CHECK(file_size % 2 == 0);
+	}
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("WavFileWriter counts overruns when the buffer fills") {
+	auto path = temp_path("wav_file_writer_overrun.wav");
+
+	WavFileWriter<1024> writer;
+	REQUIRE(writer.open(path, 2, 48000));
+
+	std::vector<float> block(600 * 2, 0.5f);
+
+	// The buffer holds 512 frames
+	CHECK(writer.push_frames(block) == 512);
+	CHECK(writer.overrun_count() == 1);
+	CHECK(writer.dropped_frames() == 600 - 512);
+
+	writer.flush();
+	CHECK(writer.push_frames(block) == 512);
+	CHECK(writer.overrun_count() == 2);
+
+	writer.close();
+	CHECK(writer.frames_written() == 1024);
+
+	// Not recording, so nothing is pushed and nothing is counted
+	CHECK(writer.push_frames(block) == 0);
+	CHECK(writer.overrun_count() == 2);
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("WavFileWriter opens and closes while the audio thread is pushing") {
+	auto path = temp_path("wav_file_writer_reopen.wav");
+	using Writer = WavFileWriter<1024, 1024>;
+	Writer writer;
+
+	// The audio thread always pushes {n, -n}: one stereo frame, or two mono frames
+	std::atomic<bool> done = false;
+	std::thread audio_thread{[&] {
+		for (uint32_t n = 1; !done.load(); n++) {
+			std::array<float, 2> frames{float(n), -float(n)};
+			writer.push_frames(frames);
+			if (n % 16 == 0)
+				std::this_thread::yield();
+		}
+	}};
+
+	// Each recording must hold only whole {n, -n} pairs, in order. Frames
+	// from the previous recording, or pushed with its number of channels,
+	// would break the pattern.
+	unsigned bad_files = 0;
+	unsigned files_with_frames = 0;
+	for (unsigned i = 0; i < 40; i++) {
+		unsigned channels = i % 2 + 1;
+		REQUIRE(writer.open(path, channels, 48000, Writer::SampleFormat::Float32));
+		for (unsigned j = 0; j < 20; j++) {
+			writer.flush();
+			std::this_thread::yield();
+		}
+		writer.close();
+
+		drwav wav;
+		REQUIRE(drwav_init_file(&wav, path.c_str(), nullptr));
+		std::vector<float> samples(wav.totalPCMFrameCount * wav.channels);
+		drwav_read_pcm_frames_f32(&wav, wav.totalPCMFrameCount, samples.data());
+		drwav_uninit(&wav);
+
+		bool ok = wav.channels == channels && samples.size() % 2 == 0;
+		for (size_t k = 0; ok && k < samples.size(); k += 2) {
+			ok = samples[k] > 0 && samples[k + 1] == -samples[k];
+			if (k > 0)
+				ok = ok && samples[k] > samples[k - 2];
+		}
+		bad_files += ok ? 0 : 1;
+		files_with_frames += samples.empty() ? 0 : 1;
+	}
+
+	done = true;
+	audio_thread.join();
+	CHECK(bad_files == 0);
+	CHECK(files_with_frames > 0);
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("WavFileWriter records hours of audio") {
+	auto path = temp_path("wav_file_writer_long.wav");
+
+	// Low sample rate so the file is small enough for a test
+	constexpr unsigned SampleRate = 1000;
+	constexpr unsigned Hours = 3;
+	constexpr uint32_t NumFrames = SampleRate * 60 * 60 * Hours;
+	constexpr unsigned BlockSize = 32;
+
+	WavFileWriter<4096> writer;
+	REQUIRE(writer.open(path, 1, SampleRate, WavFileWriter<4096>::SampleFormat::Int16));
+
+	std::array<float, BlockSize> block;
+	for (uint32_t i = 0; i < NumFrames; i += BlockSize) {
+		for (unsigned j = 0; j < BlockSize; j++)
+			block[j] = test_sample(i + j, 0);
+		writer.push_frames(block);
+
+		if ((i / BlockSize) % 16 == 0)
+			writer.flush();
+	}
+	writer.close();
+
+	CHECK(writer.dropped_frames() == 0);
+	CHECK(writer.frames_written() == NumFrames);
+
+	drwav wav;
+	REQUIRE(drwav_init_file(&wav, path.c_str(), nullptr));
+	CHECK(wav.totalPCMFrameCount == NumFrames);
+
+	// Check the end of the file
+	drwav_seek_to_pcm_frame(&wav, NumFrames - 100);
+	std::array<float, 100> tail;
+	CHECK(drwav_read_pcm_frames_f32(&wav, 100, tail.data()) == 100);
+	for (unsigned i = 0; i < 100; i++)
+		CHECK(tail[i] == test_sample(NumFrames - 100 + i, 0));
+	drwav_uninit(&wav);
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,215 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace MetaModule
+{
+
+// AsyncTask is a C++20 coroutine that runs a little bit at a time from an
+// AsyncThread. Each call to step() runs the coroutine until it next yields
+// (co_await async_yield()) or co_awaits an operation that yields, such as
+// AsyncFile::read(). This lets a long job (like loading a large file) be
+// written as straight-line code, without blocking the AsyncThread for long.
+//
+// Usage:
+//     AsyncTask<bool> load_wavetable(std::string path) {
+//         AsyncFile file;
+//         if (!file.open(path))
+//             co_return false;
+//         auto bytes_read = co_await file.read(std::span{table}); // yields after each chunk
+//         co_return bytes_read == sizeof(table);
+//     }
+//
+//     AsyncTask<bool> task = load_wavetable("sdc:/table.wav");
+//
+//     AsyncThread loader{this, [this]() {
+//         if (task.step())
+//             loaded = task.result();
+//     }};
+//
+// Tasks can co_await other tasks. The task does not start until the first
+// call to step(). The coroutine frame is allocated on the heap when the task
+// is created, so don't create tasks in the audio thread.
+template<typename T = void>
+class AsyncTask;
+
+// Suspends the current task until the next call to step()
+inline std::suspend_always async_yield() {
+	return {};
+}
+
+namespace AsyncTaskDetail
+{
+
+struct PromiseBase {
+	// The outermost task, which is the one that step() is called on
+	PromiseBase *root = this;
+
+	// For the root: the innermost task, which is the one to resume
+	std::coroutine_handle<> current{};
+
+	// The task waiting for this one to finish
+	std::coroutine_handle<> continuation{};
+
+	std::suspend_always initial_suspend() noexcept {
+		return {};
+	}
+
+	struct FinalAwaiter {
+		bool await_ready() noexcept {
+			return false;
+		}
+
+		template<typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+			auto &promise = h.promise();
+			if (promise.continuation) {
+				promise.root->current = promise.continuation;
+				return promise.continuation;
+			}
+			return std::noop_coroutine();
+		}
+
+		void await_resume() noexcept {
+		}
+	};
+
+	FinalAwaiter final_suspend() noexcept {
+		return {};
+	}
+
+	void unhandled_exception() {
+		std::terminate();
+	}
+};
+
+template<typename T>
+struct Promise : PromiseBase {
+	std::optional<T> value;
+
+	AsyncTask<T> get_return_object();
+
+	void return_value(T v) {
+		value = std::move(v);
+	}
+};
+
+template<>
+struct Promise<void> : PromiseBase {
+	AsyncTask<void> get_return_object();
+
+	void return_void() {
+	}
+};
+
+} // namespace AsyncTaskDetail
+
+template<typename T>
+class AsyncTask {
+public:
+	using promise_type = AsyncTaskDetail::Promise<T>;
+	using Handle = std::coroutine_handle<promise_type>;
+
+	AsyncTask() = default;
+
+	explicit AsyncTask(Handle handle)
+		: handle{handle} {
+		handle.promise().current = handle;
+	}
+
+	AsyncTask(AsyncTask &&other) noexcept
+		: handle{std::exchange(other.handle, {})} {
+	}
+
+	AsyncTask &operator=(AsyncTask &&other) noexcept {
+		if (this != &other) {
+			if (handle)
+				handle.destroy();
+			handle = std::exchange(other.handle, {});
+		}
+		return *this;
+	}
+
+	AsyncTask(AsyncTask const &) = delete;
+	AsyncTask &operator=(AsyncTask const &) = delete;
+
+	~AsyncTask() {
+		if (handle)
+			handle.destroy();
+	}
+
+	// Runs the task until it yields or finishes.
+	// Returns true if the task is finished (or there is no task).
+	bool step() {
+		if (!handle || handle.done())
+			return true;
+		handle.promise().current.resume();
+		return handle.done();
+	}
+
+	// Whether the task has finished (or there is no task)
+	bool is_done() const {
+		return !handle || handle.done();
+	}
+
+	// Whether there is a task (that is, this was returned from a coroutine and not moved from)
+	bool is_valid() const {
+		return bool(handle);
+	}
+
+	// The value given to co_return. Only call this after the task is done.
+	template<typename U = T>
+		requires(!std::is_void_v<U>)
+	U &result() {
+		return *handle.promise().value;
+	}
+
+	// Lets a task co_await another task
+	auto operator co_await() && noexcept {
+		return Awaiter{handle};
+	}
+
+private:
+	Handle handle{};
+
+	struct Awaiter {
+		Handle child;
+
+		bool await_ready() noexcept {
+			return !child || child.done();
+		}
+
+		template<typename ParentPromise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<ParentPromise> parent) noexcept {
+			auto &promise = child.promise();
+			promise.root = parent.promise().root;
+			promise.continuation = parent;
+			promise.root->current = child;
+			return child;
+		}
+
+		T await_resume() {
+			if constexpr (!std::is_void_v<T>)
+				return std::move(*child.promise().value);
+		}
+	};
+};
+
+namespace AsyncTaskDetail
+{
+
+template<typename T>
+AsyncTask<T> Promise<T>::get_return_object() {
+	return AsyncTask<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+}
+
+inline AsyncTask<void> Promise<void>::get_return_object() {
+	return AsyncTask<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+}
+
+} // namespace AsyncTaskDetail
+
+} // namespace MetaModule
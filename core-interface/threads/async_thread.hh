@@ -1,7 +1,10 @@
 #pragma once
 #include "CoreModules/CoreProcessor.hh"
+#include "system/time.hh"
 #include "util/callable.hh"
+#include <cstdint>
 #include <memory>
+#include <span>
 
 namespace MetaModule
 {
@@ -19,6 +22,39 @@ public:
 
 	bool is_enabled();
 
+	////
+	/// Statistics
+	///
+
+	// Statistics are only collected while enabled (they are off by default),
+	// so there's no timing overhead in normal use.
+	// A run of the action that takes longer than overrun_us is counted as an
+	// overrun: AsyncThreads should do a small amount of work each time.
+	static void enable_stats(bool enable, uint32_t overrun_us = 2000);
+	static bool stats_enabled();
+
+	struct Stats {
+		const CoreProcessor *module = nullptr;
+		uint32_t run_count = 0;
+		uint32_t overrun_count = 0;
+		uint32_t min_us = 0;
+		uint32_t max_us = 0;
+		uint32_t avg_us = 0;
+		uint32_t last_run_tick = 0; // System::get_ticks() when the action last ran
+
+		uint32_t ms_since_last_run() const {
+			return System::get_ticks() - last_run_tick;
+		}
+	};
+
+	// Statistics for this thread
+	Stats stats() const;
+	void reset_stats();
+
+	// Copies the statistics for all AsyncThreads (from all modules) into `out`.
+	// Returns the number of threads, which may be more than out.size().
+	static size_t all_stats(std::span<Stats> out);
+
 	~AsyncThread();
 
 private:
@@ -0,0 +1,261 @@
+#pragma once
+#include "threads/spin_lock.hh"
+#include "util/callable.hh"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+namespace MetaModule
+{
+
+// A request to read `size` frames (or bytes) starting at `offset` from a file.
+struct IoRequest {
+	// Identifies who will do the read, e.g. a WavFileStream*.
+	// Requests with the same file and adjacent ranges can be merged.
+	const void *file = nullptr;
+	uint32_t offset = 0;
+	uint32_t size = 0;
+
+	// Tick (System::get_ticks()) when the requester will run out of data
+	uint32_t deadline = 0;
+
+	// Helper to calculate a deadline from the number of frames left to play
+	static uint32_t deadline_in(uint32_t now, uint32_t frames_until_underrun, uint32_t sample_rate) {
+		return now + uint32_t(uint64_t(frames_until_underrun) * 1000 / sample_rate);
+	}
+};
+
+// IoScheduler coordinates disk reads from many modules. Instead of every
+// module reading from its own AsyncThread whenever it wants, the modules
+// submit requests with a deadline, and any AsyncThread can call run_next()
+// to service the most urgent request. Adjacent requests for the same file are
+// merged into a single larger read, which saves a seek.
+//
+// Usage:
+//     // In each module's AsyncThread:
+//     if (needs_data)
+//         IoScheduler<>::shared().submit({&stream, next_frame, frames, deadline},
+//                                        [this](IoRequest const &req) { read(req); });
+//     IoScheduler<>::shared().run_next();
+//
+// The read function may be called from another module's AsyncThread, so it must
+// only touch data that's safe to access from any AsyncThread. The read function
+// is never called for the same file on two cores at once.
+//
+// The scheduler is header-only and never allocates. There is one shared()
+// scheduler per plugin for each MaxRequests value.
+template<size_t MaxRequests = 32>
+class IoScheduler {
+public:
+	enum class Policy {
+		Fifo,			  // Oldest request first
+		EarliestDeadline, // Most urgent request first
+	};
+
+	using ReadFunc = Function<void(IoRequest const &)>;
+
+	struct Job {
+		IoRequest request;
+		ReadFunc read;
+	};
+
+	constexpr IoScheduler(Policy policy = Policy::EarliestDeadline, bool coalesce = true)
+		: policy{policy}
+		, coalesce{coalesce} {
+	}
+
+	static IoScheduler &shared() {
+		return shared_scheduler;
+	}
+
+	// Adds a request to the queue. If coalescing is enabled and a queued
+	// request for the same file is adjacent, the two are merged (keeping the
+	// earlier deadline and the queued request's read function).
+	// Returns false if the queue is full (or busy): try again later.
+	bool submit(IoRequest const &request, ReadFunc &&read) {
+		auto guard = SpinLockGuard{lock};
+		if (!guard)
+			return false;
+
+		if (coalesce) {
+			for (auto &slot : slots) {
+				if (slot.job && merge(slot.job->request, request)) {
+					num_merged++;
+					return true;
+				}
+			}
+		}
+
+		for (auto &slot : slots) {
+			if (!slot.job) {
+				slot.seq = next_seq++;
+				slot.job = Job{request, std::move(read)};
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Removes the next request from the queue, according to the policy.
+	// Requests for files which have a read in progress are skipped.
+	// Call finish() when the read is done.
+	std::optional<Job> take_next() {
+		auto guard = SpinLockGuard{lock};
+		if (!guard)
+			return std::nullopt;
+
+		std::atomic<const void *> *flight_slot = nullptr;
+		for (auto &file : in_flight) {
+			if (!file.load(std::memory_order_acquire)) {
+				flight_slot = &file;
+				break;
+			}
+		}
+		if (!flight_slot)
+			return std::nullopt;
+
+		Slot *next = nullptr;
+		for (auto &slot : slots) {
+			if (!slot.job || is_in_flight(slot.job->request.file))
+				continue;
+			if (!next || is_before(slot, *next))
+				next = &slot;
+		}
+
+		if (!next)
+			return std::nullopt;
+
+		flight_slot->store(next->job->request.file, std::memory_order_release);
+		auto job = std::move(next->job);
+		next->job.reset();
+		return job;
+	}
+
+	// Marks the file as no longer being read.
+	// This does not take the lock, so it can't fail.
+	void finish(Job const &job) {
+		for (auto &file : in_flight) {
+			if (!job.request.file)
+				break;
+			if (file.load(std::memory_order_acquire) == job.request.file) {
+				file.store(nullptr, std::memory_order_release);
+				break;
+			}
+		}
+		num_serviced++;
+	}
+
+	// Services the next request, if there is one.
+	// Returns false if there was nothing to do.
+	bool run_next() {
+		auto job = take_next();
+		if (!job)
+			return false;
+
+		job->read(job->request);
+		finish(*job);
+		return true;
+	}
+
+	// Number of queued requests (0 if the queue is busy)
+	size_t num_pending() {
+		auto guard = SpinLockGuard{lock};
+		if (!guard)
+			return 0;
+
+		size_t count = 0;
+		for (auto &slot : slots)
+			count += slot.job ? 1 : 0;
+		return count;
+	}
+
+	// Statistics
+	unsigned merged_count() const {
+		return num_merged;
+	}
+
+	unsigned serviced_count() const {
+		return num_serviced;
+	}
+
+	void set_policy(Policy new_policy) {
+		policy = new_policy;
+	}
+
+	void set_coalescing(bool enabled) {
+		coalesce = enabled;
+	}
+
+private:
+	// Empty when the slot is free. std::optional doesn't construct the Job
+	// until it's used, so the constructor can be constexpr.
+	struct Slot {
+		uint32_t seq = 0;
+		std::optional<Job> job;
+	};
+
+	std::array<Slot, MaxRequests> slots{};
+
+	// Files with a read in progress. There's at most one per core, unless
+	// take_next() is called several times before finish().
+	static constexpr size_t MaxInFlight = 4;
+	std::array<std::atomic<const void *>, MaxInFlight> in_flight{};
+
+	SpinLock lock;
+	Policy policy;
+	bool coalesce;
+	uint32_t next_seq = 0;
+	std::atomic<unsigned> num_merged = 0;
+	std::atomic<unsigned> num_serviced = 0;
+
+	// Plugins are built with -fno-threadsafe-statics, so a function-local
+	// static could be constructed twice by two threads. This is constant
+	// initialized instead, before any thread runs.
+	static IoScheduler shared_scheduler;
+
+	// Comparisons are done on the difference, so they work when the ticks wrap
+	static bool earlier(uint32_t a, uint32_t b) {
+		return int32_t(a - b) < 0;
+	}
+
+	bool is_before(Slot const &a, Slot const &b) const {
+		if (policy == Policy::EarliestDeadline && a.job->request.deadline != b.job->request.deadline)
+			return earlier(a.job->request.deadline, b.job->request.deadline);
+		return earlier(a.seq, b.seq);
+	}
+
+	bool is_in_flight(const void *file) const {
+		if (!file)
+			return false;
+		for (auto &f : in_flight) {
+			if (f.load(std::memory_order_acquire) == file)
+				return true;
+		}
+		return false;
+	}
+
+	static bool merge(IoRequest &queued, IoRequest const &req) {
+		if (queued.file != req.file)
+			return false;
+
+		if (req.offset == queued.offset + queued.size) {
+			queued.size += req.size;
+		} else if (queued.offset == req.offset + req.size) {
+			queued.offset = req.offset;
+			queued.size += req.size;
+		} else {
+			return false;
+		}
+
+		if (earlier(req.deadline, queued.deadline))
+			queued.deadline = req.deadline;
+		return true;
+	}
+};
+
+template<size_t MaxRequests>
+constinit IoScheduler<MaxRequests> IoScheduler<MaxRequests>::shared_scheduler{};
+
+} // namespace MetaModule
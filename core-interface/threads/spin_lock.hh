@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+
+namespace MetaModule
+{
+
+// There is no mutex on MetaModule, so this is a spin lock that gives up
+// after a while. If a thread with a higher priority tries to take the lock
+// while a thread on the same core holds it, spinning forever would deadlock.
+// So callers must have a fallback for when the lock can't be taken.
+// Only hold the lock for short operations (never while accessing the disk).
+//
+// Usage:
+//     if (auto guard = SpinLockGuard{lock}) {
+//         // ... access shared data
+//     } else {
+//         // ... lock was busy
+//     }
+//
+struct SpinLock {
+	static constexpr unsigned DefaultMaxSpins = 100'000;
+
+	bool try_lock(unsigned max_spins = DefaultMaxSpins) {
+		for (unsigned tries = 0; tries < max_spins; tries++) {
+			if (!flag.test_and_set(std::memory_order_acquire))
+				return true;
+		}
+		return false;
+	}
+
+	void unlock() {
+		flag.clear(std::memory_order_release);
+	}
+
+private:
+	std::atomic_flag flag;
+};
+
+struct SpinLockGuard {
+	SpinLockGuard(SpinLock &lock, unsigned max_spins = SpinLock::DefaultMaxSpins)
+		: lock{lock}
+		, locked{lock.try_lock(max_spins)} {
+	}
+
+	~SpinLockGuard() {
+		if (locked)
+			lock.unlock();
+	}
+
+	SpinLockGuard(SpinLockGuard const &) = delete;
+	SpinLockGuard &operator=(SpinLockGuard const &) = delete;
+
+	explicit operator bool() const {
+		return locked;
+	}
+
+private:
+	SpinLock &lock;
+	bool locked;
+};
+
+} // namespace MetaModule
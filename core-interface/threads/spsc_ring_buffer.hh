@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <span>
+
+namespace MetaModule
+{
+
+// Wait-free single-producer, single-consumer ring buffer.
+//
+// One thread (e.g. an AsyncThread) writes, and one other thread (e.g. the
+// audio thread) reads. Neither side ever blocks or allocates.
+//
+// The write and read counters only increase, the buffer index is the counter
+// modulo Size (which must be a power of 2). Each counter is on its own cache
+// line, along with the other side's counter cached by that side, so the two
+// threads only touch each other's cache line when the cached value says the
+// buffer is full or empty.
+//
+// Usage:
+//     SpscRingBuffer<float, 4096> buf;
+//
+//     // Async thread:
+//     buf.write(samples_from_disk);
+//
+//     // Audio thread:
+//     float out[64];
+//     auto num_read = buf.read(out);
+//
+template<typename T, size_t Size>
+class SpscRingBuffer {
+	static_assert(Size > 0 && (Size & (Size - 1)) == 0, "SpscRingBuffer Size must be a power of 2");
+
+public:
+	static constexpr size_t capacity() {
+		return Size;
+	}
+
+	////
+	/// Producer side
+	///
+
+	// Writes as many elements from `data` as will fit.
+	// Returns the number of elements written.
+	size_t write(std::span<const T> data) {
+		const auto wr = producer.index.load(std::memory_order_relaxed);
+		auto space = Size - (wr - producer.cached_other);
+		if (space < data.size()) {
+			producer.cached_other = consumer.index.load(std::memory_order_acquire);
+			space = Size - (wr - producer.cached_other);
+		}
+
+		const auto n = std::min(data.size(), space);
+		const auto start = wr & Mask;
+		const auto first = std::min(n, Size - start);
+		std::copy_n(data.begin(), first, buf.begin() + start);
+		std::copy_n(data.begin() + first, n - first, buf.begin());
+
+		producer.index.store(wr + n, std::memory_order_release);
+		return n;
+	}
+
+	// Writes one element. Returns false if the buffer is full.
+	bool push(const T &item) {
+		return write({&item, 1}) == 1;
+	}
+
+	// Number of elements that can be written.
+	size_t num_free() const {
+		return Size - num_filled();
+	}
+
+	////
+	/// Consumer side
+	///
+
+	// Reads up to out.size() elements into `out`.
+	// Returns the number of elements read.
+	size_t read(std::span<T> out) {
+		auto n = peek(out);
+		consumer.index.store(consumer.index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+		return n;
+	}
+
+	// Copies up to out.size() elements into `out` without removing them.
+	// Returns the number of elements copied.
+	size_t peek(std::span<T> out) {
+		const auto rd = consumer.index.load(std::memory_order_relaxed);
+		auto avail = consumer.cached_other - rd;
+		if (avail < out.size()) {
+			consumer.cached_other = producer.index.load(std::memory_order_acquire);
+			avail = consumer.cached_other - rd;
+		}
+
+		const auto n = std::min(out.size(), avail);
+		const auto start = rd & Mask;
+		const auto first = std::min(n, Size - start);
+		std::copy_n(buf.begin() + start, first, out.begin());
+		std::copy_n(buf.begin(), n - first, out.begin() + first);
+		return n;
+	}
+
+	// Reads one element. Returns false if the buffer is empty.
+	bool pop(T &item) {
+		return read({&item, 1}) == 1;
+	}
+
+	// Removes up to `count` elements without reading them.
+	// Returns the number of elements removed.
+	size_t discard(size_t count) {
+		const auto rd = consumer.index.load(std::memory_order_relaxed);
+		consumer.cached_other = producer.index.load(std::memory_order_acquire);
+		const auto n = std::min(count, consumer.cached_other - rd);
+		consumer.index.store(rd + n, std::memory_order_release);
+		return n;
+	}
+
+	////
+	/// Either side
+	///
+
+	// Number of elements that can be read.
+	// When called from the producer, this may be larger than the actual value.
+	// When called from the consumer, this may be smaller than the actual value.
+	size_t num_filled() const {
+		// Load the read index first, so it can never be ahead of the write index
+		const auto rd = consumer.index.load(std::memory_order_acquire);
+		return producer.index.load(std::memory_order_acquire) - rd;
+	}
+
+	bool empty() const {
+		return num_filled() == 0;
+	}
+
+	bool full() const {
+		return num_filled() == Size;
+	}
+
+	// Empties the buffer.
+	// Only call this when neither the producer or consumer are active.
+	void reset() {
+		producer.index = 0;
+		producer.cached_other = 0;
+		consumer.index = 0;
+		consumer.cached_other = 0;
+	}
+
+private:
+	static constexpr size_t Mask = Size - 1;
+
+	// Cortex-A7 L1 cache line size.
+	// Not std::hardware_destructive_interference_size, since that is not
+	// stable across compiler flags (GCC warns when it's used in a header).
+	static constexpr size_t CacheLineSize = 64;
+
+	struct alignas(CacheLineSize) Side {
+		std::atomic<size_t> index{0};
+		// This side's copy of the other side's index
+		size_t cached_other{0};
+	};
+
+	Side producer;
+	Side consumer;
+	alignas(CacheLineSize) std::array<T, Size> buf{};
+};
+
+} // namespace MetaModule
@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// The Quite OK Audio format (https://qoaformat.org), 3.2 bits per sample.
+// This implements the format as specified by the reference qoa.h:
+//
+//   File:  "qoaf" (u32) | total samples per channel (u32) | frames...
+//   Frame: channels (u8) | samplerate (u24) | samples per channel (u16) | frame bytes (u16)
+//          | LMS state for each channel (history[4], weights[4] as s16)
+//          | slices: for each group of 20 samples, one u64 per channel
+//   Slice: scalefactor (4 bits) | 20 residuals (3 bits each)
+//
+// All values are big-endian.
+
+namespace MetaModule::Qoa
+{
+
+constexpr uint32_t Magic = 0x716f6166; // "qoaf"
+constexpr unsigned HeaderBytes = 8;
+constexpr unsigned SliceLen = 20;
+constexpr unsigned SlicesPerFrame = 256;
+constexpr unsigned FrameLen = SliceLen * SlicesPerFrame;
+constexpr unsigned LmsLen = 4;
+constexpr unsigned MaxChannels = 8;
+
+constexpr unsigned frame_bytes(unsigned channels, unsigned samples_per_channel = FrameLen) {
+	unsigned slices = (samples_per_channel + SliceLen - 1) / SliceLen;
+	return 8 + LmsLen * 4 * channels + 8 * slices * channels;
+}
+
+namespace Detail
+{
+
+constexpr std::array<int, 16> scalefactor_tab{
+	1, 7, 21, 45, 84, 138, 211, 304, 421, 562, 731, 928, 1157, 1419, 1715, 2048};
+
+constexpr std::array<int, 16> reciprocal_tab{
+	65536, 9363, 3121, 1457, 781, 475, 311, 216, 156, 117, 90, 71, 57, 47, 39, 32};
+
+constexpr std::array<int, 17> quant_tab{
+	7, 7, 7, 5, 5, 3, 3, 1, // -8..-1
+	0,						// 0
+	0, 2, 2, 4, 4, 6, 6, 6	// 1..8
+};
+
+// scalefactor * {0.75, -0.75, 2.5, -2.5, 4.5, -4.5, 7, -7}, rounded away from 0
+constexpr auto dequant_tab = [] {
+	std::array<std::array<int, 8>, 16> tab{};
+	constexpr std::array<int, 4> x4{3, 10, 18, 28}; // 4 times the multipliers
+	for (unsigned s = 0; s < 16; s++) {
+		for (unsigned q = 0; q < 4; q++) {
+			int v = (scalefactor_tab[s] * x4[q] + 2) / 4;
+			tab[s][q * 2] = v;
+			tab[s][q * 2 + 1] = -v;
+		}
+	}
+	return tab;
+}();
+
+static_assert(dequant_tab[1][2] == 18 && dequant_tab[2][0] == 16 && dequant_tab[15][6] == 14336);
+
+struct Lms {
+	std::array<int, LmsLen> history{};
+	std::array<int, LmsLen> weights{};
+
+	int predict() const {
+		int prediction = 0;
+		for (unsigned i = 0; i < LmsLen; i++)
+			prediction += weights[i] * history[i];
+		return prediction >> 13;
+	}
+
+	void update(int sample, int residual) {
+		int delta = residual >> 4;
+		for (unsigned i = 0; i < LmsLen; i++)
+			weights[i] += history[i] < 0 ? -delta : delta;
+		for (unsigned i = 0; i < LmsLen - 1; i++)
+			history[i] = history[i + 1];
+		history[LmsLen - 1] = sample;
+	}
+};
+
+inline int clamp_s16(int v) {
+	return std::clamp(v, -32768, 32767);
+}
+
+inline uint64_t read_u64(const uint8_t *bytes) {
+	uint64_t v = 0;
+	for (unsigned i = 0; i < 8; i++)
+		v = (v << 8) | bytes[i];
+	return v;
+}
+
+inline void write_u64(std::vector<uint8_t> &out, uint64_t v) {
+	for (int i = 7; i >= 0; i--)
+		out.push_back(uint8_t(v >> (i * 8)));
+}
+
+} // namespace Detail
+
+struct FileInfo {
+	uint32_t total_frames = 0; // samples per channel
+	unsigned channels = 0;
+	unsigned sample_rate = 0;
+};
+
+// Reads the file header and the first frame header.
+// `bytes` must have at least 16 bytes. Returns false if it's not a QOA file.
+inline bool read_file_info(std::span<const uint8_t> bytes, FileInfo &info) {
+	if (bytes.size() < 16)
+		return false;
+
+	auto file_header = Detail::read_u64(bytes.data());
+	if ((file_header >> 32) != Magic)
+		return false;
+
+	auto frame_header = Detail::read_u64(bytes.data() + 8);
+	info.total_frames = uint32_t(file_header);
+	info.channels = (frame_header >> 56) & 0xff;
+	info.sample_rate = (frame_header >> 32) & 0xffffff;
+	return info.channels > 0 && info.channels <= MaxChannels && info.sample_rate > 0;
+}
+
+// Decodes one frame into `out` (interleaved, at least FrameLen * channels samples).
+// Returns the number of samples per channel decoded, or 0 if the frame is invalid.
+inline unsigned decode_frame(std::span<const uint8_t> bytes, unsigned channels, std::span<int16_t> out) {
+	if (bytes.size() < 8 + LmsLen * 4 * channels)
+		return 0;
+
+	auto *p = bytes.data();
+	auto frame_header = Detail::read_u64(p);
+	p += 8;
+
+	unsigned frame_channels = (frame_header >> 56) & 0xff;
+	unsigned samples = (frame_header >> 16) & 0xffff;
+	unsigned size = frame_header & 0xffff;
+
+	if (frame_channels != channels || samples > FrameLen || size > bytes.size() ||
+		size < frame_bytes(channels, samples) || out.size() < samples * channels)
+		return 0;
+
+	std::array<Detail::Lms, MaxChannels> lms;
+	for (unsigned c = 0; c < channels; c++) {
+		auto history = Detail::read_u64(p);
+		auto weights = Detail::read_u64(p + 8);
+		p += 16;
+		for (unsigned i = 0; i < LmsLen; i++) {
+			lms[c].history[i] = int16_t(history >> 48);
+			history <<= 16;
+			lms[c].weights[i] = int16_t(weights >> 48);
+			weights <<= 16;
+		}
+	}
+
+	for (unsigned sample_index = 0; sample_index < samples; sample_index += SliceLen) {
+		for (unsigned c = 0; c < channels; c++) {
+			auto slice = Detail::read_u64(p);
+			p += 8;
+
+			auto &dequant = Detail::dequant_tab[(slice >> 60) & 0xf];
+			slice <<= 4;
+
+			unsigned slice_end = std::min(sample_index + SliceLen, samples);
+			for (unsigned i = sample_index; i < slice_end; i++) {
+				int predicted = lms[c].predict();
+				int dequantized = dequant[(slice >> 61) & 0x7];
+				int reconstructed = Detail::clamp_s16(predicted + dequantized);
+				out[i * channels + c] = int16_t(reconstructed);
+				slice <<= 3;
+				lms[c].update(reconstructed, dequantized);
+			}
+		}
+	}
+
+	return samples;
+}
+
+// Encodes interleaved 16-bit samples into a complete QOA file.
+// This searches all scalefactors for each slice, so it's much slower than decoding.
+inline std::vector<uint8_t> encode(std::span<const int16_t> interleaved, unsigned channels, unsigned sample_rate) {
+	std::vector<uint8_t> out;
+	if (channels == 0 || channels > MaxChannels)
+		return out;
+
+	const uint32_t total = interleaved.size() / channels;
+	Detail::write_u64(out, (uint64_t(Magic) << 32) | total);
+
+	std::array<Detail::Lms, MaxChannels> lms;
+	for (unsigned c = 0; c < channels; c++)
+		lms[c].weights = {0, 0, -(1 << 13), 1 << 14};
+	std::array<unsigned, MaxChannels> prev_scalefactor{};
+
+	for (uint32_t frame_start = 0; frame_start < total; frame_start += FrameLen) {
+		unsigned frame_len = std::min<uint32_t>(FrameLen, total - frame_start);
+		auto samples = interleaved.subspan(frame_start * channels, frame_len * channels);
+
+		Detail::write_u64(out,
+						  (uint64_t(channels) << 56) | (uint64_t(sample_rate) << 32) | (uint64_t(frame_len) << 16) |
+							  frame_bytes(channels, frame_len));
+
+		for (unsigned c = 0; c < channels; c++) {
+			uint64_t history = 0, weights = 0;
+			for (unsigned i = 0; i < LmsLen; i++) {
+				history = (history << 16) | (lms[c].history[i] & 0xffff);
+				weights = (weights << 16) | (lms[c].weights[i] & 0xffff);
+			}
+			Detail::write_u64(out, history);
+			Detail::write_u64(out, weights);
+		}
+
+		for (unsigned sample_index = 0; sample_index < frame_len; sample_index += SliceLen) {
+			for (unsigned c = 0; c < channels; c++) {
+				unsigned slice_len = std::min(SliceLen, frame_len - sample_index);
+
+				uint64_t best_rank = UINT64_MAX;
+				uint64_t best_slice = 0;
+				Detail::Lms best_lms;
+				unsigned best_scalefactor = 0;
+
+				for (unsigned sfi = 0; sfi < 16; sfi++) {
+					// Start the search at the previous slice's scalefactor: it's likely the best
+					unsigned scalefactor = (sfi + prev_scalefactor[c]) % 16;
+					auto trial_lms = lms[c];
+					uint64_t slice = scalefactor;
+					uint64_t rank = 0;
+
+					for (unsigned i = sample_index; i < sample_index + slice_len; i++) {
+						int sample = samples[i * channels + c];
+						int predicted = trial_lms.predict();
+						int residual = sample - predicted;
+
+						int reciprocal = Detail::reciprocal_tab[scalefactor];
+						int scaled = (residual * reciprocal + (1 << 15)) >> 16;
+						scaled = scaled + ((residual > 0) - (residual < 0)) - ((scaled > 0) - (scaled < 0));
+						int quantized = Detail::quant_tab[std::clamp(scaled, -8, 8) + 8];
+						int dequantized = Detail::dequant_tab[scalefactor][quantized];
+						int reconstructed = Detail::clamp_s16(predicted + dequantized);
+
+						auto &w = trial_lms.weights;
+						int64_t weights_penalty =
+							((int64_t(w[0]) * w[0] + int64_t(w[1]) * w[1] + int64_t(w[2]) * w[2] + int64_t(w[3]) * w[3]) >> 18) - 0x8ff;
+						if (weights_penalty < 0)
+							weights_penalty = 0;
+
+						int64_t error = sample - reconstructed;
+						rank += error * error + weights_penalty * weights_penalty;
+						if (rank > best_rank)
+							break;
+
+						trial_lms.update(reconstructed, dequantized);
+						slice = (slice << 3) | quantized;
+					}
+
+					if (rank < best_rank) {
+						best_rank = rank;
+						best_slice = slice;
+						best_lms = trial_lms;
+						best_scalefactor = scalefactor;
+					}
+				}
+
+				prev_scalefactor[c] = best_scalefactor;
+				lms[c] = best_lms;
+
+				// A short last slice is padded with zero residuals
+				best_slice <<= (SliceLen - slice_len) * 3;
+				Detail::write_u64(out, best_slice);
+			}
+		}
+	}
+
+	return out;
+}
+
+} // namespace MetaModule::Qoa
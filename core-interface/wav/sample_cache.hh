@@ -0,0 +1,235 @@
+#pragma once
+#include "system/memory.hh"
+#include "threads/spin_lock.hh"
+#include "wav/sample_decoder.hh"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <vector>
+
+namespace MetaModule
+{
+
+// A sample file decoded into RAM, shared by all users of the SampleCache.
+// Any format that open_sample_decoder() supports can be loaded (WAV, QOA, FLAC).
+// The data is never modified once it's loaded, so it's safe to read from
+// any thread (including the audio thread) while you hold the shared_ptr.
+struct CachedSample {
+	std::string path;
+	unsigned channels = 0;
+	unsigned sample_rate = 0;
+
+	// Interleaved samples, in the range -1 to +1
+	std::vector<float> samples;
+
+	size_t num_frames() const {
+		return channels ? samples.size() / channels : 0;
+	}
+
+	size_t size_bytes() const {
+		return samples.size() * sizeof(float);
+	}
+
+	std::span<const float> frame(size_t frame_num) const {
+		return {&samples[frame_num * channels], channels};
+	}
+};
+
+// SampleCache decodes each sample file once and shares the decoded data between
+// all modules which load the same file. This is useful when a user has
+// several copies of a sample player module playing the same file.
+//
+// Files are identified by their path and modification time, so if a file is
+// changed on disk it will be loaded again.
+//
+// When the total size of the cached files goes over the memory budget, the
+// least recently loaded files which are not in use are removed. Files that are
+// in use (that is, some module holds a shared_ptr to it) are never removed.
+//
+// Usage:
+//     // In an AsyncThread or the module constructor:
+//     sample = SampleCache::shared().load("sdc:/samples/kick.wav");
+//
+//     // In the audio thread:
+//     if (sample && pos < sample->num_frames())
+//         out = sample->frame(pos)[0];
+//
+// Do not call load() from the audio thread, since it reads from disk.
+//
+// The cache is header-only, so there is one cache per plugin, shared by all
+// the modules in the plugin.
+class SampleCache {
+public:
+	// The cache instance that's shared between all modules in the plugin
+	static SampleCache &shared() {
+		static SampleCache cache;
+		return cache;
+	}
+
+	// Returns the decoded file, loading it from disk if it's not in the cache
+	// or if the file has changed. Returns nullptr if the file cannot be read,
+	// or if it's larger than the memory budget or the free memory.
+	std::shared_ptr<const CachedSample> load(std::string_view path) {
+		std::string filename{path};
+
+		struct stat st {};
+		if (::stat(filename.c_str(), &st) != 0)
+			return nullptr;
+		const auto mtime = st.st_mtime;
+
+		// Declared before the guards, so removed samples are freed after the
+		// lock is released
+		std::vector<Entry> removed;
+
+		if (auto guard = SpinLockGuard{lock}) {
+			if (auto entry = find(filename)) {
+				if (entry->mtime == mtime) {
+					entry->last_used = ++use_counter;
+					return entry->sample;
+				}
+				remove(filename, removed);
+			}
+		}
+
+		// Decode without holding the lock, this may take a while
+		auto sample = decode(filename);
+		if (!sample)
+			return nullptr;
+
+		if (auto guard = SpinLockGuard{lock}) {
+			// Another thread may have loaded the same file while we were decoding
+			if (auto entry = find(filename); entry && entry->mtime == mtime) {
+				entry->last_used = ++use_counter;
+				return entry->sample;
+			}
+
+			total_bytes += sample->size_bytes();
+			entries.push_back({filename, mtime, sample, ++use_counter});
+			evict(max_bytes(), removed);
+		}
+
+		// If the lock was busy, the sample is returned without being cached
+		return sample;
+	}
+
+	// Sets the memory budget as a fraction of the total of the cached files
+	// plus the free memory. Default is 0.25
+	void set_memory_fraction(float fraction) {
+		memory_fraction = fraction;
+	}
+
+	// Sets the memory budget in bytes. This overrides set_memory_fraction().
+	// Set to 0 to use the memory fraction again.
+	void set_max_bytes(size_t bytes) {
+		fixed_max_bytes = bytes;
+	}
+
+	// The memory budget, in bytes
+	size_t max_bytes() const {
+		if (fixed_max_bytes)
+			return fixed_max_bytes;
+		return size_t(memory_fraction * float(System::free_memory() + total_bytes));
+	}
+
+	// Total size of all cached files
+	size_t cached_bytes() const {
+		return total_bytes;
+	}
+
+	// Removes all files which are not in use
+	void evict_unused() {
+		std::vector<Entry> removed;
+		if (auto guard = SpinLockGuard{lock})
+			evict(0, removed);
+	}
+
+private:
+	struct Entry {
+		std::string path;
+		time_t mtime;
+		std::shared_ptr<const CachedSample> sample;
+		uint32_t last_used;
+	};
+
+	std::vector<Entry> entries;
+	std::atomic<size_t> total_bytes = 0;
+	uint32_t use_counter = 0;
+
+	float memory_fraction = 0.25f;
+	size_t fixed_max_bytes = 0;
+
+	// If the lock is busy, the cache is not used
+	SpinLock lock;
+
+	Entry *find(std::string const &path) {
+		for (auto &entry : entries) {
+			if (entry.path == path)
+				return &entry;
+		}
+		return nullptr;
+	}
+
+	// The functions that remove entries move them into `removed`. Call them
+	// with the lock held, and destroy `removed` after releasing it.
+
+	void remove(std::string const &path, std::vector<Entry> &removed) {
+		std::erase_if(entries, [&](Entry &entry) {
+			if (entry.path != path)
+				return false;
+			total_bytes -= entry.sample->size_bytes();
+			removed.push_back(std::move(entry));
+			return true;
+		});
+	}
+
+	// Removes the least recently used entries which are not in use,
+	// until the total size is no more than max.
+	void evict(size_t max, std::vector<Entry> &removed) {
+		while (total_bytes > max) {
+			Entry *oldest = nullptr;
+			for (auto &entry : entries) {
+				if (entry.sample.use_count() == 1 && (!oldest || entry.last_used < oldest->last_used))
+					oldest = &entry;
+			}
+			if (!oldest)
+				return;
+
+			total_bytes -= oldest->sample->size_bytes();
+			removed.push_back(std::move(*oldest));
+			entries.erase(entries.begin() + (oldest - entries.data()));
+		}
+	}
+
+	std::shared_ptr<CachedSample> decode(std::string const &path) const {
+		auto decoder = open_sample_decoder(path);
+		if (!decoder || decoder->num_channels() == 0)
+			return nullptr;
+
+		// Check the size before allocating: without exceptions, a failed
+		// allocation aborts. The header may also be corrupt.
+		const auto total_frames = decoder->total_frames();
+		const size_t max_frames = std::min<size_t>(max_bytes(), System::free_memory()) / sizeof(float) / decoder->num_channels();
+		if (total_frames > max_frames)
+			return nullptr;
+
+		auto sample = std::make_shared<CachedSample>();
+		sample->path = path;
+		sample->channels = decoder->num_channels();
+		sample->sample_rate = decoder->sample_rate();
+		sample->samples.resize(total_frames * sample->channels);
+
+		auto frames_read = decoder->read_frames(sample->samples);
+		if (frames_read != total_frames)
+			return nullptr;
+
+		return sample;
+	}
+};
+
+} // namespace MetaModule
@@ -0,0 +1,274 @@
+#pragma once
+#include "filesystem/file_seek.hh"
+#include "wav/dr_wav.h"
+#include "wav/qoa.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// FLAC support uses dr_flac, which is not part of the SDK. To enable it, add
+// dr_flac.h to your plugin's include path, and define DR_FLAC_IMPLEMENTATION
+// in one of your plugin's source files before including it.
+#if __has_include("dr_flac.h")
+#include "dr_flac.h"
+#define METAMODULE_SAMPLE_DECODER_FLAC 1
+#endif
+
+namespace MetaModule
+{
+
+// Interface for decoding an audio file into float samples, a block at a time.
+// Use open_sample_decoder() to get a decoder for a file, based on its extension:
+//   .wav: dr_wav (all formats dr_wav supports)
+//   .qoa: Quite OK Audio
+//   .flac: dr_flac (only if dr_flac.h is found, see above)
+//
+// Decoding reads from disk, so do not use a decoder in the audio thread.
+struct SampleDecoder {
+	virtual ~SampleDecoder() = default;
+
+	virtual unsigned num_channels() const = 0;
+	virtual unsigned sample_rate() const = 0;
+	virtual uint64_t total_frames() const = 0;
+
+	// Decodes up to out.size() / num_channels() frames into `out` (interleaved,
+	// in the range -1 to 1). Returns the number of frames decoded, which is 0
+	// at the end of the file or if there's an error.
+	virtual unsigned read_frames(std::span<float> out) = 0;
+
+	// The next call to read_frames() will start at this frame
+	virtual bool seek_to_frame(uint64_t frame) = 0;
+};
+
+class WavDecoder : public SampleDecoder {
+public:
+	bool open(std::string_view path) {
+		close();
+		is_open = drwav_init_file(&wav, std::string{path}.c_str(), nullptr);
+		return is_open;
+	}
+
+	void close() {
+		if (is_open)
+			drwav_uninit(&wav);
+		is_open = false;
+	}
+
+	~WavDecoder() override {
+		close();
+	}
+
+	unsigned num_channels() const override {
+		return wav.channels;
+	}
+
+	unsigned sample_rate() const override {
+		return wav.sampleRate;
+	}
+
+	uint64_t total_frames() const override {
+		return wav.totalPCMFrameCount;
+	}
+
+	unsigned read_frames(std::span<float> out) override {
+		if (!is_open || !wav.channels)
+			return 0;
+		return drwav_read_pcm_frames_f32(&wav, out.size() / wav.channels, out.data());
+	}
+
+	bool seek_to_frame(uint64_t frame) override {
+		return is_open && drwav_seek_to_pcm_frame(&wav, frame);
+	}
+
+private:
+	drwav wav{};
+	bool is_open = false;
+};
+
+// Decodes QOA files one frame (5120 samples per channel) at a time
+class QoaDecoder : public SampleDecoder {
+public:
+	bool open(std::string_view path) {
+		close();
+
+		fp = std::fopen(std::string{path}.c_str(), "rb");
+		if (!fp)
+			return false;
+
+		std::array<uint8_t, 16> header;
+		if (std::fread(header.data(), 1, header.size(), fp) != header.size() || !Qoa::read_file_info(header, info)) {
+			close();
+			return false;
+		}
+
+		frame_data.resize(Qoa::frame_bytes(info.channels));
+		decoded.resize(Qoa::FrameLen * info.channels);
+		return seek_to_frame(0);
+	}
+
+	void close() {
+		if (fp)
+			std::fclose(fp);
+		fp = nullptr;
+	}
+
+	~QoaDecoder() override {
+		close();
+	}
+
+	unsigned num_channels() const override {
+		return info.channels;
+	}
+
+	unsigned sample_rate() const override {
+		return info.sample_rate;
+	}
+
+	uint64_t total_frames() const override {
+		return info.total_frames;
+	}
+
+	unsigned read_frames(std::span<float> out) override {
+		if (!fp)
+			return 0;
+
+		const unsigned max_frames = out.size() / info.channels;
+		unsigned num_frames = 0;
+
+		while (num_frames < max_frames) {
+			if (decoded_pos == decoded_frames && !decode_next_frame())
+				break;
+
+			auto n = std::min(max_frames - num_frames, decoded_frames - decoded_pos);
+			auto src = std::span{decoded}.subspan(decoded_pos * info.channels, n * info.channels);
+			auto dst = out.subspan(num_frames * info.channels, src.size());
+			for (unsigned i = 0; i < src.size(); i++)
+				dst[i] = src[i] * (1.f / 32768.f);
+
+			decoded_pos += n;
+			num_frames += n;
+		}
+
+		return num_frames;
+	}
+
+	bool seek_to_frame(uint64_t frame) override {
+		if (!fp || frame > info.total_frames)
+			return false;
+
+		// All frames except the last have the same size, so the file position can be calculated
+		auto frame_index = frame / Qoa::FrameLen;
+		auto offset = Qoa::HeaderBytes + frame_index * Qoa::frame_bytes(info.channels);
+		if (!Filesystem::seek_to(fp, offset))
+			return false;
+
+		decoded_pos = 0;
+		decoded_frames = 0;
+
+		auto skip = unsigned(frame % Qoa::FrameLen);
+		if (skip) {
+			if (!decode_next_frame())
+				return false;
+			decoded_pos = std::min(skip, decoded_frames);
+		}
+		return true;
+	}
+
+private:
+	std::FILE *fp = nullptr;
+	Qoa::FileInfo info;
+	std::vector<uint8_t> frame_data;
+	std::vector<int16_t> decoded;
+	unsigned decoded_frames = 0;
+	unsigned decoded_pos = 0;
+
+	bool decode_next_frame() {
+		auto num_read = std::fread(frame_data.data(), 1, frame_data.size(), fp);
+		decoded_frames = Qoa::decode_frame(std::span{frame_data}.first(num_read), info.channels, decoded);
+		decoded_pos = 0;
+		return decoded_frames > 0;
+	}
+};
+
+#ifdef METAMODULE_SAMPLE_DECODER_FLAC
+class FlacDecoder : public SampleDecoder {
+public:
+	bool open(std::string_view path) {
+		close();
+		flac = drflac_open_file(std::string{path}.c_str(), nullptr);
+		return flac != nullptr;
+	}
+
+	void close() {
+		if (flac)
+			drflac_close(flac);
+		flac = nullptr;
+	}
+
+	~FlacDecoder() override {
+		close();
+	}
+
+	unsigned num_channels() const override {
+		return flac ? flac->channels : 0;
+	}
+
+	unsigned sample_rate() const override {
+		return flac ? flac->sampleRate : 0;
+	}
+
+	uint64_t total_frames() const override {
+		return flac ? flac->totalPCMFrameCount : 0;
+	}
+
+	unsigned read_frames(std::span<float> out) override {
+		if (!flac)
+			return 0;
+		return drflac_read_pcm_frames_f32(flac, out.size() / flac->channels, out.data());
+	}
+
+	bool seek_to_frame(uint64_t frame) override {
+		return flac && drflac_seek_to_pcm_frame(flac, frame);
+	}
+
+private:
+	drflac *flac = nullptr;
+};
+#endif
+
+// Returns a decoder for the file, chosen by the file extension (case-insensitive),
+// or nullptr if the format is not supported or the file cannot be opened.
+inline std::unique_ptr<SampleDecoder> open_sample_decoder(std::string_view path) {
+	auto ext_is = [path](std::string_view ext) {
+		if (path.size() < ext.size())
+			return false;
+		auto tail = path.substr(path.size() - ext.size());
+		return std::equal(tail.begin(), tail.end(), ext.begin(), [](char a, char b) {
+			return (a >= 'A' && a <= 'Z' ? a + ('a' - 'A') : a) == b;
+		});
+	};
+
+	auto try_open = [path](auto decoder) -> std::unique_ptr<SampleDecoder> {
+		if (decoder->open(path))
+			return decoder;
+		return nullptr;
+	};
+
+	if (ext_is(".qoa"))
+		return try_open(std::make_unique<QoaDecoder>());
+
+#ifdef METAMODULE_SAMPLE_DECODER_FLAC
+	if (ext_is(".flac"))
+		return try_open(std::make_unique<FlacDecoder>());
+#endif
+
+	return try_open(std::make_unique<WavDecoder>());
+}
+
+} // namespace MetaModule
@@ -0,0 +1,280 @@
+#pragma once
+#include "threads/spsc_ring_buffer.hh"
+#include "wav/sample_decoder.hh"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace MetaModule
+{
+
+// SampleStream plays a file from disk through a pre-buffer, like WavFileStream,
+// but decodes any format that open_sample_decoder() supports (WAV, QOA, and
+// FLAC if dr_flac.h is available). Compressed files take a fraction of the
+// space on disk: QOA is 3.2 bits per sample (1/5 of 16-bit WAV), FLAC is
+// usually about 1/2.
+//
+// The async thread decodes a block at a time into the pre-buffer, and the
+// audio thread reads from it without blocking:
+//
+//     SampleStream<> stream;
+//
+//     // Async thread:
+//     if (!stream.is_loaded())
+//         stream.load("sdc:/loops/drums.qoa");
+//     stream.read_frames_from_file();
+//
+//     // Audio thread:
+//     float frame[2];
+//     if (stream.pop_frames(frame, 1) == 0 && stream.is_eof())
+//         stream.reset_playback_to_frame(0); // loop
+//
+// load(), unload(), and read_frames_from_file() must all be called from the
+// same (async) thread. The pop functions and reset_playback_to_frame() must
+// all be called from the audio thread.
+//
+// BufferSamples is the size of the pre-buffer in samples (not frames), and
+// must be a power of 2.
+template<size_t BufferSamples = 32 * 1024>
+class SampleStream {
+public:
+	// The most frames that read_frames_from_file() decodes at once
+	static constexpr unsigned DecodeBlockFrames = 1024;
+
+	////
+	/// Async thread
+	///
+
+	// Opens the file. The audio thread will see no frames until it has
+	// emptied the buffer of the previous file (in its next pop or
+	// frames_available() call), and read_frames_from_file() has been
+	// called after that.
+	// Returns false if the file can't be opened or the format is not supported.
+	bool load(std::string_view path) {
+		unload();
+
+		decoder = open_sample_decoder(path);
+		if (!decoder || decoder->num_channels() == 0)
+			return false;
+
+		if (decoder->num_channels() > BufferSamples) {
+			decoder.reset();
+			return false;
+		}
+		channels.store(decoder->num_channels(), std::memory_order_relaxed);
+		rate.store(decoder->sample_rate(), std::memory_order_relaxed);
+		length.store(uint32_t(std::min<uint64_t>(decoder->total_frames(), UINT32_MAX)), std::memory_order_relaxed);
+		scratch.resize(DecodeBlockFrames * decoder->num_channels());
+
+		// Have the audio thread discard anything left from the previous file
+		request_seek(0);
+		loaded.store(true, std::memory_order_release);
+		return true;
+	}
+
+	void unload() {
+		loaded.store(false, std::memory_order_release);
+		decoder.reset();
+	}
+
+	bool is_loaded() const {
+		return loaded.load(std::memory_order_acquire);
+	}
+
+	// Decodes up to max_frames frames from the file into the pre-buffer,
+	// limited by the space in the buffer.
+	// Returns the number of frames decoded.
+	// This reads from disk: DO NOT CALL THIS FROM THE AUDIO THREAD.
+	unsigned read_frames_from_file(unsigned max_frames = BufferSamples) {
+		if (!decoder)
+			return 0;
+
+		const auto request = seek_request.load(std::memory_order_acquire);
+		if (request != seek_ack.load(std::memory_order_relaxed)) {
+			// A seek is pending. Stop writing, and wait until the audio thread
+			// has emptied the buffer after seeing that, so it never sees
+			// frames from before the seek, and never discards frames from after.
+			if (seek_drained.load(std::memory_order_acquire) != request) {
+				seek_stopped.store(request, std::memory_order_release);
+				return 0;
+			}
+
+			auto frame = seek_frame.load(std::memory_order_relaxed);
+			file_error.store(!decoder->seek_to_frame(frame), std::memory_order_relaxed);
+			eof.store(false, std::memory_order_relaxed);
+			seek_ack.store(request, std::memory_order_release);
+		}
+
+		if (eof.load(std::memory_order_relaxed) || file_error.load(std::memory_order_relaxed))
+			return 0;
+
+		const unsigned channels = this->channels.load(std::memory_order_relaxed);
+		unsigned total = 0;
+		while (total < max_frames) {
+			const unsigned space = buffer.num_free() / channels;
+			const unsigned num_frames = std::min({space, max_frames - total, DecodeBlockFrames});
+			if (num_frames == 0)
+				break;
+
+			auto decoded = decoder->read_frames(std::span{scratch}.first(num_frames * channels));
+			buffer.write(std::span<const float>{scratch}.first(decoded * channels));
+			total += decoded;
+
+			if (decoded < num_frames) {
+				eof.store(true, std::memory_order_release);
+				break;
+			}
+		}
+
+		return total;
+	}
+
+	////
+	/// Audio thread
+	///
+
+	// Copies up to max_frames interleaved frames into `out`, limited by the
+	// size of `out` and the number of frames available.
+	// Returns the number of frames copied.
+	unsigned pop_frames(std::span<float> out, unsigned max_frames) {
+		if (!sync_with_reader())
+			return 0;
+
+		const unsigned channels = this->channels.load(std::memory_order_relaxed);
+		max_frames = std::min<unsigned>(max_frames, out.size() / channels);
+		auto num_frames = buffer.read(out.first(max_frames * channels)) / channels;
+		playback_frame.store(playback_frame.load(std::memory_order_relaxed) + num_frames, std::memory_order_relaxed);
+		return num_frames;
+	}
+
+	// Returns the next sample, or 0 if there are none available.
+	// For a stereo file, call this twice in a row to get the whole frame.
+	float pop_sample() {
+		float sample = 0;
+		if (sync_with_reader() && buffer.pop(sample) && ++sample_in_frame >= channels.load(std::memory_order_relaxed)) {
+			sample_in_frame = 0;
+			playback_frame.store(playback_frame.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		return sample;
+	}
+
+	// Number of whole frames in the pre-buffer
+	unsigned frames_available() {
+		if (!sync_with_reader())
+			return 0;
+		return buffer.num_filled() / channels.load(std::memory_order_relaxed);
+	}
+
+	// Discards the pre-buffer and has the async thread continue decoding from
+	// this frame. No frames are available until the async thread has seeked.
+	void reset_playback_to_frame(uint32_t frame_num) {
+		request_seek(frame_num);
+	}
+
+	////
+	/// Either thread
+	///
+
+	// Whether the file has been decoded to the end.
+	// When this is true and frames_available() is 0, the whole file has been played.
+	bool is_eof() const {
+		return eof.load(std::memory_order_acquire) && !seek_pending();
+	}
+
+	bool is_file_error() const {
+		return file_error.load(std::memory_order_relaxed);
+	}
+
+	// The index of the next frame that pop_frames() will return
+	uint32_t current_playback_frame() const {
+		return playback_frame.load(std::memory_order_relaxed);
+	}
+
+	////
+	/// File information (valid after load() returns true)
+	///
+
+	unsigned num_channels() const {
+		return is_loaded() ? channels.load(std::memory_order_relaxed) : 0;
+	}
+
+	unsigned sample_rate() const {
+		return is_loaded() ? rate.load(std::memory_order_relaxed) : 0;
+	}
+
+	uint32_t total_frames() const {
+		return is_loaded() ? length.load(std::memory_order_relaxed) : 0;
+	}
+
+	static constexpr size_t buffer_samples() {
+		return BufferSamples;
+	}
+
+private:
+	std::unique_ptr<SampleDecoder> decoder;
+	std::vector<float> scratch;
+
+	// Copied from the decoder, so the audio thread never touches the decoder
+	std::atomic<unsigned> channels = 1;
+	std::atomic<unsigned> rate = 0;
+	std::atomic<uint32_t> length = 0;
+
+	SpscRingBuffer<float, BufferSamples> buffer;
+
+	std::atomic<bool> loaded = false;
+	std::atomic<bool> eof = false;
+	std::atomic<bool> file_error = false;
+
+	// Seeking: the requester sets seek_frame and increments seek_request. Then:
+	// 1) The async thread stops writing and sets seek_stopped = seek_request.
+	// 2) The audio thread sees that, empties the buffer once, and sets seek_drained.
+	// 3) The async thread sees that, seeks, sets seek_ack, and writes new frames.
+	// The audio thread reads nothing until seek_ack matches seek_request.
+	std::atomic<uint32_t> seek_frame = 0;
+	std::atomic<uint32_t> seek_request = 0;
+	std::atomic<uint32_t> seek_stopped = 0;
+	std::atomic<uint32_t> seek_drained = 0;
+	std::atomic<uint32_t> seek_ack = 0;
+
+	// Audio thread only
+	std::atomic<uint32_t> playback_frame = 0;
+	unsigned sample_in_frame = 0;
+
+	void request_seek(uint32_t frame_num) {
+		seek_frame.store(frame_num, std::memory_order_relaxed);
+		playback_frame.store(frame_num, std::memory_order_relaxed);
+		seek_request.fetch_add(1, std::memory_order_release);
+	}
+
+	bool seek_pending() const {
+		return seek_request.load(std::memory_order_acquire) != seek_ack.load(std::memory_order_acquire);
+	}
+
+	// Returns false if the buffer can't be read (not loaded, or waiting for a seek)
+	bool sync_with_reader() {
+		if (!is_loaded())
+			return false;
+
+		if (seek_pending()) {
+			// Only empty the buffer once the async thread has stopped writing
+			// frames from before the seek. After that, it only writes frames
+			// from after the seek, so the buffer must not be emptied again.
+			const auto request = seek_request.load(std::memory_order_acquire);
+			if (seek_stopped.load(std::memory_order_acquire) == request &&
+				seek_drained.load(std::memory_order_relaxed) != request)
+			{
+				buffer.discard(BufferSamples);
+				seek_drained.store(request, std::memory_order_release);
+			}
+			sample_in_frame = 0;
+			return false;
+		}
+		return true;
+	}
+};
+
+} // namespace MetaModule
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string_view>
 
 namespace MetaModule
@@ -26,6 +27,23 @@ struct WavFileStream {
 	size_t buffer_samples() const;
 	size_t buffer_frames() const;
 
+	// How the samples are stored in the buffer:
+	// Float: converted to float when read from the file (default)
+	// Native: 16-bit and 24-bit PCM files are kept in their original format,
+	//   and converted to float when popped. This uses 1/2 or 3/4 the memory.
+	//   Other formats are stored as floats.
+	// Either way, the popped samples are identical.
+	enum class BufferFormat { Float, Native };
+
+	// Sets the buffer format.
+	// If needed, the buffer may be cleared and reset.
+	// Returns true if this happens, false if not.
+	bool set_buffer_format(BufferFormat format);
+	BufferFormat buffer_format() const;
+
+	// Returns the size of the buffer in bytes
+	size_t buffer_bytes() const;
+
 	////
 	/// Load/unloading wav file:
 	///
@@ -54,11 +72,43 @@ struct WavFileStream {
 	void read_frames_from_file();
 	void read_frames_from_file(int num_frames);
 
+	// Adaptive read-ahead: the stream measures how fast frames are being
+	// popped, and how long reads from the file take. From these it works out
+	// how far ahead it needs to read to avoid running out.
+	// Call these from the Async thread:
+	//
+	//     if (stream.needs_refill())
+	//         stream.read_frames_from_file(stream.suggested_read_frames());
+	//
+	// needs_refill() returns true if the buffered frames will not last until
+	// a read started now is likely to finish.
+	bool needs_refill();
+
+	// The number of frames to read: enough to cover the playback during a
+	// slow read, limited by the space in the buffer.
+	unsigned suggested_read_frames() const;
+
+	// The number of times the buffer has run empty while playing (that is,
+	// a pop when no frames were available and the file was not at the end).
+	unsigned underrun_count() const;
+
 	// Call this from the audio context to get the next sample.
 	// Keep in mind if your file is stereo, then you should call this
 	// twice in a row to get the whole frame.
 	float pop_sample();
 
+	// Call this from the audio context to get a run of whole frames at once.
+	// Copies up to max_frames interleaved frames into `out`, limited by the
+	// size of `out` and the number of frames available.
+	// Returns the number of frames copied.
+	// This is much more efficient than calling pop_sample() for each sample,
+	// since the buffer position is only updated once.
+	unsigned pop_frames(std::span<float> out, unsigned max_frames);
+
+	// Same as pop_frames(), but does not remove the frames from the buffer.
+	// Useful for interpolators that need to look ahead.
+	unsigned peek_frames(std::span<float> out, unsigned max_frames) const;
+
 	////
 	/// Current state of playback and buffering
 	///
@@ -106,6 +156,58 @@ struct WavFileStream {
 	// Must be called by async filesystem thread.
 	void seek_frame_in_file(uint32_t frame_num = 0);
 
+	// Playback direction. In Reverse, frames are popped backwards from the
+	// play head (the samples within each frame are still in channel order),
+	// and read_frames_from_file() reads the blocks before the buffered frames.
+	// The play head is between two frames, and the next frame popped is the
+	// one on the playback side, so after changing direction the last frame
+	// popped is popped again. For ping-pong playback, change direction when
+	// is_eof() and frames_available() is 0.
+	// In reverse:
+	//  - is_eof() is true when the file has been read back to the first frame
+	//  - reset_playback_to_frame(n) and seek_frame_in_file(n) set up the buffer
+	//    so that frame n is popped next, followed by n - 1, etc.
+	//  - anchors are not used
+	// Call set_direction() from the audio thread.
+	enum class Direction { Forward, Reverse };
+	void set_direction(Direction dir);
+	Direction direction() const;
+
+	// Number of frames kept buffered behind the play head. While frames are
+	// read from the file, these are not overwritten, so after changing
+	// direction this many frames can be played without waiting for the disk.
+	// Default is 0, which leaves the whole buffer for reading ahead.
+	void set_history_frames(unsigned frames);
+
+	////
+	/// Cue anchors
+	///
+
+	// An anchor keeps the first frames after a cue point (for example, a slice
+	// start) in RAM, separately from the pre-buffer. When the audio thread calls
+	// reset_playback_to_frame() with a frame inside an anchor, playback starts
+	// immediately from the anchor, and the pre-buffer is refilled from the end
+	// of the anchor. So jumping between registered cues never waits for the disk.
+	//
+	// add_anchor() registers num_frames frames starting at frame_num. The frames
+	// are read from the file by read_frames_from_file(), one anchor per call,
+	// after it's read into the pre-buffer. Anchors are always stored as floats.
+	// Returns false if all MaxAnchors anchors are in use, or no file is loaded.
+	// Anchors are removed when a file is loaded or unloaded.
+	// Anchors are only used when playing forwards.
+	// Call these from the async thread (not the audio thread).
+	static constexpr unsigned MaxAnchors = 32;
+	bool add_anchor(uint32_t frame_num, unsigned num_frames);
+	void clear_anchors();
+
+	// Number of anchors registered, and the number which have been read from the file.
+	// Only anchors which have been read are used by reset_playback_to_frame()
+	unsigned num_anchors() const;
+	unsigned num_anchors_loaded() const;
+
+	// Whether playback is currently reading from an anchor instead of the pre-buffer
+	bool is_playing_anchor() const;
+
 	////
 	/// Wav file information
 	///
@@ -0,0 +1,370 @@
+#pragma once
+#include "threads/spsc_ring_buffer.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace MetaModule
+{
+
+// WavFileWriter records audio to a wav file.
+// The audio thread pushes frames into a lock-free buffer, and an AsyncThread
+// writes them to the file in large chunks. The sizes in the header are
+// filled in when the file is closed.
+//
+// Usage:
+//     WavFileWriter<> writer;
+//
+//     // Async thread:
+//     if (start_recording)
+//         writer.open("sdc:/recording.wav", 2, 48000);
+//     writer.flush();
+//     if (stop_recording)
+//         writer.close();
+//
+//     // Audio thread:
+//     std::array<float, 2> frame{left, right};
+//     writer.push_frames(frame);
+//
+// BufferSamples is the size of the buffer between the audio thread and the
+// AsyncThread, in samples (not frames). It must be a power of 2. The default
+// of 64k samples is about 0.7 seconds of stereo audio at 48kHz, so the
+// AsyncThread has that long to catch up after a slow write. Frames that don't
+// fit in the buffer are dropped, and counted in dropped_frames().
+//
+// The file is written in chunks of ChunkBytes, each starting on a
+// ChunkBytes boundary in the file (the header is padded to 512 bytes, and the
+// first chunk is shorter to make up for it). Large, aligned writes are much
+// faster than many small writes on a FAT filesystem, and let the filesystem
+// allocate whole clusters at once.
+template<size_t BufferSamples = 64 * 1024, size_t ChunkBytes = 32 * 1024>
+class WavFileWriter {
+	static_assert(ChunkBytes > 512 && ChunkBytes % 512 == 0, "ChunkBytes must be a multiple of 512");
+
+public:
+	enum class SampleFormat { Int16, Int24, Float32 };
+
+	static constexpr unsigned MaxChannels = 64;
+
+	WavFileWriter() = default;
+
+	~WavFileWriter() {
+		close();
+	}
+
+	WavFileWriter(WavFileWriter const &) = delete;
+	WavFileWriter &operator=(WavFileWriter const &) = delete;
+
+	////
+	/// Async thread:
+	///
+
+	// Creates the file and starts recording.
+	// Any previous recording is closed first, so the buffer and the number of
+	// channels are only changed once the audio thread has stopped pushing.
+	bool open(std::string_view path,
+			  unsigned num_channels,
+			  unsigned sample_rate,
+			  SampleFormat format = SampleFormat::Int24) {
+		close();
+
+		if (num_channels == 0 || num_channels > MaxChannels)
+			return false;
+
+		fp = std::fopen(std::string{path}.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		channels = num_channels;
+		rate = sample_rate;
+		sample_format = format;
+		data_bytes = 0;
+		chunk_fill = 0;
+		write_error = false;
+		buffer.reset();
+		num_dropped = 0;
+		num_overruns = 0;
+
+		write_header();
+		if (write_error) {
+			std::fclose(fp);
+			fp = nullptr;
+			return false;
+		}
+
+		recording.store(true, std::memory_order_release);
+		return true;
+	}
+
+	// Converts the frames in the buffer, and writes them to the file in
+	// whole chunks. Call this periodically from an AsyncThread.
+	// Returns the number of bytes written to the file.
+	size_t flush() {
+		return write_buffered(false);
+	}
+
+	// Stops recording, writes everything that's left in the buffer, and
+	// fills in the header.
+	void close() {
+		if (!fp)
+			return;
+
+		recording.store(false, std::memory_order_seq_cst);
+		wait_for_push();
+		write_buffered(true);
+
+		// Chunks in a RIFF file have an even size
+		if (data_bytes & 1)
+			std::fputc(0, fp);
+
+		write_header();
+		std::fclose(fp);
+		fp = nullptr;
+	}
+
+	bool is_open() const {
+		return fp != nullptr;
+	}
+
+	// True if a write to the file failed (e.g. the disk is full or was
+	// ejected). Recording stops if this happens.
+	bool is_write_error() const {
+		return write_error;
+	}
+
+	// True if the file has reached the 4GB limit of the wav format.
+	// Recording stops if this happens.
+	bool is_full() const {
+		return data_bytes + chunk_fill + bytes_per_frame() > MaxDataBytes;
+	}
+
+	// Number of frames written to the file (or waiting to be written in a whole chunk)
+	uint32_t frames_written() const {
+		return (data_bytes + chunk_fill) / bytes_per_frame();
+	}
+
+	////
+	/// Audio thread:
+	///
+
+	// Adds interleaved frames to the buffer. Returns the number of frames
+	// added, which is less than requested if the buffer is full.
+	// Does nothing if not recording.
+	unsigned push_frames(std::span<const float> interleaved) {
+		pushing.store(true, std::memory_order_seq_cst);
+		if (!recording.load(std::memory_order_seq_cst)) {
+			pushing.store(false, std::memory_order_release);
+			return 0;
+		}
+
+		unsigned num_frames = interleaved.size() / channels;
+		unsigned fit = std::min<size_t>(num_frames, buffer.num_free() / channels);
+
+		if (fit < num_frames) {
+			num_dropped.fetch_add(num_frames - fit, std::memory_order_relaxed);
+			num_overruns.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		buffer.write(interleaved.first(fit * channels));
+		pushing.store(false, std::memory_order_release);
+		return fit;
+	}
+
+	// Whether open() has been called and close() has not (and there's been
+	// no error).
+	bool is_recording() const {
+		return recording.load(std::memory_order_acquire);
+	}
+
+	////
+	/// Either thread:
+	///
+
+	// Number of frames that were pushed when the buffer was full
+	uint32_t dropped_frames() const {
+		return num_dropped.load(std::memory_order_relaxed);
+	}
+
+	// Number of calls to push_frames() that dropped frames
+	uint32_t overrun_count() const {
+		return num_overruns.load(std::memory_order_relaxed);
+	}
+
+	unsigned num_channels() const {
+		return channels;
+	}
+
+	unsigned sample_rate() const {
+		return rate;
+	}
+
+	SampleFormat format() const {
+		return sample_format;
+	}
+
+	static constexpr size_t HeaderBytes() {
+		return 512;
+	}
+
+private:
+	SpscRingBuffer<float, BufferSamples> buffer;
+	// A 24-bit sample can go past the end of a chunk, so there's room for 2 more bytes
+	std::array<uint8_t, ChunkBytes + 2> chunk;
+	size_t chunk_fill = 0;
+
+	std::FILE *fp = nullptr;
+	unsigned channels = 1;
+	unsigned rate = 48000;
+	SampleFormat sample_format = SampleFormat::Int24;
+	uint32_t data_bytes = 0; // bytes written to the file after the header
+	bool write_error = false;
+
+	// Stopping: close() clears `recording`, then waits for `pushing` to be clear.
+	// push_frames() sets `pushing` before it checks `recording`, so once close()
+	// sees it clear, the audio thread won't touch the buffer or `channels`
+	// again until the next open() sets `recording`.
+	std::atomic<bool> recording = false;
+	std::atomic<bool> pushing = false;
+	std::atomic<uint32_t> num_dropped = 0;
+	std::atomic<uint32_t> num_overruns = 0;
+
+	static constexpr uint32_t MaxDataBytes = 0xFFFF'FFFFu - HeaderBytes();
+
+	// push_frames() is short and runs at a higher priority, so this is a short wait
+	void wait_for_push() const {
+		while (pushing.load(std::memory_order_seq_cst))
+			;
+	}
+
+	unsigned bytes_per_sample() const {
+		return sample_format == SampleFormat::Int16 ? 2 : sample_format == SampleFormat::Int24 ? 3 : 4;
+	}
+
+	unsigned bytes_per_frame() const {
+		return bytes_per_sample() * channels;
+	}
+
+	size_t write_buffered(bool write_partial_chunk) {
+		if (!fp || write_error)
+			return 0;
+
+		size_t bytes_written = 0;
+		std::array<float, MaxChannels * 4> samples;
+
+		while (true) {
+			// Only take whole frames, and stop at the size limit
+			auto frames_left = (MaxDataBytes - data_bytes - chunk_fill) / bytes_per_frame();
+			auto max_samples = std::min<size_t>(samples.size() / channels, frames_left) * channels;
+			auto num = buffer.read(std::span{samples}.first(std::min(max_samples, buffer.num_filled() / channels * channels)));
+			if (num == 0)
+				break;
+
+			for (auto s : std::span{samples}.first(num)) {
+				append_sample(s);
+				if (chunk_fill >= chunk_limit())
+					bytes_written += write_chunk();
+			}
+		}
+
+		if (write_partial_chunk && chunk_fill > 0)
+			bytes_written += write_chunk();
+
+		if (write_error || is_full())
+			recording.store(false, std::memory_order_release);
+
+		return bytes_written;
+	}
+
+	void append_sample(float s) {
+		auto *out = &chunk[chunk_fill];
+
+		if (sample_format == SampleFormat::Float32) {
+			uint32_t bits;
+			std::memcpy(&bits, &s, 4);
+			put_le(out, bits, 4);
+		} else if (sample_format == SampleFormat::Int16) {
+			// Same scaling as dr_wav and WavFileStream use, so recordings read back exactly
+			auto v = std::clamp<long>(std::lround(s * 32768.f), -32768, 32767);
+			put_le(out, uint32_t(v), 2);
+		} else {
+			auto v = std::clamp<long>(std::lround(s * 8388608.f), -8388608, 8388607);
+			put_le(out, uint32_t(v), 3);
+		}
+
+		chunk_fill += bytes_per_sample();
+	}
+
+	// The first chunk ends on a ChunkBytes boundary in the file
+	size_t chunk_limit() const {
+		return data_bytes == 0 ? ChunkBytes - HeaderBytes() : ChunkBytes;
+	}
+
+	// Writes up to one chunk, and moves any extra bytes to the start of the next chunk
+	size_t write_chunk() {
+		auto len = std::min(chunk_fill, chunk_limit());
+		auto num = std::fwrite(chunk.data(), 1, len, fp);
+		if (num != len)
+			write_error = true;
+		data_bytes += num;
+
+		chunk_fill -= len;
+		std::memmove(chunk.data(), chunk.data() + len, chunk_fill);
+		return num;
+	}
+
+	static void put_le(uint8_t *out, uint32_t val, unsigned num_bytes) {
+		for (unsigned i = 0; i < num_bytes; i++)
+			out[i] = uint8_t(val >> (8 * i));
+	}
+
+	void write_header() {
+		std::array<uint8_t, HeaderBytes()> header{};
+		auto *p = header.data();
+
+		auto put_tag = [&p](const char *tag) {
+			std::memcpy(p, tag, 4);
+			p += 4;
+		};
+		auto put = [&p](uint32_t val, unsigned num_bytes) {
+			put_le(p, val, num_bytes);
+			p += num_bytes;
+		};
+
+		const uint32_t pad = data_bytes & 1;
+		const uint32_t fmt_tag = sample_format == SampleFormat::Float32 ? 3 : 1;
+		const uint32_t junk_bytes = HeaderBytes() - 12 - (8 + 16) - 8 - 8;
+
+		put_tag("RIFF");
+		put(HeaderBytes() - 8 + data_bytes + pad, 4);
+		put_tag("WAVE");
+
+		put_tag("fmt ");
+		put(16, 4);
+		put(fmt_tag, 2);
+		put(channels, 2);
+		put(rate, 4);
+		put(rate * bytes_per_frame(), 4);
+		put(bytes_per_frame(), 2);
+		put(bytes_per_sample() * 8, 2);
+
+		// Padding, so that the audio data starts at a sector boundary
+		put_tag("JUNK");
+		put(junk_bytes, 4);
+		p += junk_bytes;
+
+		put_tag("data");
+		put(data_bytes, 4);
+
+		if (std::fseek(fp, 0, SEEK_SET) != 0 || std::fwrite(header.data(), 1, header.size(), fp) != header.size())
+			write_error = true;
+	}
+};
+
+} // namespace MetaModule
@@ -0,0 +1,61 @@
+# Builds plugin modules for the host computer (e.g. x86/Linux) instead of MetaModule hardware.
+# Use this in place of plugin.cmake, and call create_host_runner() in place of create_plugin().
+# See docs/host-build.md
+cmake_minimum_required(VERSION 3.22)
+project(MetaModulePluginSDKHost LANGUAGES C CXX)
+
+include(${CMAKE_CURRENT_LIST_DIR}/cmake/version.cmake)
+
+set(CMAKE_EXPORT_COMPILE_COMMANDS ON)
+if (NOT CMAKE_BUILD_TYPE)
+    set(CMAKE_BUILD_TYPE "RelWithDebInfo")
+endif()
+include(${CMAKE_CURRENT_LIST_DIR}/cmake/ccache.cmake)
+
+set(CMAKE_CXX_STANDARD 20)
+set(CMAKE_POSITION_INDEPENDENT_CODE ON)
+
+add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/rack-interface ${CMAKE_CURRENT_BINARY_DIR}/plugin-sdk/rack-interface)
+add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/core-interface ${CMAKE_CURRENT_BINARY_DIR}/plugin-sdk/core-interface)
+add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/cpputil ${CMAKE_CURRENT_BINARY_DIR}/plugin-sdk/cpputil)
+add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/host ${CMAKE_CURRENT_BINARY_DIR}/plugin-sdk/host)
+
+# Function to create the mm-run executable from a plugin's static library
+function(create_host_runner)
+
+    set(oneValueArgs SOURCE_LIB RUNNER_NAME)
+    cmake_parse_arguments(RUNNER_OPTIONS "" "${oneValueArgs}" "" ${ARGN} )
+
+    set(LIB_NAME ${RUNNER_OPTIONS_SOURCE_LIB})
+
+    if (DEFINED RUNNER_OPTIONS_RUNNER_NAME)
+        set(RUNNER_NAME ${RUNNER_OPTIONS_RUNNER_NAME})
+    else()
+        set(RUNNER_NAME mm-run)
+    endif()
+
+    target_link_libraries(${LIB_NAME} PRIVATE metamodule::host metamodule::rack-interface)
+    target_compile_definitions(${LIB_NAME} PRIVATE METAMODULE METAMODULE_HOST)
+
+    # Get objects of linked libraries, like create_plugin() does, so that
+    # modules registered by static initializers are not dropped by the linker
+    get_target_property(DEP_LIBS ${LIB_NAME} LINK_LIBRARIES)
+    list(REMOVE_ITEM DEP_LIBS "metamodule::host" "metamodule::rack-interface")
+    foreach(LIB IN LISTS DEP_LIBS)
+        if (TARGET ${LIB})
+            get_target_property(LIB_TYPE ${LIB} TYPE)
+            if (NOT LIB_TYPE STREQUAL "INTERFACE_LIBRARY")
+                list(APPEND TARGET_LINK_LIB_OBJS $<TARGET_OBJECTS:${LIB}>)
+            endif()
+        endif()
+    endforeach()
+
+    add_executable(${RUNNER_NAME}
+        ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/host/mm-run/mm_run.cc
+        ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/version.cc
+        $<TARGET_OBJECTS:${LIB_NAME}>
+        ${TARGET_LINK_LIB_OBJS}
+    )
+    target_link_libraries(${RUNNER_NAME} PRIVATE metamodule::host)
+
+endfunction()
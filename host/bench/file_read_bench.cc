@@ -0,0 +1,87 @@
+#include "filesystem/buffered_file_reader.hh"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+// Reading a file in small pieces, the way a stream player reads a wav file.
+//
+// By default the test file is in the temp directory. To measure a FAT volume,
+// set MM_BENCH_DIR to a directory on one, for example a loop-mounted image:
+//   dd if=/dev/zero of=fat.img bs=1M count=256 && mkfs.vfat -s 64 fat.img
+//   sudo mount -o loop,uid=$(id -u) fat.img /mnt/fat
+//   MM_BENCH_DIR=/mnt/fat ./runbench --benchmark_filter=FileRead
+
+namespace
+{
+
+constexpr size_t FileBytes = 16 * 1024 * 1024;
+
+std::string test_file() {
+	auto dir = std::getenv("MM_BENCH_DIR");
+	auto path = std::filesystem::path{dir ? dir : std::filesystem::temp_directory_path()} / "mm-bench-read.bin";
+
+	if (!std::filesystem::exists(path) || std::filesystem::file_size(path) != FileBytes) {
+		if (auto fp = std::fopen(path.c_str(), "wb")) {
+			std::vector<char> data(FileBytes, 'x');
+			std::fwrite(data.data(), 1, data.size(), fp);
+			std::fclose(fp);
+		}
+	}
+
+	return path.string();
+}
+
+} // namespace
+
+// Unbuffered reads of `size` bytes, each going to the filesystem.
+// The read size is not a multiple of the cluster size, so reads are unaligned.
+static void FileRead_unaligned(benchmark::State &state) {
+	const size_t size = state.range(0);
+	std::vector<std::byte> dst(size);
+
+	auto fp = std::fopen(test_file().c_str(), "rb");
+	if (!fp) {
+		state.SkipWithError("Could not create test file");
+		return;
+	}
+	std::setvbuf(fp, nullptr, _IONBF, 0);
+
+	for (auto _ : state) {
+		if (std::fread(dst.data(), 1, size, fp) < size)
+			std::fseek(fp, 0, SEEK_SET);
+		benchmark::DoNotOptimize(dst.data());
+	}
+	std::fclose(fp);
+
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(FileRead_unaligned)->ArgName("bytes")->Arg(1000)->Arg(4000)->Arg(12000);
+
+// The same reads through BufferedFileReader, which only reads whole,
+// cluster-aligned runs of clusters from the filesystem
+static void FileRead_cluster_aligned(benchmark::State &state) {
+	const size_t size = state.range(0);
+	const unsigned clusters = state.range(1);
+	std::vector<std::byte> dst(size);
+
+	BufferedFileReader reader{clusters};
+	if (!reader.open(test_file())) {
+		state.SkipWithError("Could not create test file");
+		return;
+	}
+
+	for (auto _ : state) {
+		if (reader.read(std::span{dst}) < size)
+			reader.seek(0);
+		benchmark::DoNotOptimize(dst.data());
+	}
+
+	state.counters["cluster"] = reader.cluster_bytes();
+	state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(FileRead_cluster_aligned)->ArgNames({"bytes", "clusters"})->ArgsProduct({{1000, 4000, 12000}, {1, 4}});
@@ -0,0 +1,207 @@
+#include "dsp/block_resampler.hh"
+#include "dsp/interpolating_stream_resampler.hh"
+#include "dsp/stream_resampler.hh"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+// Benchmark args are integers, so resampling ratios are given in percent
+const std::vector<int64_t> RatiosPercent{25, 50, 92, 100, 200, 400};
+
+const std::vector<int64_t> BlockSizes{16, 64, 256, 512};
+
+constexpr uint32_t OutputRate = 48000;
+
+uint32_t input_rate(int64_t ratio_percent) {
+	return OutputRate * ratio_percent / 100;
+}
+
+// Interleaved multi-channel test signal, a power of 2 in length so it can be looped with a mask
+std::vector<float> make_input(unsigned num_chans, size_t num_frames = 4096) {
+	std::vector<float> input(num_frames * num_chans);
+	for (size_t i = 0; i < input.size(); i++)
+		input[i] = std::sin(float(i / num_chans) * 0.01f * float(1 + i % num_chans));
+	return input;
+}
+
+} // namespace
+
+// Loops over an input signal. Lambdas capture a single reference to this, so
+// they fit in a Function.
+struct InputLoop {
+	std::vector<float> samples;
+	size_t mask;
+	size_t pos = 0;
+
+	InputLoop(unsigned num_chans)
+		: samples{make_input(num_chans)}
+		, mask{samples.size() - 1} {
+	}
+
+	float pop_sample() {
+		auto val = samples[pos];
+		pos = (pos + 1) & mask;
+		return val;
+	}
+};
+
+// Type-erased callback: one indirect call per input sample
+static void StreamResampler_process(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned FramesPerIteration = 256;
+
+	StreamResampler res{chans};
+	res.set_sample_rate_in_out(input_rate(state.range(1)), OutputRate);
+
+	InputLoop input{chans};
+	std::array<float, 16> out{};
+
+	for (auto _ : state) {
+		for (unsigned i = 0; i < FramesPerIteration; i++) {
+			res.process(Function<float()>{[&input] { return input.pop_sample(); }}, {out.data(), chans});
+			benchmark::DoNotOptimize(out);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * FramesPerIteration);
+}
+BENCHMARK(StreamResampler_process)->ArgNames({"chans", "ratio%"})->ArgsProduct({{1, 2, 4, 8}, RatiosPercent});
+
+// Lambda callback, inlined by the template overload
+static void StreamResampler_process_inline(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned FramesPerIteration = 256;
+
+	StreamResampler res{chans};
+	res.set_sample_rate_in_out(input_rate(state.range(1)), OutputRate);
+
+	InputLoop input{chans};
+	std::array<float, 16> out{};
+
+	for (auto _ : state) {
+		for (unsigned i = 0; i < FramesPerIteration; i++) {
+			res.process([&input] { return input.pop_sample(); }, {out.data(), chans});
+			benchmark::DoNotOptimize(out);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * FramesPerIteration);
+}
+BENCHMARK(StreamResampler_process_inline)->ArgNames({"chans", "ratio%"})->ArgsProduct({{1, 2, 4, 8}, RatiosPercent});
+
+// Reads directly from a buffer
+static void StreamResampler_process_span(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned FramesPerIteration = 256;
+
+	StreamResampler res{chans};
+	res.set_sample_rate_in_out(input_rate(state.range(1)), OutputRate);
+
+	const auto input = make_input(chans);
+	std::span<const float> remaining;
+	std::array<float, 16> out{};
+
+	for (auto _ : state) {
+		for (unsigned i = 0; i < FramesPerIteration; i++) {
+			if (remaining.size() < chans * 4)
+				remaining = input;
+			remaining = remaining.subspan(res.process(remaining, {out.data(), chans}));
+			benchmark::DoNotOptimize(out);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * FramesPerIteration);
+}
+BENCHMARK(StreamResampler_process_span)->ArgNames({"chans", "ratio%"})->ArgsProduct({{1, 2, 4, 8}, RatiosPercent});
+
+// Each interpolation mode, with the lambda inlined
+template<typename Interp>
+static void InterpolatingStreamResampler_process(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned FramesPerIteration = 256;
+
+	InterpolatingStreamResampler<Interp> res{chans};
+	res.set_sample_rate_in_out(input_rate(state.range(1)), OutputRate);
+
+	InputLoop input{chans};
+	std::array<float, 16> out{};
+
+	for (auto _ : state) {
+		for (unsigned i = 0; i < FramesPerIteration; i++) {
+			res.process([&input] { return input.pop_sample(); }, {out.data(), chans});
+			benchmark::DoNotOptimize(out);
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * FramesPerIteration);
+}
+BENCHMARK(InterpolatingStreamResampler_process<Interpolation::Linear>)
+	->ArgNames({"chans", "ratio%"})
+	->ArgsProduct({{1, 2, 8}, RatiosPercent});
+BENCHMARK(InterpolatingStreamResampler_process<Interpolation::Hermite>)
+	->ArgNames({"chans", "ratio%"})
+	->ArgsProduct({{1, 2, 8}, RatiosPercent});
+BENCHMARK(InterpolatingStreamResampler_process<Interpolation::Sinc6>)
+	->ArgNames({"chans", "ratio%"})
+	->ArgsProduct({{1, 2, 8}, RatiosPercent});
+BENCHMARK(InterpolatingStreamResampler_process<Interpolation::Sinc8>)
+	->ArgNames({"chans", "ratio%"})
+	->ArgsProduct({{1, 2, 8}, RatiosPercent});
+
+static void BlockResampler_process(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	const unsigned block_size = state.range(2);
+
+	BlockResampler res{chans};
+	res.set_samplerate_in_out(input_rate(state.range(1)), OutputRate);
+
+	const auto input = make_input(chans, block_size);
+
+	// Largest ratio is 4x fewer input frames than output frames
+	std::vector<float> out(block_size * chans * 4 + chans);
+
+	for (auto _ : state) {
+		for (unsigned chan = 0; chan < chans; chan++) {
+			auto outpos = res.process(chan, input, out);
+			benchmark::DoNotOptimize(outpos);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	// Throughput is measured in input frames
+	state.SetItemsProcessed(state.iterations() * block_size);
+}
+BENCHMARK(BlockResampler_process)
+	->ArgNames({"chans", "ratio%", "block"})
+	->ArgsProduct({{1, 2, 4, 8, 16}, RatiosPercent, BlockSizes});
+
+static void BlockResampler_process_interleaved(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	const unsigned block_size = state.range(2);
+
+	BlockResampler res{chans};
+	res.set_samplerate_in_out(input_rate(state.range(1)), OutputRate);
+
+	const auto input = make_input(chans, block_size);
+
+	// Largest ratio is 4x fewer input frames than output frames
+	std::vector<float> out(block_size * chans * 4 + chans);
+
+	for (auto _ : state) {
+		auto num_written = res.process_interleaved(input, out);
+		benchmark::DoNotOptimize(num_written);
+		benchmark::ClobberMemory();
+	}
+
+	// Throughput is measured in input frames
+	state.SetItemsProcessed(state.iterations() * block_size);
+}
+BENCHMARK(BlockResampler_process_interleaved)
+	->ArgNames({"chans", "ratio%", "block"})
+	->ArgsProduct({{1, 2, 4, 8, 16}, RatiosPercent, BlockSizes});
@@ -0,0 +1,114 @@
+#include "wav/sample_decoder.hh"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+// Decode throughput of each format SampleDecoder supports, decoding a block
+// at a time the way SampleStream does on the async thread.
+// The items/s counter is frames decoded per second: divide by the sample
+// rate to get how many streams one core could keep up with.
+//
+// FLAC is included if dr_flac.h is on the include path. There is no FLAC
+// encoder here, so set MM_BENCH_FLAC to a (stereo) .flac file to measure it.
+
+namespace
+{
+
+constexpr unsigned SampleRate = 48000;
+constexpr unsigned Channels = 2;
+constexpr unsigned FileSeconds = 10;
+
+std::vector<int16_t> test_signal() {
+	std::vector<int16_t> frames(SampleRate * FileSeconds * Channels);
+	for (size_t i = 0; i < frames.size(); i++) {
+		float t = float(i / Channels);
+		frames[i] = int16_t(12000.f * std::sin(t * 0.01f) + 6000.f * std::sin(t * (0.2f + 0.1f * (i % Channels))));
+	}
+	return frames;
+}
+
+std::string test_file(std::string_view format) {
+	auto path = std::filesystem::temp_directory_path() / ("mm-bench-decode." + std::string{format});
+	if (std::filesystem::exists(path))
+		return path.string();
+
+	auto signal = test_signal();
+
+	if (format == "wav") {
+		drwav_data_format wav_format{
+			.container = drwav_container_riff,
+			.format = DR_WAVE_FORMAT_PCM,
+			.channels = Channels,
+			.sampleRate = SampleRate,
+			.bitsPerSample = 16,
+		};
+		drwav wav;
+		if (!drwav_init_file_write(&wav, path.c_str(), &wav_format, nullptr))
+			return "";
+		drwav_write_pcm_frames(&wav, signal.size() / Channels, signal.data());
+		drwav_uninit(&wav);
+
+	} else if (format == "qoa") {
+		auto file = Qoa::encode(signal, Channels, SampleRate);
+		auto fp = std::fopen(path.c_str(), "wb");
+		if (!fp)
+			return "";
+		std::fwrite(file.data(), 1, file.size(), fp);
+		std::fclose(fp);
+	}
+
+	return path.string();
+}
+
+void decode(benchmark::State &state, std::string const &path) {
+	auto decoder = open_sample_decoder(path);
+	if (!decoder) {
+		state.SkipWithError("Could not open test file");
+		return;
+	}
+
+	const unsigned block_frames = state.range(0);
+	std::vector<float> block(block_frames * decoder->num_channels());
+	size_t frames = 0;
+
+	for (auto _ : state) {
+		auto n = decoder->read_frames(block);
+		if (n == 0)
+			decoder->seek_to_frame(0);
+		frames += n;
+		benchmark::DoNotOptimize(block.data());
+	}
+
+	state.SetItemsProcessed(frames);
+	state.counters["file_bytes"] = double(std::filesystem::file_size(path));
+}
+
+} // namespace
+
+static void SampleDecoder_wav16(benchmark::State &state) {
+	decode(state, test_file("wav"));
+}
+BENCHMARK(SampleDecoder_wav16)->Arg(256)->Arg(1024)->Arg(4096);
+
+static void SampleDecoder_qoa(benchmark::State &state) {
+	decode(state, test_file("qoa"));
+}
+BENCHMARK(SampleDecoder_qoa)->Arg(256)->Arg(1024)->Arg(4096);
+
+#ifdef METAMODULE_SAMPLE_DECODER_FLAC
+static void SampleDecoder_flac(benchmark::State &state) {
+	auto path = std::getenv("MM_BENCH_FLAC");
+	if (!path) {
+		state.SkipWithError("Set MM_BENCH_FLAC to a .flac file");
+		return;
+	}
+	decode(state, path);
+}
+BENCHMARK(SampleDecoder_flac)->Arg(256)->Arg(1024)->Arg(4096);
+#endif
@@ -0,0 +1,209 @@
+#include "wav/dr_wav.h"
+#include "wav/wav_file_stream.hh"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+constexpr unsigned SampleRate = 48000;
+constexpr unsigned FileSeconds = 4;
+
+// Writes a 16-bit wav file (once per channel count) and returns its path
+std::string test_wav_file(unsigned chans) {
+	auto path = std::filesystem::temp_directory_path() / ("mm-bench-" + std::to_string(chans) + "ch.wav");
+
+	if (!std::filesystem::exists(path)) {
+		drwav_data_format format{
+			.container = drwav_container_riff,
+			.format = DR_WAVE_FORMAT_PCM,
+			.channels = chans,
+			.sampleRate = SampleRate,
+			.bitsPerSample = 16,
+		};
+
+		drwav wav;
+		if (!drwav_init_file_write(&wav, path.c_str(), &format, nullptr))
+			return "";
+
+		std::vector<int16_t> frames(SampleRate * FileSeconds * chans);
+		for (size_t i = 0; i < frames.size(); i++)
+			frames[i] = int16_t(20000.f * std::sin(float(i / chans) * 0.01f));
+
+		drwav_write_pcm_frames(&wav, SampleRate * FileSeconds, frames.data());
+		drwav_uninit(&wav);
+	}
+
+	return path.string();
+}
+
+void loop_if_eof(WavFileStream &stream) {
+	if (stream.is_eof() && stream.frames_available() == 0) {
+		stream.reset_playback_to_frame(0);
+		stream.seek_frame_in_file(0);
+	}
+}
+
+} // namespace
+
+// Streaming from disk (via the OS file cache): refill when low, pop one block
+static void WavFileStream_stream(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	const unsigned block_size = state.range(1);
+
+	WavFileStream stream{64 * 1024};
+	if (!stream.load(test_wav_file(chans))) {
+		state.SkipWithError("Could not create test wav file");
+		return;
+	}
+
+	for (auto _ : state) {
+		while (stream.frames_available() < block_size) {
+			loop_if_eof(stream);
+			stream.read_frames_from_file();
+		}
+
+		for (unsigned i = 0; i < block_size * chans; i++)
+			benchmark::DoNotOptimize(stream.pop_sample());
+	}
+
+	state.SetItemsProcessed(state.iterations() * block_size);
+}
+BENCHMARK(WavFileStream_stream)->ArgNames({"chans", "block"})->ArgsProduct({{1, 2, 8, 16}, {16, 64, 256, 512}});
+
+// Streaming backwards, turning around at each end of the file (ping-pong)
+static void WavFileStream_stream_pingpong(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	const unsigned block_size = state.range(1);
+
+	WavFileStream stream{64 * 1024};
+	if (!stream.load(test_wav_file(chans))) {
+		state.SkipWithError("Could not create test wav file");
+		return;
+	}
+	stream.set_history_frames(4096);
+	stream.set_direction(WavFileStream::Direction::Reverse);
+	stream.reset_playback_to_frame(stream.total_frames() - 1);
+	stream.seek_frame_in_file(stream.total_frames() - 1);
+
+	std::vector<float> out(block_size * chans);
+
+	for (auto _ : state) {
+		while (stream.frames_available() < block_size) {
+			if (stream.is_eof() && stream.frames_available() == 0) {
+				auto reverse = stream.direction() == WavFileStream::Direction::Reverse;
+				stream.set_direction(reverse ? WavFileStream::Direction::Forward : WavFileStream::Direction::Reverse);
+			}
+			stream.read_frames_from_file();
+		}
+
+		benchmark::DoNotOptimize(stream.pop_frames(out, block_size));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * block_size);
+}
+BENCHMARK(WavFileStream_stream_pingpong)->ArgNames({"chans", "block"})->ArgsProduct({{1, 2, 8}, {64, 512}});
+
+// Popping from a fully-buffered file: measures pop_sample() alone
+static void WavFileStream_pop_sample(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned BlockSize = 256;
+
+	WavFileStream stream{SampleRate * FileSeconds * chans};
+	if (!stream.load(test_wav_file(chans))) {
+		state.SkipWithError("Could not create test wav file");
+		return;
+	}
+
+	while (!stream.is_eof())
+		stream.read_frames_from_file();
+
+	for (auto _ : state) {
+		if (stream.frames_available() < BlockSize)
+			stream.reset_playback_to_frame(0);
+
+		for (unsigned i = 0; i < BlockSize * chans; i++)
+			benchmark::DoNotOptimize(stream.pop_sample());
+	}
+
+	state.SetItemsProcessed(state.iterations() * BlockSize);
+}
+BENCHMARK(WavFileStream_pop_sample)->ArgName("chans")->Arg(1)->Arg(2)->Arg(8)->Arg(16);
+
+// Popping from a fully-buffered file: measures pop_frames() alone
+static void WavFileStream_pop_frames(benchmark::State &state) {
+	const unsigned chans = state.range(0);
+	constexpr unsigned BlockSize = 256;
+
+	WavFileStream stream{SampleRate * FileSeconds * chans};
+	if (!stream.load(test_wav_file(chans))) {
+		state.SkipWithError("Could not create test wav file");
+		return;
+	}
+
+	while (!stream.is_eof())
+		stream.read_frames_from_file();
+
+	std::vector<float> out(BlockSize * chans);
+
+	for (auto _ : state) {
+		if (stream.frames_available() < BlockSize)
+			stream.reset_playback_to_frame(0);
+
+		benchmark::DoNotOptimize(stream.pop_frames(out, BlockSize));
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * BlockSize);
+}
+BENCHMARK(WavFileStream_pop_frames)->ArgName("chans")->Arg(1)->Arg(2)->Arg(8)->Arg(16);
+
+// A slice player jumping between 16 cue points: each iteration jumps to the
+// next slice, then plays a few blocks while the async thread refills.
+// With anchors, the jump plays from RAM. Without, the first blocks after each
+// jump are missed (missed_frames counts them).
+static void WavFileStream_slice_jumps(benchmark::State &state) {
+	const bool use_anchors = state.range(0);
+	constexpr unsigned Chans = 2;
+	constexpr unsigned NumSlices = 16;
+	constexpr unsigned BlockSize = 64;
+	constexpr unsigned SliceFrames = SampleRate * FileSeconds / NumSlices;
+
+	WavFileStream stream{16 * 1024};
+	if (!stream.load(test_wav_file(Chans))) {
+		state.SkipWithError("Could not create test wav file");
+		return;
+	}
+
+	if (use_anchors) {
+		for (unsigned i = 0; i < NumSlices; i++)
+			stream.add_anchor(i * SliceFrames, 2048);
+		while (stream.num_anchors_loaded() < NumSlices)
+			stream.read_frames_from_file();
+	}
+
+	std::vector<float> out(BlockSize * Chans);
+	unsigned slice = 0;
+	size_t missed = 0;
+
+	for (auto _ : state) {
+		slice = (slice + 7) % NumSlices;
+		stream.reset_playback_to_frame(slice * SliceFrames);
+		stream.seek_frame_in_file(slice * SliceFrames);
+
+		for (unsigned block = 0; block < 8; block++) {
+			missed += BlockSize - stream.pop_frames(out, BlockSize);
+			stream.read_frames_from_file();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations());
+	state.counters["missed_frames"] = benchmark::Counter(double(missed), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(WavFileStream_slice_jumps)->ArgName("anchors")->Arg(0)->Arg(1);
@@ -0,0 +1,40 @@
+#pragma once
+#include "CoreModules/register_module.hh"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Host-only API: used by tools (such as mm-run) that run plugin modules on a computer
+// instead of on MetaModule hardware. Plugins should not call these.
+
+namespace MetaModule::Host
+{
+
+struct RegisteredModule {
+	std::string brand;
+	std::string slug;
+	CreateModuleFunc create;
+	ModuleInfoView info;
+	std::string faceplate;
+};
+
+// Calls the plugin's init() function, which typically registers all its modules.
+// Returns false if the plugin does not define init()
+bool init_plugin();
+
+// All modules registered with register_module(), in the order they were registered
+std::span<const RegisteredModule> registered_modules();
+
+// Returns nullptr if the module is not registered
+const RegisteredModule *find_module(std::string_view brand, std::string_view slug);
+
+// Sets the value returned by Audio::get_block_size()
+void set_block_size(uint32_t block_size);
+
+// Runs every AsyncThread that is started, or has a pending run_once().
+// On hardware these run concurrently with the audio thread; the host runs them
+// wherever this is called (e.g. between audio blocks).
+void run_async_threads();
+
+} // namespace MetaModule::Host
@@ -0,0 +1,509 @@
+// mm-run: runs a chain of plugin modules on the host computer and reports the
+// processing time of each module.
+//
+// See docs/host-build.md for usage.
+
+#include "CoreModules/CoreProcessor.hh"
+#include "CoreModules/param_event_queue.hh"
+#include "host_api.hh"
+#include "threads/async_thread.hh"
+#include "wav/dr_wav.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+using namespace MetaModule;
+
+namespace
+{
+
+struct JackRef {
+	unsigned module;
+	unsigned jack;
+};
+
+struct Cable {
+	JackRef out;
+	JackRef in;
+};
+
+struct Source {
+	enum class Type { Sine, Saw, Noise, DC, Wav } type;
+	float value = 0; // frequency for Sine/Saw, volts for DC
+	std::vector<float> wav_data;
+	unsigned wav_channels = 1;
+
+	// Running state
+	double phase = 0;
+	size_t wav_pos = 0;
+	std::minstd_rand rng{1};
+
+	void fill(std::span<float> out, float sample_rate) {
+		switch (type) {
+			case Type::Sine:
+				for (auto &s : out) {
+					s = 5.f * std::sin(float(phase * 2 * M_PI));
+					phase = std::fmod(phase + value / sample_rate, 1.0);
+				}
+				break;
+
+			case Type::Saw:
+				for (auto &s : out) {
+					s = 10.f * float(phase) - 5.f;
+					phase = std::fmod(phase + value / sample_rate, 1.0);
+				}
+				break;
+
+			case Type::Noise: {
+				std::uniform_real_distribution<float> dist{-5.f, 5.f};
+				for (auto &s : out)
+					s = dist(rng);
+			} break;
+
+			case Type::DC:
+				std::fill(out.begin(), out.end(), value);
+				break;
+
+			case Type::Wav:
+				// First channel of the file, scaled to +/-5V, looped
+				for (auto &s : out) {
+					s = wav_data.empty() ? 0.f : wav_data[wav_pos] * 5.f;
+					wav_pos += wav_channels;
+					if (wav_pos >= wav_data.size())
+						wav_pos = 0;
+				}
+				break;
+		}
+	}
+};
+
+struct SourceAssignment {
+	JackRef in;
+	Source source;
+};
+
+struct ParamAssignment {
+	JackRef param;
+	float value;
+};
+
+// A param swept from 0 to 1 and back as a triangle wave, sent to the
+// module as param events
+struct Automation {
+	JackRef param;
+	float hz;
+	double phase = 0;
+};
+
+// Automated params change once every this many frames
+constexpr unsigned AutomationInterval = 32;
+
+struct ModuleSlot {
+	const Host::RegisteredModule *entry;
+	std::unique_ptr<CoreProcessor> core;
+	CoreProcessorBlock *block_core = nullptr;
+
+	std::vector<const float *> ins;
+	std::vector<float *> outs;
+	std::vector<std::vector<float>> out_buffers;
+
+	std::unique_ptr<ParamEventQueue<1024>> param_events = std::make_unique<ParamEventQueue<1024>>();
+
+	std::chrono::nanoseconds elapsed{0};
+};
+
+void usage() {
+	printf("Usage: mm-run [options] Brand:Module [Brand:Module ...]\n"
+		   "\n"
+		   "Modules are numbered from 0 in the order given, and are processed in that order.\n"
+		   "Jacks and params are numbered by index (see CoreHelper::input_idx etc).\n"
+		   "\n"
+		   "Options:\n"
+		   "  -l, --list                   List registered modules and exit\n"
+		   "  -b, --block-size N           Audio block size (default 64)\n"
+		   "  -r, --samplerate HZ          Sample rate (default 48000)\n"
+		   "  -s, --seconds S              Seconds of audio to process (default 10)\n"
+		   "  -c, --cable M:O,M:I          Connect output O of module M to input I of module M\n"
+		   "  -i, --input M:I=SOURCE       Feed input I of module M. SOURCE is one of:\n"
+		   "                                  sine:HZ, saw:HZ, noise, dc:VOLTS, or a .wav file\n"
+		   "  -p, --param M:P=VALUE        Set param P of module M (0..1)\n"
+		   "  -a, --automate M:P=HZ        Sweep param P of module M from 0 to 1 and back, HZ times a second\n"
+		   "  -j, --json                   Print results as JSON\n"
+		   "  -t, --thread-stats           Also print run counts and times of AsyncThreads\n");
+}
+
+std::optional<JackRef> parse_jack(std::string_view s) {
+	unsigned module, jack;
+	if (sscanf(std::string(s).c_str(), "%u:%u", &module, &jack) != 2)
+		return std::nullopt;
+	return JackRef{module, jack};
+}
+
+std::optional<Source> parse_source(std::string_view s) {
+	auto arg = [&](std::string_view prefix) -> std::optional<float> {
+		if (!s.starts_with(prefix))
+			return std::nullopt;
+		return std::strtof(std::string(s.substr(prefix.size())).c_str(), nullptr);
+	};
+
+	if (auto hz = arg("sine:"))
+		return Source{.type = Source::Type::Sine, .value = *hz};
+	if (auto hz = arg("saw:"))
+		return Source{.type = Source::Type::Saw, .value = *hz};
+	if (auto volts = arg("dc:"))
+		return Source{.type = Source::Type::DC, .value = *volts};
+	if (s == "noise")
+		return Source{.type = Source::Type::Noise};
+
+	unsigned channels = 0;
+	unsigned sample_rate = 0;
+	drwav_uint64 frames = 0;
+	auto data = drwav_open_file_and_read_pcm_frames_f32(std::string(s).c_str(), &channels, &sample_rate, &frames, nullptr);
+	if (!data) {
+		fprintf(stderr, "Cannot read wav file %.*s\n", (int)s.size(), s.data());
+		return std::nullopt;
+	}
+
+	Source src{.type = Source::Type::Wav};
+	src.wav_data.assign(data, data + frames * channels);
+	src.wav_channels = std::max(channels, 1u);
+	drwav_free(data, nullptr);
+	return src;
+}
+
+void set_default_params(ModuleSlot &slot) {
+	auto const &info = slot.entry->info;
+
+	for (unsigned i = 0; i < info.elements.size() && i < info.indices.size(); i++) {
+		auto param_idx = info.indices[i].param_idx;
+		if (param_idx == ElementCount::Indices::NoElementMarker)
+			continue;
+
+		std::visit(
+			[&](auto const &el) {
+				if constexpr (requires { float(el.default_value); })
+					slot.core->set_param(param_idx, float(el.default_value));
+			},
+			info.elements[i]);
+	}
+}
+
+void print_thread_stats(std::vector<ModuleSlot> const &slots, bool json) {
+	std::vector<AsyncThread::Stats> stats(AsyncThread::all_stats({}));
+	stats.resize(AsyncThread::all_stats(stats));
+
+	if (json)
+		printf(",\n  \"async_threads\": [\n");
+	else
+		printf("\n%-4s %-40s %8s %8s %8s %8s %9s\n", "#", "AsyncThread of module", "runs", "min us", "avg us", "max us", "overruns");
+
+	for (unsigned i = 0; auto const &stat : stats) {
+		auto slot = std::ranges::find_if(slots, [&](auto const &s) { return s.core.get() == stat.module; });
+		int index = slot == slots.end() ? -1 : int(slot - slots.begin());
+		auto name = slot == slots.end() ? std::string{"?"} : slot->entry->brand + ":" + slot->entry->slug;
+
+		if (json)
+			printf("    {\"module_index\": %d, \"module\": \"%s\", \"runs\": %u, \"min_us\": %u, \"avg_us\": %u, "
+				   "\"max_us\": %u, \"overruns\": %u}%s\n",
+				   index,
+				   name.c_str(),
+				   stat.run_count,
+				   stat.min_us,
+				   stat.avg_us,
+				   stat.max_us,
+				   stat.overrun_count,
+				   i + 1 < stats.size() ? "," : "");
+		else
+			printf("%-4d %-40s %8u %8u %8u %8u %9u\n",
+				   index,
+				   name.c_str(),
+				   stat.run_count,
+				   stat.min_us,
+				   stat.avg_us,
+				   stat.max_us,
+				   stat.overrun_count);
+		i++;
+	}
+
+	if (json)
+		printf("  ]");
+}
+
+void print_results(std::vector<ModuleSlot> const &slots, uint64_t frames, float sample_rate, bool json, bool thread_stats) {
+	const double budget_ns = 1e9 / sample_rate;
+
+	if (json)
+		printf("{\n  \"samplerate\": %g,\n  \"frames\": %llu,\n  \"modules\": [\n", sample_rate, (unsigned long long)frames);
+	else
+		printf("%-4s %-40s %12s %10s\n", "#", "Module", "ns/frame", "% of RT");
+
+	for (unsigned i = 0; auto const &slot : slots) {
+		double ns_per_frame = frames ? double(slot.elapsed.count()) / frames : 0;
+		double percent = 100. * ns_per_frame / budget_ns;
+		auto name = slot.entry->brand + ":" + slot.entry->slug;
+
+		if (json)
+			printf("    {\"index\": %u, \"module\": \"%s\", \"ns_per_frame\": %.3f, \"percent_realtime\": %.4f}%s\n",
+				   i,
+				   name.c_str(),
+				   ns_per_frame,
+				   percent,
+				   i + 1 < slots.size() ? "," : "");
+		else
+			printf("%-4u %-40s %12.2f %9.3f%%\n", i, name.c_str(), ns_per_frame, percent);
+		i++;
+	}
+
+	if (json)
+		printf("  ]");
+
+	if (thread_stats)
+		print_thread_stats(slots, json);
+
+	if (json)
+		printf("\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	unsigned block_size = 64;
+	float sample_rate = 48000;
+	float seconds = 10;
+	bool list_only = false;
+	bool json = false;
+	bool thread_stats = false;
+
+	std::vector<std::string_view> module_names;
+	std::vector<Cable> cables;
+	std::vector<SourceAssignment> sources;
+	std::vector<ParamAssignment> params;
+	std::vector<Automation> automations;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		auto next = [&]() -> std::string_view {
+			if (i + 1 >= argc) {
+				fprintf(stderr, "Missing value for %s\n", argv[i]);
+				exit(1);
+			}
+			return argv[++i];
+		};
+
+		if (arg == "-h" || arg == "--help") {
+			usage();
+			return 0;
+		} else if (arg == "-l" || arg == "--list") {
+			list_only = true;
+		} else if (arg == "-j" || arg == "--json") {
+			json = true;
+		} else if (arg == "-t" || arg == "--thread-stats") {
+			thread_stats = true;
+		} else if (arg == "-b" || arg == "--block-size") {
+			block_size = std::clamp(std::atoi(next().data()), 1, 4096);
+		} else if (arg == "-r" || arg == "--samplerate") {
+			sample_rate = std::strtof(next().data(), nullptr);
+		} else if (arg == "-s" || arg == "--seconds") {
+			seconds = std::strtof(next().data(), nullptr);
+		} else if (arg == "-c" || arg == "--cable") {
+			auto val = next();
+			auto comma = val.find(',');
+			auto out = parse_jack(val.substr(0, comma));
+			auto in = comma == val.npos ? std::nullopt : parse_jack(val.substr(comma + 1));
+			if (!out || !in) {
+				fprintf(stderr, "Bad cable: %s\n", val.data());
+				return 1;
+			}
+			cables.push_back({*out, *in});
+		} else if (arg == "-i" || arg == "--input") {
+			auto val = next();
+			auto eq = val.find('=');
+			auto in = parse_jack(val.substr(0, eq));
+			auto src = eq == val.npos ? std::nullopt : parse_source(val.substr(eq + 1));
+			if (!in || !src) {
+				fprintf(stderr, "Bad input: %s\n", val.data());
+				return 1;
+			}
+			sources.push_back({*in, std::move(*src)});
+		} else if (arg == "-p" || arg == "--param") {
+			auto val = next();
+			auto eq = val.find('=');
+			auto param = parse_jack(val.substr(0, eq));
+			if (!param || eq == val.npos) {
+				fprintf(stderr, "Bad param: %s\n", val.data());
+				return 1;
+			}
+			params.push_back({*param, std::strtof(val.substr(eq + 1).data(), nullptr)});
+		} else if (arg == "-a" || arg == "--automate") {
+			auto val = next();
+			auto eq = val.find('=');
+			auto param = parse_jack(val.substr(0, eq));
+			if (!param || eq == val.npos) {
+				fprintf(stderr, "Bad automation: %s\n", val.data());
+				return 1;
+			}
+			automations.push_back({*param, std::strtof(val.substr(eq + 1).data(), nullptr)});
+		} else if (arg.starts_with('-')) {
+			fprintf(stderr, "Unknown option %s\n", argv[i]);
+			usage();
+			return 1;
+		} else {
+			module_names.push_back(arg);
+		}
+	}
+
+	if (!Host::init_plugin())
+		fprintf(stderr, "Warning: plugin has no init() function\n");
+
+	if (list_only) {
+		for (auto const &m : Host::registered_modules())
+			printf("%s:%s\n", m.brand.c_str(), m.slug.c_str());
+		return 0;
+	}
+
+	if (module_names.empty()) {
+		usage();
+		return 1;
+	}
+
+	Host::set_block_size(block_size);
+
+	// Create modules
+	std::vector<ModuleSlot> slots;
+	for (auto name : module_names) {
+		auto colon = name.find(':');
+		auto entry = colon == name.npos ? nullptr : Host::find_module(name.substr(0, colon), name.substr(colon + 1));
+		if (!entry) {
+			fprintf(stderr, "Module %.*s is not registered (use --list)\n", (int)name.size(), name.data());
+			return 1;
+		}
+
+		auto &slot = slots.emplace_back(ModuleSlot{.entry = entry, .core = entry->create()});
+		slot.block_core = dynamic_cast<CoreProcessorBlock *>(slot.core.get());
+
+		auto counts = ElementCount::count(entry->info.elements);
+		slot.ins.resize(counts.num_inputs, nullptr);
+		slot.outs.resize(counts.num_outputs, nullptr);
+		slot.out_buffers.resize(counts.num_outputs);
+
+		slot.core->set_samplerate(sample_rate);
+		slot.core->load_state("");
+		set_default_params(slot);
+		slot.core->mark_all_inputs_unpatched();
+		slot.core->mark_all_outputs_unpatched();
+	}
+
+	auto valid_jack = [&](JackRef jack, auto vec) {
+		return jack.module < slots.size() && jack.jack < (slots[jack.module].*vec).size();
+	};
+
+	// Connect cables
+	for (auto cable : cables) {
+		if (!valid_jack(cable.out, &ModuleSlot::outs) || !valid_jack(cable.in, &ModuleSlot::ins)) {
+			fprintf(stderr, "Cable %u:%u,%u:%u refers to a jack that doesn't exist\n", cable.out.module, cable.out.jack, cable.in.module, cable.in.jack);
+			return 1;
+		}
+		auto &src = slots[cable.out.module];
+		auto &buf = src.out_buffers[cable.out.jack];
+		buf.resize(block_size);
+		src.outs[cable.out.jack] = buf.data();
+		src.core->mark_output_patched(cable.out.jack);
+
+		slots[cable.in.module].ins[cable.in.jack] = buf.data();
+		slots[cable.in.module].core->mark_input_patched(cable.in.jack);
+	}
+
+	// Connect sources
+	std::vector<std::vector<float>> source_buffers(sources.size(), std::vector<float>(block_size));
+	for (unsigned i = 0; auto &src : sources) {
+		if (!valid_jack(src.in, &ModuleSlot::ins)) {
+			fprintf(stderr, "Input %u:%u doesn't exist\n", src.in.module, src.in.jack);
+			return 1;
+		}
+		slots[src.in.module].ins[src.in.jack] = source_buffers[i++].data();
+		slots[src.in.module].core->mark_input_patched(src.in.jack);
+	}
+
+	for (auto p : params) {
+		if (p.param.module >= slots.size()) {
+			fprintf(stderr, "Param %u:%u refers to a module that doesn't exist\n", p.param.module, p.param.jack);
+			return 1;
+		}
+		slots[p.param.module].core->set_param(p.param.jack, p.value);
+	}
+
+	for (auto a : automations) {
+		if (a.param.module >= slots.size()) {
+			fprintf(stderr, "Automation %u:%u refers to a module that doesn't exist\n", a.param.module, a.param.jack);
+			return 1;
+		}
+	}
+
+	// Run
+	const uint64_t total_frames = uint64_t(seconds * sample_rate);
+	uint64_t frames_done = 0;
+
+	if (thread_stats)
+		AsyncThread::enable_stats(true);
+
+	while (frames_done < total_frames) {
+		unsigned frames = std::min<uint64_t>(block_size, total_frames - frames_done);
+
+		for (unsigned i = 0; auto &src : sources)
+			src.source.fill({source_buffers[i++].data(), frames}, sample_rate);
+
+		for (auto &a : automations) {
+			for (unsigned f = 0; f < frames; f += AutomationInterval) {
+				float value = 1.f - std::abs(2.f * float(a.phase) - 1.f);
+				slots[a.param.module].param_events->push({uint16_t(a.param.jack), uint16_t(f), value});
+				a.phase = std::fmod(a.phase + a.hz * AutomationInterval / sample_rate, 1.0);
+			}
+		}
+
+		for (auto &slot : slots) {
+			std::array<CoreProcessor::ParamEvent, 1024> event_buf;
+			auto events = slot.param_events->pop_block(event_buf, frames);
+
+			auto start = std::chrono::steady_clock::now();
+
+			if (slot.block_core) {
+				slot.block_core->set_param_events(events);
+				slot.block_core->process_block(slot.ins, slot.outs, frames);
+			} else {
+				for (unsigned f = 0; f < frames; f++) {
+					for (; !events.empty() && events.front().frame_offset == f; events = events.subspan(1))
+						slot.core->set_param(events.front().param_id, events.front().value);
+
+					for (unsigned j = 0; j < slot.ins.size(); j++) {
+						if (slot.ins[j])
+							slot.core->set_input(j, slot.ins[j][f]);
+					}
+					slot.core->update();
+					for (unsigned j = 0; j < slot.outs.size(); j++) {
+						if (slot.outs[j])
+							slot.outs[j][f] = slot.core->get_output(j);
+					}
+				}
+			}
+
+			slot.elapsed += std::chrono::steady_clock::now() - start;
+		}
+
+		Host::run_async_threads();
+		frames_done += frames;
+	}
+
+	print_results(slots, frames_done, sample_rate, json, thread_stats);
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include "threads/async_thread.hh"
+#include "host_api.hh"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace MetaModule
+{
+
+namespace
+{
+struct ThreadState {
+	CoreProcessor *module;
+	Callback *action;
+	bool has_action = false;
+	bool enabled = false;
+	bool pending_once = false;
+
+	uint32_t run_count = 0;
+	uint32_t overrun_count = 0;
+	uint32_t min_us = 0;
+	uint32_t max_us = 0;
+	uint64_t total_us = 0;
+	uint32_t last_run_tick = 0;
+
+	void reset_stats() {
+		run_count = 0;
+		overrun_count = 0;
+		min_us = 0;
+		max_us = 0;
+		total_us = 0;
+	}
+
+	void record_run(uint32_t us, uint32_t overrun_us) {
+		min_us = run_count == 0 ? us : std::min(min_us, us);
+		max_us = std::max(max_us, us);
+		total_us += us;
+		run_count++;
+		if (us > overrun_us)
+			overrun_count++;
+	}
+
+	AsyncThread::Stats stats() const {
+		return {
+			.module = module,
+			.run_count = run_count,
+			.overrun_count = overrun_count,
+			.min_us = min_us,
+			.max_us = max_us,
+			.avg_us = run_count ? uint32_t(total_us / run_count) : 0,
+			.last_run_tick = last_run_tick,
+		};
+	}
+};
+
+// Recursive, so that an action can query the stats
+std::recursive_mutex threads_mutex;
+std::vector<ThreadState *> threads;
+
+std::atomic<bool> collect_stats = false;
+std::atomic<uint32_t> overrun_threshold_us = 2000;
+
+void add_thread(ThreadState *thread) {
+	std::lock_guard lock{threads_mutex};
+	threads.push_back(thread);
+}
+
+void remove_thread(ThreadState *thread) {
+	std::lock_guard lock{threads_mutex};
+	std::erase(threads, thread);
+}
+} // namespace
+
+struct AsyncThread::Internal : ThreadState {};
+
+AsyncThread::AsyncThread(CoreProcessor *module)
+	: internal{std::make_unique<Internal>(Internal{{module, &action}})} {
+	add_thread(internal.get());
+}
+
+AsyncThread::AsyncThread(CoreProcessor *module, Callback &&action)
+	: action{std::move(action)}
+	, internal{std::make_unique<Internal>(Internal{{module, &this->action, true}})} {
+	add_thread(internal.get());
+}
+
+void AsyncThread::start() {
+	internal->enabled = true;
+}
+
+void AsyncThread::start(Callback &&new_action) {
+	action = std::move(new_action);
+	internal->has_action = true;
+	internal->enabled = true;
+}
+
+void AsyncThread::stop() {
+	internal->enabled = false;
+}
+
+void AsyncThread::run_once() {
+	internal->pending_once = true;
+}
+
+bool AsyncThread::is_enabled() {
+	return internal->enabled;
+}
+
+void AsyncThread::enable_stats(bool enable, uint32_t overrun_us) {
+	overrun_threshold_us = overrun_us;
+	collect_stats = enable;
+}
+
+bool AsyncThread::stats_enabled() {
+	return collect_stats;
+}
+
+AsyncThread::Stats AsyncThread::stats() const {
+	std::lock_guard lock{threads_mutex};
+	return internal->stats();
+}
+
+void AsyncThread::reset_stats() {
+	std::lock_guard lock{threads_mutex};
+	internal->reset_stats();
+}
+
+size_t AsyncThread::all_stats(std::span<Stats> out) {
+	std::lock_guard lock{threads_mutex};
+	for (size_t i = 0; i < std::min(out.size(), threads.size()); i++)
+		out[i] = threads[i]->stats();
+	return threads.size();
+}
+
+AsyncThread::~AsyncThread() {
+	remove_thread(internal.get());
+}
+
+void Host::run_async_threads() {
+	std::lock_guard lock{threads_mutex};
+
+	for (auto *thread : threads) {
+		if (thread->enabled || thread->pending_once) {
+			thread->pending_once = false;
+			if (!thread->has_action)
+				continue;
+
+			thread->last_run_tick = System::get_ticks();
+
+			if (collect_stats) {
+				auto start = std::chrono::steady_clock::now();
+				(*thread->action)();
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+				thread->record_run(uint32_t(us), overrun_threshold_us);
+			} else {
+				(*thread->action)();
+			}
+		}
+	}
+}
+
+} // namespace MetaModule
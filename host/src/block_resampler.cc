@@ -0,0 +1,93 @@
+#include "dsp/block_resampler.hh"
+#include <algorithm>
+
+namespace MetaModule
+{
+
+namespace
+{
+// 4-point, 3rd-order Hermite interpolation (x-form)
+inline float hermite(float xm1, float x0, float x1, float x2, float t) {
+	const float c = (x1 - xm1) * 0.5f;
+	const float v = x0 - x1;
+	const float w = c + v;
+	const float a = w + v + (x2 - x0) * 0.5f;
+	const float b_neg = w + a;
+	return (((a * t) - b_neg) * t + c) * t + x0;
+}
+} // namespace
+
+BlockResampler::BlockResampler(uint32_t num_channels)
+	: num_chans{std::clamp<size_t>(num_channels, 1, MAX_RESAMPLER_CHANNELS)} {
+	chans.resize(num_chans);
+	input_stride = num_chans;
+	output_stride = num_chans;
+}
+
+BlockResampler::~BlockResampler() = default;
+
+size_t BlockResampler::process(uint32_t channel_index, std::span<const float> in, std::span<float> out) {
+	if (channel_index >= num_chans)
+		return 0;
+
+	auto &chan = chans[channel_index];
+
+	if (chan.flush) {
+		chan = {};
+		chan.frac_pos = 1.f;
+		chan.flush = false;
+	}
+
+	size_t inpos = channel_index;
+	size_t outpos = channel_index;
+
+	while (outpos < out.size()) {
+		while (chan.frac_pos >= 1.f) {
+			if (inpos >= in.size())
+				return outpos;
+
+			chan.frac_pos -= 1.f;
+			chan.xm1 = chan.x0;
+			chan.x0 = chan.x1;
+			chan.x1 = chan.x2;
+			chan.x2 = in[inpos];
+			inpos += input_stride;
+		}
+
+		out[outpos] = hermite(chan.xm1, chan.x0, chan.x1, chan.x2, chan.frac_pos);
+		outpos += output_stride;
+		chan.frac_pos += _ratio;
+	}
+
+	return outpos;
+}
+
+void BlockResampler::set_samplerate_in_out(uint32_t input_rate, uint32_t output_rate) {
+	if (input_rate == 0 || output_rate == 0)
+		return;
+
+	auto new_ratio = float(input_rate) / float(output_rate);
+	if (new_ratio != _ratio) {
+		_ratio = new_ratio;
+		flush();
+	}
+}
+
+void BlockResampler::set_input_stride(uint32_t stride) {
+	input_stride = std::max<uint32_t>(stride, 1);
+}
+
+void BlockResampler::set_output_stride(uint32_t stride) {
+	output_stride = std::max<uint32_t>(stride, 1);
+}
+
+float BlockResampler::ratio() const {
+	return _ratio;
+}
+
+void BlockResampler::flush() {
+	for (auto &chan : chans)
+		chan.flush = true;
+}
+
+} // namespace MetaModule
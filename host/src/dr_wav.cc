@@ -0,0 +1,3 @@
+// On hardware, dr_wav is compiled into the firmware.
+#define DR_WAV_IMPLEMENTATION
+#include "wav/dr_wav.h"
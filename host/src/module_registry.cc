@@ -0,0 +1,65 @@
+#include "host_api.hh"
+#include <vector>
+
+// C++ linkage init(): the form used by native plugins
+void init() __attribute__((weak));
+
+// C linkage init(): see plugin_init.c
+extern "C" bool metamodule_host_call_c_init();
+
+namespace MetaModule
+{
+
+namespace
+{
+std::vector<Host::RegisteredModule> &registry() {
+	static std::vector<Host::RegisteredModule> modules;
+	return modules;
+}
+} // namespace
+
+bool register_module(std::string_view brand_slug,
+					 std::string_view module_slug,
+					 CreateModuleFunc funcCreate,
+					 ModuleInfoView const &info,
+					 std::string_view faceplate_filename) {
+	if (Host::find_module(brand_slug, module_slug))
+		return false;
+
+	registry().push_back({
+		.brand = std::string(brand_slug),
+		.slug = std::string(module_slug),
+		.create = std::move(funcCreate),
+		.info = info,
+		.faceplate = std::string(faceplate_filename),
+	});
+	return true;
+}
+
+namespace Host
+{
+
+bool init_plugin() {
+	if (::init) {
+		::init();
+		return true;
+	}
+
+	return metamodule_host_call_c_init();
+}
+
+std::span<const RegisteredModule> registered_modules() {
+	return registry();
+}
+
+const RegisteredModule *find_module(std::string_view brand, std::string_view slug) {
+	for (auto const &module : registry()) {
+		if (module.brand == brand && module.slug == slug)
+			return &module;
+	}
+	return nullptr;
+}
+
+} // namespace Host
+
+} // namespace MetaModule
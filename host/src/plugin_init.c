@@ -0,0 +1,13 @@
+#include <stdbool.h>
+
+// Some plugins define init() with C linkage.
+// This must be looked up from a C file, since C++ can't declare both forms.
+extern void init(void) __attribute__((weak));
+
+bool metamodule_host_call_c_init(void) {
+	if (init) {
+		init();
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,48 @@
+#include "dsp/stream_resampler.hh"
+#include <algorithm>
+
+namespace MetaModule
+{
+
+StreamResampler::StreamResampler(uint32_t num_channels) {
+	set_num_channels(num_channels);
+}
+
+// The Function versions forward to the inline templates
+void StreamResampler::process(Function<float(void)> &&get_input, std::span<float> output) {
+	process(get_input, output);
+}
+
+std::pair<float, float> StreamResampler::process_stereo(Function<float(void)> &&get_input) {
+	return process_stereo(get_input);
+}
+
+float StreamResampler::process_mono(Function<float()> &&get_input) {
+	return process_mono(get_input);
+}
+
+void StreamResampler::set_num_channels(unsigned num_channels) {
+	num_chans = std::clamp<unsigned>(num_channels, 1, MAX_CHANNELS);
+	chans.resize(num_chans);
+}
+
+void StreamResampler::set_sample_rate_in_out(uint32_t input_rate, uint32_t output_rate) {
+	if (input_rate == 0 || output_rate == 0)
+		return;
+
+	auto new_ratio = float(input_rate) / float(output_rate);
+	if (new_ratio != ratio) {
+		ratio = new_ratio;
+		should_flush = true;
+	}
+}
+
+float StreamResampler::resample_ratio(unsigned) const {
+	return ratio;
+}
+
+void StreamResampler::flush() {
+	should_flush = true;
+}
+
+} // namespace MetaModule
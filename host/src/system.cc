@@ -0,0 +1,141 @@
+#include "audio/settings.hh"
+#include "filesystem/helpers.hh"
+#include "gui/notification.hh"
+#include "host_api.hh"
+#include "patch/patch_file.hh"
+#include "system/memory.hh"
+#include "system/random.hh"
+#include "system/time.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+namespace MetaModule
+{
+
+namespace
+{
+uint32_t block_size = 64;
+}
+
+void Host::set_block_size(uint32_t size) {
+	block_size = size;
+}
+
+uint32_t Audio::get_block_size() {
+	return block_size;
+}
+
+//
+// System
+//
+
+uint32_t System::get_ticks() {
+	static const auto start = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void System::delay_ms(uint32_t ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+namespace
+{
+uint32_t pages_to_bytes(long pages) {
+	uint64_t bytes = uint64_t(pages) * uint64_t(sysconf(_SC_PAGESIZE));
+	return std::min<uint64_t>(bytes, UINT32_MAX);
+}
+} // namespace
+
+uint32_t System::total_memory() {
+	return pages_to_bytes(sysconf(_SC_PHYS_PAGES));
+}
+
+uint32_t System::free_memory() {
+	return pages_to_bytes(sysconf(_SC_AVPHYS_PAGES));
+}
+
+bool System::hardware_random_ready() {
+	return true;
+}
+
+uint32_t System::hardware_random() {
+	static std::random_device rd;
+	return rd();
+}
+
+uint32_t System::random() {
+	static std::mt19937 gen{0};
+	return gen();
+}
+
+//
+// Gui
+//
+
+void Gui::notify_user(std::string_view message, int duration_ms) {
+	fprintf(stderr, "[notify %dms] %.*s\n", duration_ms, (int)message.size(), message.data());
+}
+
+//
+// Patch: the host has no patch file
+//
+
+void Patch::mark_patch_modified() {
+}
+
+StaticString<7> Patch::get_volume() {
+	return "ram:/";
+}
+
+std::string Patch::get_path() {
+	return "ram:/host.yml";
+}
+
+std::string Patch::get_dir() {
+	return "ram:/";
+}
+
+//
+// Filesystem helpers
+//
+
+bool Filesystem::is_local_path(std::string_view path) {
+	for (auto vol : {"sdc:/", "usb:/", "nor:/", "ram:/"}) {
+		if (path.starts_with(vol))
+			return true;
+	}
+	return false;
+}
+
+std::string Filesystem::translate_path_to_local(std::string_view path, std::string_view local_path, unsigned num_subdirs) {
+	if (is_local_path(path))
+		return std::string(path);
+
+	// Keep the file name plus `num_subdirs` parent dirs
+	num_subdirs = std::min(num_subdirs, 2u);
+	auto start = path.size();
+	for (unsigned i = 0; i <= num_subdirs; i++) {
+		auto slash = path.find_last_of("/\\", start == 0 ? 0 : start - 1);
+		if (slash == std::string_view::npos) {
+			start = 0;
+			break;
+		}
+		start = slash;
+	}
+
+	auto tail = path.substr(start);
+	if (tail.starts_with('/') || tail.starts_with('\\'))
+		tail.remove_prefix(1);
+
+	std::string local{local_path};
+	if (!local.empty() && !local.ends_with('/'))
+		local += '/';
+	return local + std::string(tail);
+}
+
+} // namespace MetaModule
@@ -0,0 +1,1001 @@
+#include "wav/wav_file_stream.hh"
+#include "dsp/pcm_convert.hh"
+#include "system/time.hh"
+#include "wav/dr_wav.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace MetaModule
+{
+
+struct WavFileStream::Internal {
+	size_t max_samples;
+	BufferFormat format = BufferFormat::Float;
+
+	drwav wav{};
+	bool loaded = false;
+
+	// Format the samples are actually stored in, chosen when the file is loaded
+	enum class Storage { F32, S16, S24 };
+	Storage storage = Storage::F32;
+
+	// Circular pre-buffer of buffer_size samples, stored in the vector
+	// matching the storage format (S24 is packed, 3 bytes per sample).
+	// The buffer index of sample counter c is c % buffer_size.
+	//
+	// The buffer holds the samples from low_count up to write_count, and the
+	// play head (read_count) is between them. Going forwards, frames are
+	// written at write_count, and low_count moves up past the frames that are
+	// overwritten. In reverse, frames are written below low_count, and
+	// write_count moves down. The counters start at Origin so they never wrap.
+	static constexpr uint64_t Origin = uint64_t{1} << 40;
+	size_t buffer_size = 0;
+	std::vector<float> buffer_f32;
+	std::vector<int16_t> buffer_s16;
+	std::vector<uint8_t> buffer_s24;
+	std::atomic<uint64_t> low_count = Origin;
+	std::atomic<uint64_t> read_count = Origin;
+	std::atomic<uint64_t> write_count = Origin;
+
+	// The file frame at sample counter Origin
+	std::atomic<uint32_t> base_frame = 0;
+
+	// The file frame at write_count: the next frame to read going forwards
+	std::atomic<uint32_t> file_frame = 0;
+
+	// Where dr_wav will read next (async thread only)
+	uint64_t wav_frame = 0;
+
+	std::atomic<bool> eof = false;
+	std::atomic<bool> file_error = false;
+
+	// Playback direction, set by the audio thread
+	std::atomic<Direction> dir = Direction::Forward;
+
+	// Frames kept buffered behind the play head, for changing direction
+	std::atomic<unsigned> history_frames = 0;
+
+	// Reverse pop_sample(): the frame being popped, and the next sample in it
+	std::vector<float> reverse_frame;
+	unsigned reverse_frame_pos = 0;
+
+	// Adaptive read-ahead.
+	// Playback rate is measured by the async thread, from the change in popped_count.
+	// The audio thread counts in audio_popped_count, and copies it to popped_count
+	// once per pop_frames(), or every PopCountInterval calls to pop_sample().
+	float frames_per_ms = 0;
+	uint32_t rate_tick = 0;
+	uint64_t rate_popped_count = 0;
+	std::atomic<uint64_t> popped_count = 0;
+	uint64_t audio_popped_count = 0;
+
+	// Slowest recent read from the file. Decays slowly so one slow read is remembered for a while
+	float slowest_read_ms = 0;
+
+	// Only written by the audio thread
+	std::atomic<unsigned> underruns = 0;
+	bool in_underrun = false;
+
+	static constexpr uint32_t MinRateInterval = 10;
+	static constexpr unsigned PopCountInterval = 64;
+	static constexpr float RateSmoothing = 0.2f;
+	static constexpr float SlowestReadDecay = 0.98f;
+	static constexpr float ReadMarginMs = 50;
+
+	std::vector<float> read_buff;
+	std::vector<int16_t> read_buff_s16;
+	std::vector<uint8_t> read_buff_s24;
+
+	// Cue anchors: frames after a cue point, kept in RAM.
+	// The async thread registers and reads them. Once `ready` is set, the
+	// data is not changed, and the audio thread may play from it.
+	//
+	// The audio thread sets `in_use` before it plays from an anchor, then
+	// checks `ready` again. The async thread clears `ready` before it changes,
+	// re-uses or frees an anchor, then checks `in_use`, and leaves the anchor
+	// alone if it's set. So an anchor is never changed while it's played.
+	struct Anchor {
+		std::atomic<uint32_t> start = 0;
+		std::atomic<uint32_t> num_frames = 0;
+		std::vector<float> data;
+		std::atomic<bool> registered = false;
+		std::atomic<bool> ready = false;
+		std::atomic<bool> in_use = false;
+
+		bool contains(uint32_t frame) const {
+			return frame >= start && frame - start < num_frames;
+		}
+	};
+	std::array<Anchor, MaxAnchors> anchors;
+
+	// Audio thread: the anchor being played (-1 if none), and the read position in it in samples.
+	// While an anchor is played, read_count stays at the end of the anchor.
+	std::atomic<int> active_anchor = -1;
+	std::atomic<uint32_t> anchor_read = 0;
+
+	// Incremented by load() and unload(). An anchor played since before then
+	// is dropped by the audio thread, since the async thread can't change active_anchor.
+	std::atomic<uint32_t> file_generation = 0;
+	std::atomic<uint32_t> active_generation = 0;
+
+	// The last jump into an anchor: seek_frame_in_file(jump_frame) seeks to jump_file_frame instead
+	std::atomic<uint32_t> jump_frame = UINT32_MAX;
+	std::atomic<uint32_t> jump_file_frame = 0;
+
+	unsigned channels() const {
+		return loaded ? wav.channels : 1;
+	}
+
+	bool is_reverse() const {
+		return dir.load(std::memory_order_relaxed) == Direction::Reverse;
+	}
+
+	static size_t bytes_per_sample(Storage storage) {
+		return storage == Storage::S16 ? 2 : storage == Storage::S24 ? 3 : sizeof(float);
+	}
+
+	float sample_at(size_t idx) const {
+		switch (storage) {
+			case Storage::S16:
+				return float(buffer_s16[idx]) * (1.f / 32768.f);
+			case Storage::S24:
+				return float(unpack_s24(&buffer_s24[idx * 3])) * (1.f / 8388608.f);
+			default:
+				return buffer_f32[idx];
+		}
+	}
+
+	// Converts num samples starting at buffer index idx, which must not wrap
+	void convert_run(size_t idx, size_t num, float *out) const {
+		switch (storage) {
+			case Storage::S16:
+				convert_s16_to_f32({&buffer_s16[idx], num}, {out, num});
+				break;
+			case Storage::S24:
+				convert_s24_to_f32({&buffer_s24[idx * 3], num * 3}, {out, num});
+				break;
+			default:
+				std::copy_n(buffer_f32.begin() + idx, num, out);
+				break;
+		}
+	}
+
+	// Converts num samples starting at sample counter `count`, handling the
+	// wrap at the end of the buffer
+	void convert_samples(uint64_t count, size_t num, float *out) const {
+		auto start = count % buffer_size;
+		auto first = std::min<size_t>(num, buffer_size - start);
+		convert_run(start, first, out);
+		convert_run(0, num - first, out + first);
+	}
+
+	// The file frame at a sample counter, rounding down
+	int64_t frame_at(uint64_t count) const {
+		auto offset = int64_t(count - Origin);
+		auto chans = int64_t(channels());
+		return base_frame + (offset >= 0 ? offset / chans : -((chans - 1 - offset) / chans));
+	}
+
+	// The sample counter at the start of a file frame
+	uint64_t count_at(uint32_t frame) const {
+		return Origin + (int64_t(frame) - int64_t(base_frame.load())) * channels();
+	}
+
+	uint32_t latest_frame() const {
+		return std::max<int64_t>(0, frame_at(write_count));
+	}
+
+	uint32_t first_frame() const {
+		return std::max<int64_t>(0, frame_at(low_count));
+	}
+
+	// The file frame at low_count, which is where reading in reverse continues.
+	// This assumes the buffered frames are contiguous in the file.
+	int64_t low_file_frame() const {
+		return int64_t(file_frame) - int64_t(write_count - low_count) / channels();
+	}
+
+	// Whether the file has been read to the end in the current direction
+	bool at_end() const {
+		return is_reverse() ? low_file_frame() <= 0 : eof.load();
+	}
+
+	// Frames in the pre-buffer which can be popped from sample counter rd
+	size_t buffer_frames_from(uint64_t rd, bool reverse) const {
+		if (reverse) {
+			auto lo = low_count.load(std::memory_order_acquire);
+			return rd > lo ? (rd - lo) / channels() : 0;
+		}
+		auto wr = write_count.load(std::memory_order_acquire);
+		return wr > rd ? (wr - rd) / channels() : 0;
+	}
+
+	// Frames which can be read from the file without overwriting frames still
+	// to be played, or the history frames behind the play head
+	size_t free_frames(bool reverse) const {
+		auto used = buffer_frames_from(read_count, reverse) + history_frames;
+		auto size = buffer_size / channels();
+		return used < size ? size - used : 0;
+	}
+
+	// Where playback continues in the pre-buffer after the active anchor
+	uint64_t buffer_read_count(bool reverse) const {
+		auto a = current_anchor();
+		return (a >= 0 && reverse) ? count_at(anchors[a].start) : read_count.load();
+	}
+
+	// The anchor being played, or -1 if none (or if it's from a previous file)
+	int current_anchor() const {
+		auto a = active_anchor.load(std::memory_order_relaxed);
+		if (a >= 0 && active_generation.load(std::memory_order_relaxed) != file_generation.load(std::memory_order_relaxed))
+			return -1;
+		return a;
+	}
+
+	// Audio thread: changes the anchor being played (-1 for none)
+	void set_active_anchor(int a) {
+		auto old = active_anchor.load(std::memory_order_relaxed);
+		if (old >= 0 && old != a)
+			anchors[old].in_use.store(false, std::memory_order_release);
+		if (a >= 0) {
+			anchors[a].in_use.store(true, std::memory_order_seq_cst);
+			active_generation.store(file_generation.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+		active_anchor.store(a, std::memory_order_relaxed);
+	}
+
+	// Audio thread: starts playing from the ready anchor which contains the frame.
+	// Returns the anchor, or -1 if there is none.
+	int claim_anchor(uint32_t frame) {
+		auto a = find_anchor(frame);
+		if (a < 0)
+			return -1;
+
+		set_active_anchor(a);
+
+		// The async thread may have started changing the anchor before it saw in_use
+		if (!anchors[a].ready.load(std::memory_order_seq_cst) || !anchors[a].contains(frame)) {
+			set_active_anchor(-1);
+			return -1;
+		}
+		return a;
+	}
+
+	// Audio thread: stops playing an anchor from a previous file
+	void drop_stale_anchor() {
+		if (active_anchor.load(std::memory_order_relaxed) >= 0 && current_anchor() < 0)
+			set_active_anchor(-1);
+	}
+
+	// Async thread: whether the anchor can be changed. Clear `ready` first.
+	bool is_anchor_free(Anchor const &anchor) const {
+		return !anchor.in_use.load(std::memory_order_seq_cst);
+	}
+
+	int find_anchor(uint32_t frame) const {
+		for (unsigned i = 0; i < anchors.size(); i++) {
+			if (anchors[i].ready.load(std::memory_order_acquire) && anchors[i].contains(frame))
+				return i;
+		}
+		return -1;
+	}
+
+	// Samples left to play in the active anchor, in the given direction
+	size_t anchor_samples_left(bool reverse) const {
+		auto a = current_anchor();
+		if (a < 0)
+			return 0;
+		return reverse ? anchor_read.load() : anchors[a].data.size() - anchor_read;
+	}
+
+	// Copies whole frames from the active anchor, then from the pre-buffer.
+	// Returns the number of frames copied.
+	unsigned copy_frames(std::span<float> out, unsigned max_frames) const {
+		auto chans = channels();
+		auto reverse = is_reverse();
+		max_frames = std::min<size_t>(max_frames, out.size() / chans);
+
+		unsigned frames = 0;
+		if (auto a = current_anchor(); a >= 0) {
+			auto &anchor = anchors[a];
+			frames = std::min<size_t>(max_frames, anchor_samples_left(reverse) / chans);
+			if (reverse) {
+				for (unsigned i = 0; i < frames; i++)
+					std::copy_n(anchor.data.begin() + anchor_read - (i + 1) * chans, chans, out.begin() + i * chans);
+			} else
+				std::copy_n(anchor.data.begin() + anchor_read, frames * chans, out.begin());
+		}
+
+		return frames + copy_buffer_frames(out.subspan(frames * chans), max_frames - frames, reverse);
+	}
+
+	// Removes frames which were copied by copy_frames()
+	void advance_frames(unsigned frames) {
+		auto chans = channels();
+		auto reverse = is_reverse();
+		count_popped(frames * chans, true);
+
+		if (auto a = current_anchor(); a >= 0) {
+			auto from_anchor = std::min<size_t>(frames, anchor_samples_left(reverse) / chans);
+			if (reverse)
+				anchor_read -= from_anchor * chans;
+			else
+				anchor_read += from_anchor * chans;
+			frames -= from_anchor;
+
+			if (anchor_samples_left(reverse) == 0) {
+				// In reverse, playback continues in the pre-buffer before the anchor
+				if (reverse)
+					read_count = count_at(anchors[a].start);
+				set_active_anchor(-1);
+			}
+		}
+
+		if (reverse)
+			read_count.fetch_sub(frames * chans, std::memory_order_release);
+		else
+			read_count.fetch_add(frames * chans, std::memory_order_release);
+	}
+
+	// Copies whole frames from the play head, handling the wrap at the end of
+	// the buffer. Returns the number of frames copied.
+	// In reverse, the frames before the play head are copied, last frame first.
+	//
+	// Just after a change of direction, the async thread may still be reading
+	// in the old direction, overwriting the frames furthest from the play head.
+	// So the frames are checked again after copying, and frames which might
+	// have been overwritten are not counted.
+	unsigned copy_buffer_frames(std::span<float> out, unsigned max_frames, bool reverse) const {
+		auto chans = channels();
+		auto rd = buffer_read_count(reverse);
+		auto frames = std::min<size_t>({max_frames, out.size() / chans, buffer_frames_from(rd, reverse)});
+		if (frames == 0)
+			return 0;
+
+		if (reverse) {
+			for (size_t i = 0; i < frames; i++)
+				convert_samples(rd - (i + 1) * chans, chans, out.data() + i * chans);
+		} else
+			convert_samples(rd, frames * chans, out.data());
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return std::min(frames, buffer_frames_from(rd, reverse));
+	}
+
+	size_t default_read_frames() const {
+		// 16kB of file data at a time
+		auto bytes_per_frame = std::max<unsigned>(1, wav.channels * wav.bitsPerSample / 8);
+		return 16 * 1024 / bytes_per_frame;
+	}
+
+	void update_playback_rate() {
+		auto now = System::get_ticks();
+		auto elapsed = now - rate_tick;
+		if (elapsed < MinRateInterval)
+			return;
+
+		auto popped = popped_count.load(std::memory_order_relaxed);
+		auto frames = float(popped - rate_popped_count) / channels();
+		frames_per_ms += (frames / elapsed - frames_per_ms) * RateSmoothing;
+		rate_tick = now;
+		rate_popped_count = popped;
+	}
+
+	// Frames that will be popped while waiting for a slow read to finish.
+	// Always keep at least one default read buffered.
+	size_t refill_threshold() const {
+		auto frames = size_t(frames_per_ms * (slowest_read_ms * 2 + ReadMarginMs));
+		frames = std::max(frames, default_read_frames());
+		return std::min(frames, buffer_size / channels());
+	}
+
+	// Audio thread: adds to the number of samples popped. The async thread
+	// only sees the new count if `publish` is set, or every PopCountInterval samples.
+	void count_popped(size_t samples, bool publish) {
+		audio_popped_count += samples;
+		if (publish || audio_popped_count % PopCountInterval == 0)
+			popped_count.store(audio_popped_count, std::memory_order_relaxed);
+	}
+
+	// Audio thread: tracks underruns, given the number of samples that were
+	// wanted and the number actually popped
+	void check_underrun(size_t wanted, size_t popped) {
+		if (popped < wanted && loaded && !at_end()) {
+			if (!in_underrun) {
+				in_underrun = true;
+				underruns.store(underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		} else if (popped > 0) {
+			in_underrun = false;
+		}
+	}
+
+	// Only seeks if dr_wav is not already at the frame
+	bool seek_wav(uint64_t frame) {
+		if (frame == wav_frame)
+			return true;
+		if (!drwav_seek_to_pcm_frame(&wav, frame))
+			return false;
+		wav_frame = frame;
+		return true;
+	}
+
+	// Reads frames from the file into the pre-buffer, in the playback direction
+	void read_into_prebuffer(int num_frames) {
+		if (buffer_size == 0 || num_frames <= 0)
+			return;
+
+		auto reverse = is_reverse();
+		auto frames = std::min<size_t>(num_frames, free_frames(reverse));
+		if (frames == 0)
+			return;
+
+		auto start_tick = System::get_ticks();
+
+		if (reverse)
+			read_backwards(frames);
+		else
+			read_forwards(frames);
+
+		auto read_ms = float(System::get_ticks() - start_tick);
+		slowest_read_ms = std::max(read_ms, slowest_read_ms * SlowestReadDecay);
+	}
+
+	// Reads frames starting at file_frame, and writes them at write_count
+	void read_forwards(size_t frames) {
+		if (eof)
+			return;
+
+		auto chans = wav.channels;
+		auto wr = write_count.load();
+
+		// Give up the oldest frames before overwriting them
+		if (auto new_low = wr + frames * chans - buffer_size; new_low > low_count)
+			low_count = new_low;
+		std::atomic_thread_fence(std::memory_order_release);
+
+		if (!seek_wav(file_frame)) {
+			file_error = true;
+			return;
+		}
+
+		auto frames_read = read_into_buffer(frames, wr);
+		write_count.store(wr + frames_read * chans, std::memory_order_release);
+
+		wav_frame += frames_read;
+		file_frame += frames_read;
+
+		if (file_frame >= wav.totalPCMFrameCount)
+			eof = true;
+		else if (frames_read < frames)
+			file_error = true;
+	}
+
+	// Reads the frames before low_file_frame(), and writes them below low_count
+	void read_backwards(size_t frames) {
+		auto first = low_file_frame();
+		if (first <= 0)
+			return;
+
+		auto chans = wav.channels;
+		frames = std::min<size_t>(frames, first);
+		auto new_low = low_count - frames * chans;
+
+		// Give up the newest frames before overwriting them
+		if (auto wr = write_count.load(); wr > new_low + buffer_size) {
+			write_count = new_low + buffer_size;
+			file_frame -= (wr - write_count) / chans;
+			eof = false;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+
+		if (!seek_wav(first - frames)) {
+			file_error = true;
+			return;
+		}
+
+		auto frames_read = read_into_buffer(frames, new_low);
+		wav_frame += frames_read;
+
+		if (frames_read < frames)
+			file_error = true;
+		else
+			low_count.store(new_low, std::memory_order_release);
+	}
+
+	// Reads the next anchor which is registered but not ready.
+	// Returns false if there was nothing to read.
+	bool read_next_anchor() {
+		for (auto &anchor : anchors) {
+			if (!anchor.registered || anchor.ready || !is_anchor_free(anchor))
+				continue;
+
+			anchor.data.resize(anchor.num_frames * wav.channels);
+			bool ok = seek_wav(anchor.start);
+			if (ok) {
+				auto frames_read = drwav_read_pcm_frames_f32(&wav, anchor.num_frames, anchor.data.data());
+				wav_frame += frames_read;
+				ok = frames_read == anchor.num_frames;
+			}
+
+			if (ok)
+				anchor.ready.store(true, std::memory_order_release);
+			else
+				anchor.registered = false;
+			return true;
+		}
+		return false;
+	}
+
+	// The audio thread may still be playing from an anchor after it's cleared,
+	// so the data is not freed, and the anchor is not re-used until it's done.
+	void clear_anchors() {
+		for (auto &anchor : anchors) {
+			anchor.ready.store(false, std::memory_order_seq_cst);
+			anchor.registered = false;
+		}
+		jump_frame = UINT32_MAX;
+	}
+
+	void reset_buffer(uint32_t frame) {
+		low_count = Origin;
+		read_count = Origin;
+		write_count = Origin;
+		base_frame = frame;
+	}
+
+	void resize_buffer() {
+		buffer_f32 = {};
+		buffer_s16 = {};
+		buffer_s24 = {};
+		buffer_size = 0;
+
+		if (!loaded)
+			return;
+
+		storage = Storage::F32;
+		if (format == BufferFormat::Native && wav.translatedFormatTag == DR_WAVE_FORMAT_PCM) {
+			if (wav.bitsPerSample == 16)
+				storage = Storage::S16;
+			else if (wav.bitsPerSample == 24)
+				storage = Storage::S24;
+		}
+
+		size_t file_samples = wav.totalPCMFrameCount * wav.channels;
+		buffer_size = std::min(max_samples, file_samples);
+		buffer_size -= buffer_size % wav.channels;
+
+		if (storage == Storage::S16)
+			buffer_s16.resize(buffer_size);
+		else if (storage == Storage::S24)
+			buffer_s24.resize(buffer_size * 3);
+		else
+			buffer_f32.resize(buffer_size);
+
+		reverse_frame.resize(wav.channels);
+		reverse_frame_pos = 0;
+		reset_buffer(file_frame);
+	}
+
+	// Reads frames from the file in the storage format, and writes them to
+	// the buffer starting at sample counter wr. Returns the number of frames read.
+	size_t read_into_buffer(size_t frames, uint64_t wr) {
+		auto num = frames * wav.channels;
+		size_t frames_read = 0;
+
+		switch (storage) {
+			case Storage::S16:
+				read_buff_s16.resize(num);
+				frames_read = drwav_read_pcm_frames_s16(&wav, frames, read_buff_s16.data());
+				for (size_t i = 0; i < frames_read * wav.channels; i++)
+					buffer_s16[(wr + i) % buffer_size] = read_buff_s16[i];
+				break;
+
+			case Storage::S24:
+				// Raw data of a 24-bit PCM file is packed little-endian samples
+				read_buff_s24.resize(num * 3);
+				frames_read = drwav_read_pcm_frames(&wav, frames, read_buff_s24.data());
+				for (size_t i = 0; i < frames_read * wav.channels; i++)
+					std::copy_n(&read_buff_s24[i * 3], 3, &buffer_s24[((wr + i) % buffer_size) * 3]);
+				break;
+
+			default:
+				read_buff.resize(num);
+				frames_read = drwav_read_pcm_frames_f32(&wav, frames, read_buff.data());
+				for (size_t i = 0; i < frames_read * wav.channels; i++)
+					buffer_f32[(wr + i) % buffer_size] = read_buff[i];
+				break;
+		}
+
+		return frames_read;
+	}
+};
+
+WavFileStream::WavFileStream(size_t max_samples)
+	: internal{std::make_unique<Internal>()} {
+	internal->max_samples = max_samples;
+}
+
+WavFileStream::~WavFileStream() {
+	unload();
+}
+
+bool WavFileStream::resize(size_t max_samples) {
+	if (max_samples == internal->max_samples)
+		return false;
+
+	internal->max_samples = max_samples;
+
+	if (!internal->loaded)
+		return false;
+
+	internal->resize_buffer();
+	return true;
+}
+
+size_t WavFileStream::max_size() const {
+	return internal->max_samples;
+}
+
+size_t WavFileStream::buffer_samples() const {
+	return internal->buffer_size;
+}
+
+size_t WavFileStream::buffer_frames() const {
+	return internal->buffer_size / internal->channels();
+}
+
+bool WavFileStream::set_buffer_format(BufferFormat format) {
+	if (format == internal->format)
+		return false;
+
+	internal->format = format;
+
+	if (!internal->loaded)
+		return false;
+
+	internal->resize_buffer();
+	return true;
+}
+
+WavFileStream::BufferFormat WavFileStream::buffer_format() const {
+	return internal->format;
+}
+
+size_t WavFileStream::buffer_bytes() const {
+	return internal->buffer_size * Internal::bytes_per_sample(internal->storage);
+}
+
+bool WavFileStream::load(std::string_view sample_path) {
+	unload();
+
+	if (!drwav_init_file(&internal->wav, std::string(sample_path).c_str(), nullptr))
+		return false;
+
+	internal->loaded = true;
+	internal->eof = false;
+	internal->file_error = false;
+	internal->file_frame = 0;
+	internal->wav_frame = 0;
+	internal->resize_buffer();
+	return true;
+}
+
+void WavFileStream::unload() {
+	if (internal->loaded) {
+		drwav_uninit(&internal->wav);
+		internal->loaded = false;
+	}
+	internal->file_generation.fetch_add(1, std::memory_order_release);
+	internal->clear_anchors();
+	for (auto &anchor : internal->anchors) {
+		if (internal->is_anchor_free(anchor))
+			anchor.data = {};
+	}
+	internal->reset_buffer(0);
+	internal->file_frame = 0;
+	internal->eof = false;
+}
+
+bool WavFileStream::is_loaded() const {
+	return internal->loaded;
+}
+
+void WavFileStream::read_frames_from_file() {
+	read_frames_from_file(internal->default_read_frames());
+}
+
+void WavFileStream::read_frames_from_file(int num_frames) {
+	auto &s = *internal;
+	if (!s.loaded)
+		return;
+
+	s.read_into_prebuffer(num_frames);
+	s.read_next_anchor();
+}
+
+float WavFileStream::pop_sample() {
+	auto &s = *internal;
+	s.drop_stale_anchor();
+
+	// In reverse, pop a whole frame, and return its samples in the usual order
+	if (s.is_reverse()) {
+		if (s.reverse_frame_pos == 0 && pop_frames(s.reverse_frame, 1) == 0)
+			return 0;
+		auto val = s.reverse_frame[s.reverse_frame_pos];
+		s.reverse_frame_pos = (s.reverse_frame_pos + 1) % s.reverse_frame.size();
+		return val;
+	}
+
+	if (auto a = s.current_anchor(); a >= 0) {
+		auto val = s.anchors[a].data[s.anchor_read];
+		s.anchor_read++;
+		if (s.anchor_samples_left(false) == 0)
+			s.set_active_anchor(-1);
+		s.count_popped(1, false);
+		s.check_underrun(1, 1);
+		return val;
+	}
+
+	auto rd = s.read_count.load();
+	if (rd >= s.write_count.load(std::memory_order_acquire)) {
+		s.check_underrun(1, 0);
+		return 0;
+	}
+	s.check_underrun(1, 1);
+
+	auto val = s.sample_at(rd % s.buffer_size);
+	s.read_count.store(rd + 1, std::memory_order_release);
+	s.count_popped(1, false);
+	return val;
+}
+
+unsigned WavFileStream::pop_frames(std::span<float> out, unsigned max_frames) {
+	auto &s = *internal;
+	s.drop_stale_anchor();
+	auto frames = s.copy_frames(out, max_frames);
+	s.advance_frames(frames);
+	s.check_underrun(std::min<size_t>(max_frames, out.size() / s.channels()), frames);
+	return frames;
+}
+
+unsigned WavFileStream::peek_frames(std::span<float> out, unsigned max_frames) const {
+	return internal->copy_frames(out, max_frames);
+}
+
+bool WavFileStream::needs_refill() {
+	auto &s = *internal;
+	if (!s.loaded || s.at_end() || s.buffer_size == 0)
+		return false;
+
+	s.update_playback_rate();
+
+	return s.free_frames(s.is_reverse()) > 0 && frames_available() <= s.refill_threshold();
+}
+
+unsigned WavFileStream::suggested_read_frames() const {
+	auto &s = *internal;
+	if (!s.loaded || s.buffer_size == 0)
+		return 0;
+
+	// At least enough to play through a slow read
+	auto frames = std::max(s.default_read_frames(), s.refill_threshold());
+	return std::min<size_t>(frames, s.free_frames(s.is_reverse()));
+}
+
+unsigned WavFileStream::underrun_count() const {
+	return internal->underruns.load(std::memory_order_relaxed);
+}
+
+unsigned WavFileStream::samples_available() const {
+	auto &s = *internal;
+	auto reverse = s.is_reverse();
+	return s.buffer_frames_from(s.buffer_read_count(reverse), reverse) * s.channels() + s.anchor_samples_left(reverse);
+}
+
+unsigned WavFileStream::frames_available() const {
+	return samples_available() / internal->channels();
+}
+
+float WavFileStream::sample_seconds() const {
+	if (!internal->loaded || internal->wav.sampleRate == 0)
+		return 0;
+	return float(internal->wav.totalPCMFrameCount) / float(internal->wav.sampleRate);
+}
+
+bool WavFileStream::is_eof() const {
+	return internal->at_end();
+}
+
+bool WavFileStream::is_file_error() const {
+	return internal->file_error;
+}
+
+unsigned WavFileStream::current_playback_frame() const {
+	auto &s = *internal;
+	int64_t frame = s.frame_at(s.read_count);
+	if (auto a = s.current_anchor(); a >= 0)
+		frame = s.anchors[a].start + s.anchor_read / s.channels();
+
+	// In reverse, the next frame is the one before the play head
+	if (s.is_reverse())
+		frame--;
+	return std::max<int64_t>(frame, 0);
+}
+
+unsigned WavFileStream::latest_buffered_frame() const {
+	return internal->latest_frame();
+}
+
+unsigned WavFileStream::first_frame_in_buffer() const {
+	return internal->first_frame();
+}
+
+void WavFileStream::reset_playback_to_frame(uint32_t frame_num) {
+	auto &s = *internal;
+	s.reverse_frame_pos = 0;
+
+	if (s.is_reverse()) {
+		// The play head goes after the frame. Anchors are not used in reverse.
+		s.set_active_anchor(-1);
+		s.jump_frame = UINT32_MAX;
+		if (frame_num >= s.first_frame() && frame_num < s.latest_frame())
+			s.read_count = s.count_at(frame_num + 1);
+		else
+			s.reset_buffer(frame_num + 1);
+
+	} else if (frame_num >= s.first_frame() && frame_num < s.latest_frame()) {
+		// Frame is in the buffer: just move the read head
+		s.set_active_anchor(-1);
+		s.jump_frame = UINT32_MAX;
+		s.read_count = s.count_at(frame_num);
+
+	} else if (auto a = s.claim_anchor(frame_num); a >= 0) {
+		// Frame is in an anchor: play from the anchor, and continue buffering
+		// from the end of the anchor (unless that's already buffered)
+		auto &anchor = s.anchors[a];
+		auto end = anchor.start + anchor.num_frames;
+		s.anchor_read = (frame_num - anchor.start) * s.channels();
+
+		if (end >= s.first_frame() && end < s.latest_frame())
+			s.read_count = s.count_at(end);
+		else
+			s.reset_buffer(end);
+
+		s.jump_file_frame = s.latest_frame();
+		s.jump_frame.store(frame_num, std::memory_order_release);
+
+	} else {
+		s.set_active_anchor(-1);
+		s.jump_frame = UINT32_MAX;
+		s.reset_buffer(frame_num);
+	}
+}
+
+void WavFileStream::seek_frame_in_file(uint32_t frame_num) {
+	auto &s = *internal;
+	if (!s.loaded)
+		return;
+
+	// Playback jumped into an anchor: the pre-buffer continues after the anchor
+	if (frame_num == s.jump_frame.load(std::memory_order_acquire))
+		frame_num = s.jump_file_frame;
+
+	// In reverse, the buffer ends just after the frame
+	else if (s.is_reverse())
+		frame_num++;
+
+	// Frame is already buffered, or is the next frame to be read
+	if (frame_num >= s.first_frame() && frame_num <= s.latest_frame() && s.file_frame == s.latest_frame())
+		return;
+
+	// The file is seeked when it's next read
+	if (frame_num <= s.wav.totalPCMFrameCount) {
+		s.file_frame = frame_num;
+		s.eof = frame_num == s.wav.totalPCMFrameCount;
+	} else {
+		s.file_error = true;
+	}
+}
+
+void WavFileStream::set_direction(Direction dir) {
+	auto &s = *internal;
+	if (dir == s.dir)
+		return;
+
+	s.dir = dir;
+	s.reverse_frame_pos = 0;
+
+	if (dir == Direction::Reverse) {
+		// pop_sample() may have left the play head part way through a frame:
+		// move it to the end of that frame, so the frame is played in reverse
+		auto chans = int64_t(s.channels());
+		auto partial = ((int64_t(s.read_count - Internal::Origin) % chans) + chans) % chans;
+		if (partial)
+			s.read_count += chans - partial;
+
+	} else if (auto a = s.current_anchor(); a >= 0) {
+		// Going forwards, the pre-buffer continues from the end of the anchor.
+		// If that's not buffered anymore, continue from the pre-buffer now.
+		auto &anchor = s.anchors[a];
+		auto end = anchor.start + anchor.num_frames;
+		if (end >= s.first_frame() && end <= s.latest_frame())
+			s.read_count = s.count_at(end);
+		else {
+			auto frame = anchor.start + s.anchor_read / s.channels();
+			s.set_active_anchor(-1);
+			s.read_count = std::clamp(s.count_at(frame), s.low_count.load(), s.write_count.load());
+		}
+	}
+}
+
+WavFileStream::Direction WavFileStream::direction() const {
+	return internal->dir;
+}
+
+void WavFileStream::set_history_frames(unsigned frames) {
+	internal->history_frames = frames;
+}
+
+bool WavFileStream::add_anchor(uint32_t frame_num, unsigned num_frames) {
+	auto &s = *internal;
+	if (!s.loaded || frame_num >= s.wav.totalPCMFrameCount || num_frames == 0)
+		return false;
+
+	num_frames = std::min<uint64_t>(num_frames, s.wav.totalPCMFrameCount - frame_num);
+
+	for (auto &anchor : s.anchors) {
+		if (anchor.registered && anchor.start == frame_num && anchor.num_frames == num_frames)
+			return true;
+	}
+
+	for (int i = 0; i < int(s.anchors.size()); i++) {
+		auto &anchor = s.anchors[i];
+		if (anchor.registered || !s.is_anchor_free(anchor))
+			continue;
+
+		anchor.start = frame_num;
+		anchor.num_frames = num_frames;
+		anchor.registered = true;
+		return true;
+	}
+
+	return false;
+}
+
+void WavFileStream::clear_anchors() {
+	internal->clear_anchors();
+}
+
+unsigned WavFileStream::num_anchors() const {
+	return std::ranges::count_if(internal->anchors, [](auto const &anchor) { return anchor.registered.load(); });
+}
+
+unsigned WavFileStream::num_anchors_loaded() const {
+	return std::ranges::count_if(internal->anchors, [](auto const &anchor) { return anchor.ready.load(); });
+}
+
+bool WavFileStream::is_playing_anchor() const {
+	return internal->current_anchor() >= 0;
+}
+
+bool WavFileStream::is_stereo() const {
+	return internal->loaded && internal->wav.channels == 2;
+}
+
+unsigned WavFileStream::num_channels() const {
+	return internal->loaded ? internal->wav.channels : 0;
+}
+
+unsigned WavFileStream::total_frames() const {
+	return internal->loaded ? internal->wav.totalPCMFrameCount : 0;
+}
+
+unsigned WavFileStream::wav_sample_rate() const {
+	return internal->loaded ? internal->wav.sampleRate : 0;
+}
+
+} // namespace MetaModule
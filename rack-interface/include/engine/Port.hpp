@@ -1,4 +1,5 @@
 #pragma once
+#include "CoreModules/CoreProcessor.hh"
 #include <algorithm>
 #include <array>
 #include <common.hpp>
@@ -8,10 +9,14 @@
 namespace rack::engine
 {
 
-static const int PORT_MAX_CHANNELS = 4;
+static const int PORT_MAX_CHANNELS = CoreProcessor::MaxPolyChannels;
+
+// With 4 channels, Port keeps the v2.x firmware layout (voltages are not aligned).
+// With more, voltages are aligned so getVoltageSimd() loads whole vectors.
+static constexpr size_t PORT_VOLTAGES_ALIGN = PORT_MAX_CHANNELS > 4 ? CoreProcessor::PolyAlign : alignof(float);
 
 struct Port {
-	std::array<float, PORT_MAX_CHANNELS> voltages = {};
+	alignas(PORT_VOLTAGES_ALIGN) std::array<float, PORT_MAX_CHANNELS> voltages = {};
 	uint8_t channels = 0;
 
 	enum Type {
@@ -88,7 +93,7 @@ struct Port {
 
 	template<typename T>
 	T getVoltageSimd(int firstChannel) const {
-		if (firstChannel < PORT_MAX_CHANNELS)
+		if (firstChannel >= 0 && firstChannel + int(sizeof(T) / sizeof(float)) <= PORT_MAX_CHANNELS)
 			return T::load(&voltages[firstChannel]);
 		else
 			return T{0.f}; //try to handle error gracefully
@@ -111,7 +116,7 @@ struct Port {
 
 	template<typename T>
 	void setVoltageSimd(T v, int firstChannel) {
-		if (firstChannel < PORT_MAX_CHANNELS)
+		if (firstChannel >= 0 && firstChannel + int(sizeof(T) / sizeof(float)) <= PORT_MAX_CHANNELS)
 			v.store(&voltages[firstChannel]);
 	}
 